@@ -11,6 +11,39 @@
 #include <TROOT.h>
 #include <TChain.h>
 #include <TFile.h>
+#include <string>
+#include <vector>
+
+class TH1;
+class TH2;
+
+// Histograms filled by the loop. When running in parallel each thread fills
+// its own set, and the sets are added together at the end.
+struct LoopHistograms {
+   TH1 *charge;
+   TH1 *logcharge;
+   TH1 *trklenhist;
+   TH1 *PEperevent;
+   TH2 *PEvsTrklen;
+   TH2 *PEvsVertex;
+   TH2 *ChargevsVertex;
+   Long64_t zerocharge;
+
+   void Book(const char *suffix);
+   void Add(const LoopHistograms &other);
+   void Write();
+   void Delete();
+};
+
+// Values for each primary particle, in entry order. Grows as needed, so any
+// number of entries can be kept.
+struct LoopResults {
+   std::vector<Long64_t> entry;
+   std::vector<double>   PE;
+   std::vector<double>   trklen;
+   std::vector<double>   vertex;
+   std::vector<double>   charge;
+};
 
 // Header file for the classes stored in the TTree if any.
 
@@ -260,6 +293,22 @@ public :
    virtual void     Loop();
    virtual Bool_t   Notify();
    virtual void     Show(Long64_t entry = -1);
+
+   // Read only the branches used by ProcessEntry
+   virtual void     EnableBranches();
+   // Check the variable length branches fit the arrays above
+   virtual Bool_t   FitsBuffers();
+   // Fill histograms and results from the entry just read
+   virtual void     ProcessEntry(Long64_t entry, LoopHistograms &hists, LoopResults &results);
+
+   // Run over many files (e.g. one per simulated voltage), nThreads at once.
+   // nThreads=0 uses one per core. Files may contain wildcards.
+   static void      ParallelLoop(const std::vector<std::string> &files, UInt_t nThreads = 0,
+                                 const char *output = "loopoutput.root");
+   static void      ParallelLoop(const char *files, UInt_t nThreads = 0,
+                                 const char *output = "loopoutput.root");
+   static void      WriteOutput(const char *output, LoopHistograms &hists,
+                                const std::vector<LoopResults> &results);
 };
 
 #endif
@@ -0,0 +1,139 @@
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ColumnStore.h"
+#include "LBNEWareCsv.h"
+#include "Log.h"
+#include "tclap/CmdLine.h"
+
+using namespace std;
+
+//Convert millislice files written by freerun, or CSV files exported by
+//LBNEWare, into a column store, and/or print a summary of a store (per
+//channel rates and peak sum spectrum)
+int main(int argc, char** argv){
+
+  TCLAP::CmdLine cmd("Convert millislice (.dat) or LBNEWare (.csv) files to a column store",' ',"1.0");
+  TCLAP::ValueArg<string> storeArg("d","store","Column store directory",true,"","dir",cmd);
+  TCLAP::ValueArg<unsigned int> chunkArg("c","chunk","Events per waveform chunk file",false,65536,"n",cmd);
+  TCLAP::ValueArg<double> clockArg("f","clock","Timestamp clock frequency",false,150.,"MHz",cmd);
+  TCLAP::ValueArg<unsigned int> threadsArg("j","threads","Threads for parsing CSV (0 for one per core)",false,0,"n",cmd);
+  TCLAP::SwitchArg summaryArg("s","summary","Print a summary of the store",cmd);
+  TCLAP::UnlabeledMultiArg<string> inputArg("input","Files to convert",false,"file",cmd);
+  cmd.parse(argc,argv);
+
+  if(!inputArg.getValue().empty()){
+    std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+    SSPDAQ::EventStoreWriter store(storeArg.getValue(),chunkArg.getValue());
+    unsigned long long totalBytes=0;
+
+    for(vector<string>::const_iterator file=inputArg.getValue().begin();file!=inputArg.getValue().end();++file){
+
+      //LBNEWare export: headers only, no waveforms
+      if(file->size()>4&&file->compare(file->size()-4,4,".csv")==0){
+	SSPDAQ::LBNEWareCsv csv(*file);
+	vector<SSPDAQ::EventHeader> events;
+	csv.Parse(events,threadsArg.getValue());
+	for(unsigned long i=0;i<events.size();++i){
+	  store.Add(events[i],0,0);
+	}
+	if(csv.SkippedRows()){
+	  SSPDAQ::Log::Warning()<<"Skipped "<<csv.SkippedRows()<<" bad rows in "<<*file<<std::endl;
+	}
+	totalBytes+=csv.Bytes();
+	continue;
+      }
+
+      int fd=open(file->c_str(),O_RDONLY);
+      struct stat info;
+      if(fd<0||fstat(fd,&info)){
+	SSPDAQ::Log::Error()<<"Couldn't open "<<*file<<std::endl;
+	return 1;
+      }
+      if(info.st_size==0){
+	close(fd);
+	continue;
+      }
+      void* map=mmap(0,info.st_size,PROT_READ,MAP_SHARED,fd,0);
+      close(fd);
+      if(map==MAP_FAILED){
+	SSPDAQ::Log::Error()<<"Couldn't map "<<*file<<std::endl;
+	return 1;
+      }
+      madvise(map,info.st_size,MADV_SEQUENTIAL);
+
+      //File is millislices back to back, each giving its own length
+      store.StartFile();
+      const unsigned int* word=(const unsigned int*)map;
+      const unsigned int* end=word+info.st_size/sizeof(unsigned int);
+      while(word+SSPDAQ::MillisliceHeader::sizeInUInts<=end){
+	unsigned int length=((const SSPDAQ::MillisliceHeader*)word)->length;
+	if(length<SSPDAQ::MillisliceHeader::sizeInUInts||word+length>end){
+	  SSPDAQ::Log::Warning()<<"Bad millislice in "<<*file<<", skipping rest of file"<<std::endl;
+	  break;
+	}
+	store.AddMillislice(word,length);
+	word+=length;
+      }
+      munmap(map,info.st_size);
+      totalBytes+=info.st_size;
+    }
+    store.Close();
+
+    double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    SSPDAQ::Log::Info()<<"Converted "<<store.Events()<<" events, skipping "<<store.Duplicates()<<" overlap copies ("<<totalBytes/1048576<<" MB) in "
+		       <<seconds<<"s, "<<totalBytes/1048576./seconds<<" MB/s"<<std::endl;
+  }
+
+  if(!summaryArg.getValue()){
+    return 0;
+  }
+
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  SSPDAQ::EventStoreReader store(storeArg.getValue());
+  unsigned long n=store.Events();
+  if(n==0){
+    cout<<"Store is empty"<<endl;
+    return 0;
+  }
+
+  const unsigned short* module=store.Column<unsigned short>("module");
+  const unsigned char* channel=store.Column<unsigned char>("channel");
+  const unsigned long* timestamp=store.Column<unsigned long>("timestamp");
+  const int* peakSum=store.Column<int>("peakSum");
+
+  unsigned long first,last;
+  SSPDAQ::Scan::Range(timestamp,n,first,last);
+  double span=(last-first)/(clockArg.getValue()*1.E6);
+
+  //Module ID is 12 bits and channel ID 4 bits, so count into a flat table
+  std::vector<unsigned long> counts(1<<16);
+  for(unsigned long i=0;i<n;++i){
+    ++counts[(module[i]<<4)|(channel[i]&0xF)];
+  }
+  cout<<n<<" events over "<<span<<"s"<<endl;
+  cout<<setw(8)<<"Module"<<setw(8)<<"Channel"<<setw(12)<<"Events"<<setw(12)<<"Rate (Hz)"<<endl;
+  for(unsigned int key=0;key<counts.size();++key){
+    if(counts[key]){
+      cout<<setw(8)<<(key>>4)<<setw(8)<<(key&0xF)<<setw(12)<<counts[key]
+	  <<setw(12)<<(span>0?counts[key]/span:0.)<<endl;
+    }
+  }
+
+  std::vector<unsigned long> bins(20);
+  int low=-(1<<23);
+  int high=1<<23;
+  SSPDAQ::Scan::Histogram(peakSum,n,low,high,bins);
+  cout<<"Peak sum"<<endl;
+  for(unsigned int i=0;i<bins.size();++i){
+    cout<<setw(12)<<low+((double)high-low)*i/bins.size()<<setw(12)<<bins[i]<<endl;
+  }
+
+  double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+  SSPDAQ::Log::Info()<<"Summary took "<<seconds<<"s"<<std::endl;
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "EventDecoder.h"
+#include "Log.h"
+#include "tclap/CmdLine.h"
+
+using namespace std;
+
+//Read the events of each millislice in a file written by freerun
+bool ReadSlices(const string& path, vector<vector<unsigned int> >& slices){
+  int fd=open(path.c_str(),O_RDONLY);
+  struct stat info;
+  if(fd<0||fstat(fd,&info)){
+    SSPDAQ::Log::Error()<<"Couldn't open "<<path<<std::endl;
+    return false;
+  }
+  void* map=info.st_size?mmap(0,info.st_size,PROT_READ,MAP_SHARED,fd,0):MAP_FAILED;
+  close(fd);
+  if(map==MAP_FAILED){
+    SSPDAQ::Log::Error()<<"Couldn't map "<<path<<std::endl;
+    return false;
+  }
+  const unsigned int* word=(const unsigned int*)map;
+  const unsigned int* end=word+info.st_size/sizeof(unsigned int);
+  while(word+SSPDAQ::MillisliceHeader::sizeInUInts<=end){
+    unsigned int length=((const SSPDAQ::MillisliceHeader*)word)->length;
+    if(length<SSPDAQ::MillisliceHeader::sizeInUInts||word+length>end){
+      SSPDAQ::Log::Warning()<<"Bad millislice in "<<path<<", skipping rest of file"<<std::endl;
+      break;
+    }
+    slices.push_back(vector<unsigned int>(word+SSPDAQ::MillisliceHeader::sizeInUInts,word+length));
+    word+=length;
+  }
+  munmap(map,info.st_size);
+  return true;
+}
+
+//Slices of random events, each of headerWords plus the given waveform length,
+//or of random lengths up to it
+void MakeSlices(unsigned long nEvents, unsigned int nSamples, bool vary, vector<vector<unsigned int> >& slices){
+  std::mt19937 generator(1);
+  std::uniform_int_distribution<unsigned int> word;
+  unsigned long timestamp=1000;
+  const unsigned long eventsPerSlice=10000;
+  for(unsigned long i=0;i<nEvents;++i){
+    if(i%eventsPerSlice==0){
+      slices.push_back(vector<unsigned int>());
+    }
+    vector<unsigned int>& slice=slices.back();
+    unsigned int payloadWords=vary?word(generator)%(nSamples/2+1):nSamples/2;
+    size_t start=slice.size();
+    slice.resize(start+SSPDAQ::Decode::headerWords+payloadWords);
+    for(size_t w=start;w<slice.size();++w){
+      slice[w]=word(generator);
+    }
+    SSPDAQ::EventHeader& header=*(SSPDAQ::EventHeader*)&slice[start];
+    header.header=0xAAAAAAAA;
+    header.length=SSPDAQ::Decode::headerWords+payloadWords;
+    timestamp+=word(generator)%10000;
+    for(unsigned int iWord=1;iWord<=3;++iWord){
+      header.intTimestamp[iWord]=(timestamp>>16*(iWord-1))&0xFFFF;
+    }
+  }
+}
+
+template<class T> bool SameValues(const vector<T>& a, const vector<T>& b, size_t n){
+  return std::equal(a.begin(),a.begin()+n,b.begin());
+}
+
+bool Same(const SSPDAQ::DecodedEvents& a, const SSPDAQ::DecodedEvents& b, bool allFields){
+  size_t n=a.size();
+  bool same=n==b.size()&&SameValues(a.offset,b.offset,n)&&SameValues(a.module,b.module,n)&&
+    SameValues(a.channel,b.channel,n)&&SameValues(a.timestamp,b.timestamp,n)&&SameValues(a.nSamples,b.nSamples,n);
+  if(allFields){
+    same=same&&SameValues(a.peakSum,b.peakSum,n)&&SameValues(a.prerise,b.prerise,n)&&
+      SameValues(a.integratedSum,b.integratedSum,n)&&SameValues(a.baseline,b.baseline,n)&&
+      SameValues(a.triggerType,b.triggerType,n)&&SameValues(a.statusFlags,b.statusFlags,n);
+  }
+  return same;
+}
+
+//Decode every slice repeats times, returning ns per event
+template<class Decode>
+double Time(const vector<vector<unsigned int> >& slices, unsigned int repeats, Decode decode,
+	    SSPDAQ::DecodedEvents& out, unsigned long& checksum){
+  unsigned long events=0;
+  checksum=0;
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  for(unsigned int r=0;r<repeats;++r){
+    for(auto slice=slices.begin();slice!=slices.end();++slice){
+      events+=decode(&(*slice)[0],slice->size(),out);
+      checksum+=out.size()?out.timestamp[out.size()-1]:0;
+    }
+  }
+  double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+  return events?seconds*1E9/events:0.;
+}
+
+//Compare the decoders SelectDecoder picks for each configuration with the
+//generic decoder, on millislices from a file or on generated events
+int main(int argc, char** argv){
+
+  TCLAP::CmdLine cmd("Benchmark specialised event decoders against the generic one",' ',"1.0");
+  TCLAP::ValueArg<unsigned long> eventsArg("n","events","Number of events to generate if no file is given",false,1000000,"n",cmd);
+  TCLAP::ValueArg<unsigned int> samplesArg("w","window","Waveform length of generated events",false,64,"samples",cmd);
+  TCLAP::SwitchArg varyArg("v","vary","Generate events of random length up to the window",cmd);
+  TCLAP::ValueArg<unsigned int> repeatArg("r","repeat","Times to decode the data for each configuration",false,20,"n",cmd);
+  TCLAP::UnlabeledValueArg<string> inputArg("input","Millislice file written by freerun",false,"","file",cmd);
+  cmd.parse(argc,argv);
+
+  vector<vector<unsigned int> > slices;
+  if(!inputArg.getValue().empty()){
+    if(!ReadSlices(inputArg.getValue(),slices)){
+      return 1;
+    }
+  }
+  else{
+    MakeSlices(eventsArg.getValue(),samplesArg.getValue(),varyArg.getValue(),slices);
+  }
+
+  //Fixed length configurations are only tried if every event is the same length
+  unsigned int fixedLength=0;
+  bool sameLength=true;
+  SSPDAQ::DecodedEvents events;
+  SSPDAQ::DecoderConfig probe={SSPDAQ::kInternalTime,SSPDAQ::TimingService::Transform(),false,0};
+  for(auto slice=slices.begin();slice!=slices.end()&&sameLength;++slice){
+    SSPDAQ::DecodeGeneric(&(*slice)[0],slice->size(),probe,events);
+    for(size_t i=0;i<events.size();++i){
+      unsigned int length=SSPDAQ::Decode::headerWords+events.nSamples[i]/2;
+      sameLength=sameLength&&(!fixedLength||length==fixedLength);
+      fixedLength=length;
+    }
+  }
+  if(!sameLength){
+    fixedLength=0;
+  }
+
+  SSPDAQ::TimingService::Transform transform={0,1000,0.25,64./150.};
+  const char* timeNames[]={"internal","external","unified"};
+  unsigned int repeats=repeatArg.getValue();
+
+  cout<<setw(10)<<"Time"<<setw(8)<<"Fields"<<setw(10)<<"Length"<<setw(14)<<"Generic (ns)"
+      <<setw(18)<<"Specialised (ns)"<<setw(10)<<"Speedup"<<endl;
+  bool allSame=true;
+  for(unsigned int mode=SSPDAQ::kInternalTime;mode<=SSPDAQ::kUnifiedTime;++mode){
+    for(unsigned int all=0;all<=1;++all){
+      for(unsigned int fixed=0;fixed<=(fixedLength?1u:0u);++fixed){
+	SSPDAQ::DecoderConfig config={(SSPDAQ::TimeMode_t)mode,transform,all==1,fixed?fixedLength:0};
+	SSPDAQ::DecodeFunction_t decoder=SSPDAQ::SelectDecoder(config);
+
+	//Check that both give the same result on every slice
+	SSPDAQ::DecodedEvents generic;
+	bool same=true;
+	for(auto slice=slices.begin();slice!=slices.end();++slice){
+	  SSPDAQ::DecodeGeneric(&(*slice)[0],slice->size(),config,generic);
+	  decoder(&(*slice)[0],slice->size(),config,events);
+	  same=same&&Same(generic,events,config.allFields);
+	}
+	allSame=allSame&&same;
+
+	unsigned long genericSum, specialisedSum;
+	double genericTime=Time(slices,repeats,[&config](const unsigned int* data, size_t words, SSPDAQ::DecodedEvents& out){
+	    return SSPDAQ::DecodeGeneric(data,words,config,out);
+	  },events,genericSum);
+	double specialisedTime=Time(slices,repeats,[&config,decoder](const unsigned int* data, size_t words, SSPDAQ::DecodedEvents& out){
+	    return decoder(data,words,config,out);
+	  },events,specialisedSum);
+
+	cout<<setw(10)<<timeNames[mode]<<setw(8)<<(all?"all":"timing")<<setw(10)<<(fixed?"fixed":"variable")
+	    <<setw(14)<<setprecision(3)<<genericTime<<setw(18)<<specialisedTime
+	    <<setw(10)<<(specialisedTime>0?genericTime/specialisedTime:0.)
+	    <<((same&&genericSum==specialisedSum)?"":"  MISMATCH")<<endl;
+      }
+    }
+  }
+  return allSame?0:1;
+}
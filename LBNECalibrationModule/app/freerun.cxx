@@ -0,0 +1,205 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include "CounterHarvester.h"
+#include "DeviceInterface.h"
+#include "Log.h"
+#include "SliceWriter.h"
+#include "tclap/CmdLine.h"
+
+using namespace std;
+
+//Sum hardware counters over channels and log loss and live fractions
+void ReportCounters(const SSPDAQ::CounterHarvester::BoardStats& stats){
+  unsigned long accepted=0, dropped=0, read=0;
+  for(auto channel=stats.channels.begin();channel!=stats.channels.end();++channel){
+    accepted+=channel->accepted;
+    dropped+=channel->dropped;
+    read+=channel->read;
+  }
+  SSPDAQ::Log::Info()<<"Hardware accepted "<<accepted<<" events, dropped "<<dropped<<" (live fraction "
+		     <<(accepted+dropped?(double)accepted/(accepted+dropped):1.)<<"), read out "<<read
+		     <<" (loss "<<(accepted&&read<accepted?1.-(double)read/accepted:0.)<<")";
+  if(stats.codeErrors||stats.dispErrors||stats.overflowStatus){
+    SSPDAQ::Log::Info()<<", link errors "<<stats.codeErrors<<"/"<<stats.dispErrors
+		       <<", overflow status 0x"<<std::hex<<stats.overflowStatus<<std::dec;
+  }
+  SSPDAQ::Log::Info()<<std::endl;
+}
+
+//Take data from one SSP for a fixed time, streaming millislices to disk as
+//they are built, rather than holding the run in memory until the end
+int main(int argc, char** argv){
+
+  TCLAP::CmdLine cmd("Free run an SSP, writing millislices to disk",' ',"1.0");
+  TCLAP::ValueArg<string> outArg("o","output","Output file base name (files are <base>_NNNN.dat)",true,"","path",cmd);
+  TCLAP::ValueArg<unsigned int> timeArg("t","time","Run time",false,30,"s",cmd);
+  TCLAP::ValueArg<string> addressArg("a","address","Ethernet address of SSP",false,"192.168.1.107","ip",cmd);
+  TCLAP::ValueArg<int> usbArg("u","usb","Use USB device with this index instead of Ethernet",false,-1,"n",cmd);
+  TCLAP::ValueArg<unsigned int> sliceArg("l","slice-length","Millislice length in clock ticks",false,15000000,"ticks",cmd);
+  TCLAP::ValueArg<unsigned int> buffersArg("n","buffers","Number of write buffers",false,3,"n",cmd);
+  TCLAP::ValueArg<unsigned int> bufferSizeArg("s","buffer-size","Size of each write buffer (should hold a whole slice)",false,16,"MB",cmd);
+  TCLAP::ValueArg<unsigned int> rollBytesArg("r","roll-size","Start a new file after this much data (0 for no limit)",false,1024,"MB",cmd);
+  TCLAP::ValueArg<unsigned int> rollTimeArg("R","roll-time","Start a new file after this long (0 for no limit)",false,0,"s",cmd);
+  TCLAP::ValueArg<unsigned int> syncArg("c","checkpoint","Sync to disk at this interval (0 to leave it to the OS)",false,1000,"ms",cmd);
+  TCLAP::SwitchArg bufferedArg("b","buffered","Don't use direct I/O",cmd);
+  TCLAP::ValueArg<unsigned int> countersArg("m","monitor","Read hardware event counters at this interval (0 to disable)",false,1000,"ms",cmd);
+  TCLAP::ValueArg<string> replayArg("y","replay","Play back this raw stream or millislice file instead of reading an SSP",false,"","path",cmd);
+  TCLAP::ValueArg<double> speedArg("x","speed","Replay speed relative to recorded timing (0 for as fast as possible)",false,1.,"factor",cmd);
+  TCLAP::ValueArg<string> captureArg("w","capture","Also capture the raw data stream to <base>_NNNN.raw, for replay",false,"","base",cmd);
+  TCLAP::ValueArg<unsigned int> captureSizeArg("W","capture-size","Start a new capture file after this much data (0 for no limit)",false,1024,"MB",cmd);
+  TCLAP::ValueArg<unsigned int> captureFilesArg("k","capture-files","Keep only this many capture files (0 to keep all)",false,0,"n",cmd);
+  TCLAP::ValueArg<string> modeArg("M","mode","Readout mode: full, headers, prescale (waveforms for 1 in -P events per channel) or cut (waveforms for peak sum of at least -A)",false,"full","mode",cmd);
+  TCLAP::ValueArg<unsigned int> prescaleArg("P","prescale","Waveform prescale for prescale mode",false,100,"n",cmd);
+  TCLAP::ValueArg<int> cutArg("A","amplitude-cut","Peak sum cut for cut mode",false,0,"peak sum",cmd);
+  TCLAP::ValueArg<string> channelMaskArg("F","filter-channels","Keep only events on channels set in this mask (e.g. 0x00FF)",false,"0xFFFF","mask",cmd);
+  TCLAP::ValueArg<int> peakLowArg("L","filter-min-peak","Keep only events with at least this peak sum",false,INT_MIN,"peak sum",cmd);
+  TCLAP::ValueArg<int> peakHighArg("H","filter-max-peak","Keep only events with at most this peak sum",false,INT_MAX,"peak sum",cmd);
+  TCLAP::ValueArg<unsigned int> flagsArg("S","filter-flags","Drop events with any of these status flags set (e.g. pileup)",false,0,"flags",cmd);
+  TCLAP::MultiArg<unsigned int> triggerTypesArg("T","filter-trigger","Keep only events with this trigger type (repeat for several)",false,"type",cmd);
+  TCLAP::ValueArg<unsigned int> preriseLowArg("e","filter-min-prerise","Keep only events with at least this prerise",false,0,"prerise",cmd);
+  TCLAP::ValueArg<unsigned int> preriseHighArg("E","filter-max-prerise","Keep only events with at most this prerise",false,UINT_MAX,"prerise",cmd);
+  TCLAP::SwitchArg unifyArg("U","unified","Build millislices in unified time, fitted to the external clock",cmd);
+  TCLAP::ValueArg<string> pubArg("p","publish","Publish loss and live fractions as binary telemetry on this endpoint",false,"","endpoint",cmd);
+  cmd.parse(argc,argv);
+
+  SSPDAQ::SliceWriter writer(outArg.getValue(),buffersArg.getValue(),bufferSizeArg.getValue()*1024*1024);
+  writer.SetRollover((unsigned long long)rollBytesArg.getValue()*1024*1024,rollTimeArg.getValue());
+  writer.SetCheckpointInterval(syncArg.getValue());
+  writer.SetDirectIO(!bufferedArg.getValue());
+
+  //Open SSP device
+  SSPDAQ::Comm_t commType=SSPDAQ::kEthernet;
+  unsigned long deviceId=inet_network(addressArg.getValue().c_str());
+  if(usbArg.getValue()>=0){
+    commType=SSPDAQ::kUSB;
+    deviceId=usbArg.getValue();
+  }
+  if(!replayArg.getValue().empty()){
+    commType=SSPDAQ::kReplay;
+    deviceId=0;
+    SSPDAQ::DeviceManager::Get().SetReplaySource(deviceId,replayArg.getValue(),speedArg.getValue());
+  }
+  SSPDAQ::DeviceInterface dev(commType,deviceId);
+  dev.Initialize();
+  dev.Configure();
+  dev.SetMillisliceLength(sliceArg.getValue());
+  dev.SetMillisliceOverlap(sliceArg.getValue()/10);
+
+  if(modeArg.getValue()=="headers"){
+    dev.SetReadoutMode(SSPDAQ::kHeadersOnly);
+  }
+  else if(modeArg.getValue()=="prescale"){
+    dev.SetReadoutMode(SSPDAQ::kPrescaledWaveforms);
+    for(unsigned int channel=0;channel<SSPDAQ::DeviceInterface::maxChannelIds;++channel){
+      dev.SetWaveformPrescale(channel,prescaleArg.getValue());
+    }
+  }
+  else if(modeArg.getValue()=="cut"){
+    dev.SetReadoutMode(SSPDAQ::kAmplitudeCut);
+    dev.SetAmplitudeCut(cutArg.getValue());
+  }
+  else if(modeArg.getValue()!="full"){
+    SSPDAQ::Log::Error()<<"Unknown readout mode "<<modeArg.getValue()<<std::endl;
+    return 1;
+  }
+
+  SSPDAQ::EventFilter filter;
+  filter.SetChannelMask(strtoul(channelMaskArg.getValue().c_str(),0,0));
+  filter.SetPeakSumWindow(peakLowArg.getValue(),peakHighArg.getValue());
+  filter.SetRejectedStatusFlags(flagsArg.getValue());
+  filter.SetTriggerTypes(triggerTypesArg.getValue());
+  filter.SetPreriseWindow(preriseLowArg.getValue(),preriseHighArg.getValue());
+  dev.SetEventFilter(filter);
+
+  SSPDAQ::TimingService timing;
+  if(unifyArg.getValue()){
+    dev.SetTimingService(&timing);
+  }
+
+  unique_ptr<SSPDAQ::RawCapture> capture;
+  if(!captureArg.getValue().empty()){
+    capture.reset(new SSPDAQ::RawCapture(captureArg.getValue()));
+    capture->SetRollover((unsigned long long)captureSizeArg.getValue()*1024*1024,captureFilesArg.getValue());
+    capture->Open();
+    dev.SetRawCapture(capture.get());
+  }
+
+  //Writer never waits for the disk, so it can safely be a mandatory consumer
+  std::shared_ptr<SSPDAQ::MillisliceRing::Consumer> consumer=dev.AddSliceConsumer(true);
+
+  //Hardware counters, for loss accounting while the run goes on
+  zmq::context_t context(1);
+  unique_ptr<SSPDAQ::TelemetryPublisher> publisher;
+  SSPDAQ::RegisterPoller poller;
+  SSPDAQ::CounterHarvester harvester;
+  if(countersArg.getValue()){
+    poller.AddBoard(deviceId,&dev);
+    harvester.AddBoard(deviceId,&dev);
+    harvester.AddTo(poller,countersArg.getValue());
+    if(!pubArg.getValue().empty()){
+      publisher.reset(new SSPDAQ::TelemetryPublisher(context,pubArg.getValue()));
+      harvester.AddPublisher(publisher.get());
+    }
+  }
+
+  writer.Open();
+  dev.Start();
+  if(countersArg.getValue()){
+    poller.Start();
+  }
+
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point nextReport=start+std::chrono::seconds(1);
+  SSPDAQ::MillisliceRing::Slice_t slice;
+
+  while(std::chrono::steady_clock::now()-start<std::chrono::seconds(timeArg.getValue())){
+    if(consumer->Next(slice,std::chrono::microseconds(100000))){
+      writer.Write(*slice);
+    }
+
+    if(std::chrono::steady_clock::now()>=nextReport){
+      SSPDAQ::SliceWriter::Stats stats=writer.GetStats();
+      SSPDAQ::Log::Info()<<"Written "<<stats.slicesWritten<<" slices, "<<stats.bytesWritten/1048576<<" MB to disk, "
+			 <<stats.slicesDropped<<" dropped, peak latency "<<stats.maxLatencyInus<<"us ("
+			 <<writer.CurrentFile()<<")"<<std::endl;
+      SSPDAQ::CounterHarvester::BoardStats counters;
+      if(countersArg.getValue()&&harvester.GetStats(deviceId,counters)){
+	ReportCounters(counters);
+      }
+      SSPDAQ::TimingService::Stats clock;
+      if(unifyArg.getValue()&&timing.GetStats(deviceId,clock)){
+	SSPDAQ::Log::Info()<<"Clock fit "<<(clock.locked?"locked":"not locked")<<" on "<<clock.samples<<" samples ("
+			   <<clock.rejected<<" rejected), drift "<<clock.driftInppm<<"ppm, offset "<<clock.offsetInTicks
+			   <<" ticks, error "<<clock.errorInTicks<<" ticks"<<std::endl;
+      }
+      nextReport+=std::chrono::seconds(1);
+    }
+  }
+
+  if(countersArg.getValue()){
+    poller.Stop();
+  }
+  dev.Stop();
+  if(dev.GetWaveformsDropped()){
+    SSPDAQ::Log::Info()<<"Readout mode dropped "<<dev.GetWaveformsDropped()<<" waveforms"<<std::endl;
+  }
+  if(dev.GetEventsFiltered()){
+    SSPDAQ::Log::Info()<<"Event filter rejected "<<dev.GetEventsFiltered()<<" events"<<std::endl;
+  }
+
+  //Write out whatever the read thread built before stopping
+  while(consumer->Next(slice,std::chrono::microseconds(0))){
+    writer.Write(*slice);
+  }
+  dev.RemoveSliceConsumer(consumer);
+  if(capture){
+    dev.SetRawCapture(0);
+    capture->Close();
+  }
+
+  writer.Close();
+  return 0;
+}
@@ -10,6 +10,18 @@
 using namespace libconfig;
 using namespace std;
 
+//Pulser settings for one group of calibration channels, from the <prefix>_* keys.
+//Each field is checked against its width, so an out of range setting throws
+//rather than spilling into the next field.
+SSPDAQ::RegMap::CalConfig::Values CalConfig(Setting& cfgroot, const string& prefix){
+  typedef SSPDAQ::RegMap::CalConfig Cal;
+  return Cal::Values().Set(Cal::nova_enable,   (unsigned int)cfgroot[prefix+"_nova_enable"])
+                      .Set(Cal::trigger_source,(unsigned int)cfgroot[prefix+"_trigger_source"])
+                      .Set(Cal::pulse_delay,   (unsigned int)cfgroot[prefix+"_pulse_delay"])
+                      .Set(Cal::pulse_width_2, (unsigned int)cfgroot[prefix+"_pulse_width_2"])
+                      .Set(Cal::pulse_width_1, (unsigned int)cfgroot[prefix+"_pulse_width_1"]);
+}
+
 void Configure(SSPDAQ::DeviceInterface& dev, Setting& cfgroot){
 
   dev.SetRegisterByName("eventDataInterfaceSelect", 0x00000001);
@@ -53,9 +65,10 @@ void Configure(SSPDAQ::DeviceInterface& dev, Setting& cfgroot){
   dev.SetRegisterByName("qi_delay",                  0x00000000);
   dev.SetRegisterByName("qi_pulse_width",            0x00000000);
   dev.SetRegisterByName("external_gate_width",       0x00008000);
-  dev.SetRegisterByName("dsp_clock_control",         0x00000013);// # 0x1  - use ext clock to drive ADCs
-                                                                 // # 0x2  - use NOvA clock (0 value uses front panel input)
-                                                                 //# 0x10 - Enable clock jitter correction
+  typedef SSPDAQ::RegMap::DspClockControl Clock;
+  dev.SetRegisterByName("dsp_clock_control",         Clock::Values().Set(Clock::adc_external_clock,1)
+                                                                    .Set(Clock::nova_clock,1)
+                                                                    .Set(Clock::jitter_correction,1).Value());
 
    //        # dsp_clock_control:         0x00000000 # Use internal clock to drive ADCs, front panel
    //     #                                        # clock for sync
@@ -65,55 +78,13 @@ void Configure(SSPDAQ::DeviceInterface& dev, Setting& cfgroot){
    //     #                                      # in range 0-30V
   dev.SetRegisterByName("bias_control", (unsigned int)cfgroot["bias_control"]);
   
-  unsigned int iu_cal_config = ((unsigned int)cfgroot["iu_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["iu_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["iu_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["iu_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["iu_pulse_width_1"]);
-  unsigned int tpc_cal_config = ((unsigned int)cfgroot["tpc_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["tpc_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["tpc_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["tpc_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["tpc_pulse_width_1"]);
-  // unsigned int pd_cal_config = ((unsigned int)cfgroot["pd_nova_enable"]) << 31 |
-  //                           ((unsigned int)cfgroot["pd_trigger_source"]) << 28 |
-  //                           ((unsigned int)cfgroot["pd_pulse_delay"]) << 16 |
-  //                           ((unsigned int)cfgroot["pd_pulse_width_2"]) << 8 |
-  //                           ((unsigned int)cfgroot["pd_pulse_width_1"]);
-  unsigned int pd1_cal_config = ((unsigned int)cfgroot["pd1_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["pd1_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["pd1_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["pd1_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["pd1_pulse_width_1"]);
-  unsigned int pd2_cal_config = ((unsigned int)cfgroot["pd2_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["pd2_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["pd2_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["pd2_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["pd2_pulse_width_1"]);
-  unsigned int pd3_cal_config = ((unsigned int)cfgroot["pd3_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["pd3_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["pd3_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["pd3_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["pd3_pulse_width_1"]);
-  unsigned int pd4_cal_config = ((unsigned int)cfgroot["pd4_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["pd4_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["pd4_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["pd4_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["pd4_pulse_width_1"]);
-  unsigned int pd5_cal_config = ((unsigned int)cfgroot["pd5_nova_enable"]) << 31 |
-                            ((unsigned int)cfgroot["pd5_trigger_source"]) << 28 |
-                            ((unsigned int)cfgroot["pd5_pulse_delay"]) << 16 |
-                            ((unsigned int)cfgroot["pd5_pulse_width_2"]) << 8 |
-                            ((unsigned int)cfgroot["pd5_pulse_width_1"]);
- 
-  dev.SetRegisterArrayByName("iu_cal_config",            iu_cal_config);
-  dev.SetRegisterArrayByName("tpc_cal_config",           tpc_cal_config);
-  //dev.SetRegisterArrayByName("pd_cal_config",            pd_cal_config);
-  dev.SetRegisterArrayByName("pd1_cal_config",            pd1_cal_config);
-  dev.SetRegisterArrayByName("pd2_cal_config",            pd2_cal_config);
-  dev.SetRegisterArrayByName("pd3_cal_config",            pd3_cal_config);
-  dev.SetRegisterArrayByName("pd4_cal_config",            pd4_cal_config);
-  dev.SetRegisterArrayByName("pd5_cal_config",            pd5_cal_config);
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::iu_cal_config,  CalConfig(cfgroot,"iu"));
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::tpc_cal_config, CalConfig(cfgroot,"tpc"));
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::pd1_cal_config, CalConfig(cfgroot,"pd1"));
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::pd2_cal_config, CalConfig(cfgroot,"pd2"));
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::pd3_cal_config, CalConfig(cfgroot,"pd3"));
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::pd4_cal_config, CalConfig(cfgroot,"pd4"));
+  dev.SetRegisterFields(SSPDAQ::RegMap::CalConfig::pd5_cal_config, CalConfig(cfgroot,"pd5"));
   dev.SetRegisterByName("cal_count", (unsigned int)cfgroot["pulse_sets"]);
   dev.SetRegisterByName("cal_trigger",               0x00000001);
 }
@@ -0,0 +1,280 @@
+//Standalone SSP simulator. Listens on the same ports as a real board and speaks
+//the CtrlHeader/CtrlPacket protocol on the comm (55001) and slow control (55002)
+//ports, with register and flash commands handled by an EmulatedDevice. Event data
+//from the emulator's generator are streamed on the data port (55010).
+//
+//Point an EthernetDevice at the simulator host (e.g. 127.0.0.1) to exercise the
+//real Ethernet code path without hardware.
+
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "boost/asio.hpp"
+#include "tclap/CmdLine.h"
+#include "DeviceManager.h"
+#include "EmulatedDevice.h"
+#include "anlTypes.h"
+#include "Log.h"
+
+using namespace std;
+using boost::asio::ip::tcp;
+
+namespace{
+
+  boost::asio::io_service io_service;
+
+  //Emulated hardware behind all ports
+  SSPDAQ::Device* device=0;
+
+  //Serialises commands arriving on the comm and slow control ports
+  std::mutex deviceMutex;
+
+  //Largest TCP write used on the data port; 0 means no limit.
+  //Small values force the client to cope with partial reads.
+  unsigned int maxSegmentBytes=0;
+}
+
+//Carry out one command on the emulated device and fill in the reply packet.
+//Returns size of reply in bytes.
+unsigned int HandleCommand(const SSPDAQ::CtrlPacket& rx, SSPDAQ::CtrlPacket& tx)
+{
+  tx.header=rx.header;
+  tx.header.status=SSPDAQ::statusNoError;
+  unsigned int replyWords=0;
+
+  SSPDAQ::CtrlHeader hdr=rx.header;
+  unsigned int payloadWords=(hdr.length-sizeof(SSPDAQ::CtrlHeader))/sizeof(unsigned int);
+
+  //Words of payload each command needs, beyond what hdr.size says for the array writes
+  unsigned int neededWords=0;
+  switch(hdr.command){
+  case SSPDAQ::cmdReadMask:
+  case SSPDAQ::cmdWrite:
+  case SSPDAQ::cmdNVWrite:
+    neededWords=1;
+    break;
+  case SSPDAQ::cmdWriteMask:
+    neededWords=2;
+    break;
+  default:
+    break;
+  }
+
+  if(hdr.size>MAX_CTRL_DATA||payloadWords<neededWords){
+    tx.header.status=SSPDAQ::statusSizeError;
+  }
+  else{
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    try{
+      switch(hdr.command){
+      case SSPDAQ::cmdRead:
+	device->DeviceRead(hdr.address,&tx.data[0]);
+	replyWords=1;
+	break;
+      case SSPDAQ::cmdReadMask:
+	device->DeviceReadMask(hdr.address,rx.data[0],&tx.data[0]);
+	replyWords=1;
+	break;
+      case SSPDAQ::cmdWrite:
+	device->DeviceWrite(hdr.address,rx.data[0]);
+	break;
+      case SSPDAQ::cmdWriteMask:
+	device->DeviceWriteMask(hdr.address,rx.data[0],rx.data[1]);
+	device->DeviceRead(hdr.address,&tx.data[0]);
+	replyWords=1;
+	break;
+      case SSPDAQ::cmdArrayRead:
+	device->DeviceArrayRead(hdr.address,hdr.size,tx.data);
+	replyWords=hdr.size;
+	break;
+      case SSPDAQ::cmdArrayWrite:
+	if(payloadWords<hdr.size){
+	  tx.header.status=SSPDAQ::statusSizeError;
+	  break;
+	}
+	device->DeviceArrayWrite(hdr.address,hdr.size,const_cast<unsigned int*>(rx.data));
+	break;
+      case SSPDAQ::cmdNVWrite:
+	device->DeviceNVWrite(hdr.address,rx.data[0]);
+	break;
+      case SSPDAQ::cmdNVArrayWrite:
+	if(payloadWords<hdr.size){
+	  tx.header.status=SSPDAQ::statusSizeError;
+	  break;
+	}
+	device->DeviceNVArrayWrite(hdr.address,hdr.size,const_cast<unsigned int*>(rx.data));
+	break;
+      case SSPDAQ::cmdNVEraseSector:
+	device->DeviceNVEraseSector(hdr.address);
+	break;
+      case SSPDAQ::cmdNVEraseBlock:
+	device->DeviceNVEraseBlock(hdr.address);
+	break;
+      case SSPDAQ::cmdNVEraseChip:
+	device->DeviceNVEraseChip(hdr.address);
+	break;
+      default:
+	tx.header.status=SSPDAQ::statusCommandError;
+      }
+    }
+    catch(std::invalid_argument&){
+      tx.header.status=SSPDAQ::statusAddressError;
+      replyWords=0;
+    }
+  }
+
+  if(tx.header.status!=SSPDAQ::statusNoError){
+    replyWords=0;
+  }
+  tx.header.length=sizeof(SSPDAQ::CtrlHeader)+replyWords*sizeof(unsigned int);
+  return tx.header.length;
+}
+
+//Read commands from a comm or slow control connection until the client disconnects
+void ServeControl(tcp::socket* socket)
+{
+  SSPDAQ::CtrlPacket rx;
+  SSPDAQ::CtrlPacket tx;
+  boost::system::error_code ec;
+
+  while(true){
+    boost::asio::read(*socket,boost::asio::buffer(&rx.header,sizeof(SSPDAQ::CtrlHeader)),ec);
+    if(ec){
+      break;
+    }
+    if(rx.header.length<sizeof(SSPDAQ::CtrlHeader)||rx.header.length>sizeof(SSPDAQ::CtrlPacket)){
+      SSPDAQ::Log::Error()<<"Bad control packet length "<<rx.header.length<<", dropping connection"<<std::endl;
+      break;
+    }
+    boost::asio::read(*socket,boost::asio::buffer(rx.data,rx.header.length-sizeof(SSPDAQ::CtrlHeader)),ec);
+    if(ec){
+      break;
+    }
+    unsigned int txSize=HandleCommand(rx,tx);
+    boost::asio::write(*socket,boost::asio::buffer(&tx,txSize),ec);
+    if(ec){
+      break;
+    }
+  }
+  SSPDAQ::Log::Info()<<"Control connection closed"<<std::endl;
+  delete socket;
+}
+
+//Check for a closed connection without blocking. Clients never send on the data port,
+//so any completed read means end of file.
+bool ClientDisconnected(tcp::socket& socket)
+{
+  boost::system::error_code ec;
+  char junk;
+  socket.non_blocking(true);
+  socket.read_some(boost::asio::buffer(&junk,1),ec);
+  socket.non_blocking(false);
+  return ec!=boost::asio::error::would_block;
+}
+
+//Stream emulator output to a data connection until the client disconnects
+void ServeData(tcp::socket& socket)
+{
+  std::vector<unsigned int> data;
+  std::default_random_engine generator;
+  boost::system::error_code ec;
+
+  while(true){
+    device->DeviceReceive(data,0x4000);
+    if(data.empty()){
+      //Nothing generated for a while; check the client is still there
+      if(ClientDisconnected(socket)){
+	break;
+      }
+      continue;
+    }
+
+    const char* bytes=reinterpret_cast<const char*>(&data[0]);
+    unsigned int nBytes=data.size()*sizeof(unsigned int);
+    unsigned int sent=0;
+    while(sent<nBytes&&!ec){
+      unsigned int chunk=nBytes-sent;
+      if(maxSegmentBytes){
+	std::uniform_int_distribution<unsigned int> segmentDistribution(1,maxSegmentBytes);
+	chunk=std::min(chunk,segmentDistribution(generator));
+      }
+      sent+=boost::asio::write(socket,boost::asio::buffer(bytes+sent,chunk),ec);
+    }
+    if(ec){
+      break;
+    }
+  }
+  SSPDAQ::Log::Info()<<"Data connection closed"<<std::endl;
+}
+
+//Accept any number of concurrent control connections on port
+void AcceptControl(const tcp::endpoint& endpoint)
+{
+  tcp::acceptor acceptor(io_service,endpoint);
+  while(true){
+    tcp::socket* socket=new tcp::socket(io_service);
+    try{
+      acceptor.accept(*socket);
+      socket->set_option(tcp::no_delay(true));
+      SSPDAQ::Log::Info()<<"Control connection on port "<<endpoint.port()<<std::endl;
+      std::thread(ServeControl,socket).detach();
+    }
+    catch(std::exception& e){
+      //Closes the connection if it was accepted
+      SSPDAQ::Log::Error()<<"Failed to set up control connection on port "<<endpoint.port()<<": "<<e.what()<<std::endl;
+      delete socket;
+    }
+  }
+}
+
+//Accept one data connection at a time, as the hardware does
+void AcceptData(const tcp::endpoint& endpoint)
+{
+  tcp::acceptor acceptor(io_service,endpoint);
+  while(true){
+    tcp::socket socket(io_service);
+    try{
+      acceptor.accept(socket);
+      SSPDAQ::Log::Info()<<"Data connection on port "<<endpoint.port()<<std::endl;
+      ServeData(socket);
+    }
+    catch(std::exception& e){
+      //socket is closed as it goes out of scope
+      SSPDAQ::Log::Error()<<"Data connection on port "<<endpoint.port()<<" failed: "<<e.what()<<std::endl;
+    }
+  }
+}
+
+int main(int argc, char** argv){
+
+  TCLAP::CmdLine cmd("Simulate an SSP board on the Ethernet control and data ports",' ',"1.0");
+  TCLAP::ValueArg<std::string> addressArg("a","address","Address to listen on",false,"0.0.0.0","ip",cmd);
+  TCLAP::ValueArg<unsigned int> moduleArg("m","module","Emulated device number, reported as module ID",false,0,"n",cmd);
+  TCLAP::ValueArg<double> rateArg("r","rate","Mean event rate over all channels in Hz",false,10.,"Hz",cmd);
+  TCLAP::ValueArg<unsigned int> payloadArg("p","payload","Waveform words per event when readout_window is not set",false,100,"words",cmd);
+  TCLAP::ValueArg<unsigned int> latencyArg("l","latency","Latency added to each register transaction",false,0,"us",cmd);
+  TCLAP::ValueArg<unsigned int> segmentArg("s","segment","Largest TCP write on data port (0 for no limit)",false,0,"bytes",cmd);
+  cmd.parse(argc,argv);
+
+  maxSegmentBytes=segmentArg.getValue();
+
+  SSPDAQ::DeviceManager::Get().SetEmulatorLatency(latencyArg.getValue());
+  device=SSPDAQ::DeviceManager::Get().OpenDevice(SSPDAQ::kEmulated,moduleArg.getValue());
+  SSPDAQ::EmulatedDevice* emulator=dynamic_cast<SSPDAQ::EmulatedDevice*>(device);
+  emulator->SetEventRate(rateArg.getValue());
+  emulator->SetPayloadWords(payloadArg.getValue());
+
+  boost::asio::ip::address address=boost::asio::ip::address::from_string(addressArg.getValue());
+
+  std::thread commThread(AcceptControl,tcp::endpoint(address,55001));
+  std::thread slowControlThread(AcceptControl,tcp::endpoint(address,55002));
+  std::thread dataThread(AcceptData,tcp::endpoint(address,55010));
+
+  SSPDAQ::Log::Info()<<"SSP simulator listening on "<<address.to_string()<<std::endl;
+
+  commThread.join();
+  slowControlThread.join();
+  dataThread.join();
+}
@@ -0,0 +1,107 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include "ColumnStore.h"
+#include "Log.h"
+#include "RateAnalysis.h"
+#include "tclap/CmdLine.h"
+
+using namespace std;
+
+//Trigger rates and timing for a run converted to a column store by
+//colconvert: per channel and per module rates, inter-arrival distributions,
+//dead time, and rates in a sliding window through the run
+int main(int argc, char** argv){
+
+  TCLAP::CmdLine cmd("Trigger rate and timing analysis of a column store",' ',"1.0");
+  TCLAP::ValueArg<string> storeArg("d","store","Column store directory",true,"","dir",cmd);
+  TCLAP::ValueArg<double> clockArg("c","clock","Timestamp clock frequency",false,150.,"MHz",cmd);
+  TCLAP::ValueArg<double> windowArg("w","window","Sliding window length",false,1.,"s",cmd);
+  TCLAP::ValueArg<double> stepArg("s","step","Sliding window step",false,1.,"s",cmd);
+  TCLAP::ValueArg<unsigned long> deadArg("D","dead-time","Dead time per trigger (0 to use shortest gap seen)",false,0,"ticks",cmd);
+  TCLAP::ValueArg<string> seriesArg("t","time-series","Write window rates to this file",false,"","file",cmd);
+  TCLAP::ValueArg<string> gapArg("g","gaps","Write inter-arrival histograms to this file",false,"","file",cmd);
+  TCLAP::ValueArg<unsigned int> binsArg("b","bins","Inter-arrival bins per decade",false,10,"n",cmd);
+  cmd.parse(argc,argv);
+
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+
+  SSPDAQ::EventStoreReader store(storeArg.getValue());
+  SSPDAQ::RateAnalysis analysis(clockArg.getValue(),windowArg.getValue(),stepArg.getValue(),binsArg.getValue());
+
+  //Time series is written as each window closes, one line per channel
+  ofstream series;
+  if(!seriesArg.getValue().empty()){
+    series.open(seriesArg.getValue().c_str());
+    if(!series){
+      SSPDAQ::Log::Error()<<"Couldn't create "<<seriesArg.getValue()<<std::endl;
+      return 1;
+    }
+    series<<"#start end module channel events rate"<<endl;
+    //A run shorter than the window gives one shorter window
+    analysis.SetWindowCallback([&series](double wStart, double wEnd,
+					 const std::vector<SSPDAQ::RateAnalysis::Channel>& channels){
+				 for(unsigned int i=0;i<channels.size();++i){
+				   series<<wStart<<" "<<wEnd<<" "<<channels[i].module<<" "<<channels[i].channel<<" "
+					 <<channels[i].windowEvents<<" "<<channels[i].windowEvents/(wEnd-wStart)<<"\n";
+				 }
+			       });
+  }
+
+  const unsigned short* module=store.Column<unsigned short>("module");
+  const unsigned char* channel=store.Column<unsigned char>("channel");
+  const unsigned long* timestamp=store.Column<unsigned long>("timestamp");
+  analysis.Add(module,channel,timestamp,store.Events());
+  analysis.Finish();
+
+  double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+  //Per channel table, and sums for each module
+  const std::vector<SSPDAQ::RateAnalysis::Channel>& channels=analysis.Channels();
+  std::map<unsigned int,std::pair<unsigned long,double> > modules;
+  cout<<setw(8)<<"Module"<<setw(8)<<"Channel"<<setw(12)<<"Events"<<setw(12)<<"Span (s)"
+      <<setw(12)<<"Rate (Hz)"<<setw(12)<<"Gap (tick)"<<setw(12)<<"Dead frac"<<setw(12)<<"True (Hz)"<<endl;
+  for(unsigned int i=0;i<channels.size();++i){
+    const SSPDAQ::RateAnalysis::Channel& ch=channels[i];
+    cout<<setw(8)<<ch.module<<setw(8)<<ch.channel<<setw(12)<<ch.events<<setw(12)<<analysis.Span(ch)
+	<<setw(12)<<analysis.Rate(ch)<<setw(12)<<(ch.events>1?ch.minGap:0)
+	<<setw(12)<<analysis.DeadFraction(ch,deadArg.getValue())
+	<<setw(12)<<analysis.TrueRate(ch,deadArg.getValue())<<endl;
+    modules[ch.module].first+=ch.events;
+    modules[ch.module].second+=analysis.Rate(ch);
+  }
+  cout<<endl<<setw(8)<<"Module"<<setw(12)<<"Events"<<setw(12)<<"Rate (Hz)"<<endl;
+  for(std::map<unsigned int,std::pair<unsigned long,double> >::iterator mod=modules.begin();mod!=modules.end();++mod){
+    cout<<setw(8)<<mod->first<<setw(12)<<mod->second.first<<setw(12)<<mod->second.second<<endl;
+  }
+
+  //Every event over the span of the whole run, as trigger_rate.py works it out
+  cout<<endl<<"All channels: "<<analysis.Events()<<" events over "<<analysis.Span()<<" s, "
+      <<analysis.Rate()<<" Hz"<<endl;
+
+  if(!gapArg.getValue().empty()){
+    ofstream gaps(gapArg.getValue().c_str());
+    gaps<<"#module channel low(ticks) high(ticks) count"<<endl;
+    for(unsigned int i=0;i<channels.size();++i){
+      for(unsigned int bin=0;bin<channels[i].gapBins.size();++bin){
+	if(channels[i].gapBins[bin]){
+	  gaps<<channels[i].module<<" "<<channels[i].channel<<" "<<analysis.GapBinLow(bin)<<" "
+	      <<analysis.GapBinLow(bin+1)<<" "<<channels[i].gapBins[bin]<<"\n";
+	}
+      }
+    }
+  }
+
+  unsigned long outOfOrder=0;
+  for(unsigned int i=0;i<channels.size();++i){
+    outOfOrder+=channels[i].outOfOrder;
+  }
+  if(outOfOrder||analysis.LateEvents()){
+    SSPDAQ::Log::Warning()<<outOfOrder<<" events out of time order on their channel, "
+			  <<analysis.LateEvents()<<" too late for the sliding window"<<std::endl;
+  }
+  SSPDAQ::Log::Info()<<"Analysed "<<analysis.Events()<<" events in "<<seconds<<"s"<<std::endl;
+  return 0;
+}
@@ -2,9 +2,10 @@
 #include <iomanip>
 #include <iostream>
 #include "DeviceInterface.h"
+#include "RegisterPoller.h"
+#include "TelemetryPublisher.h"
+#include "tclap/CmdLine.h"
 #include <unistd.h>
-#include "json/json.h"
-#include "zmq.hpp"
 
 using namespace std;
 
@@ -116,13 +117,39 @@ double Register2Voltage(double regVal, double biasRb, double AGND, double AREF,
   return vol;
 }
 
-void ReadbackAndLog(SSPDAQ::DeviceInterface& dev, string outfn, zmq::socket_t& socket)
+//Converts polled monitor registers to voltages and currents, and logs them to
+//file and the monitoring server. The CSV file stays open for the whole run.
+class VmonSink : public SSPDAQ::PollSink{
+
+public:
+
+  VmonSink(string outfn):
+    fOutFile(outfn.c_str(), ofstream::out | ofstream::app){}
+
+  void AddPublisher(SSPDAQ::TelemetryPublisher* publisher){fPublishers.push_back(publisher);}
+
+  virtual void Consume(const vector<SSPDAQ::PollSample>& samples);
+
+private:
+
+  ofstream fOutFile;
+
+  vector<SSPDAQ::TelemetryPublisher*> fPublishers;
+};
+
+void VmonSink::Consume(const vector<SSPDAQ::PollSample>& samples)
 {
   vector<unsigned int> monBiasVals, monValueVals, biasReadback;
   vector<double> monVolts, monAmps;
-  dev.ReadRegisterArrayByName("mon_bias", monBiasVals);
-  dev.ReadRegisterArrayByName("mon_value", monValueVals);
-  dev.ReadRegisterArrayByName("bias_readback", biasReadback);
+  for(unsigned int i = 0; i < samples.size(); i++)
+  {
+    if(samples[i].name == "mon_bias") monBiasVals = samples[i].values;
+    else if(samples[i].name == "mon_value") monValueVals = samples[i].values;
+    else if(samples[i].name == "bias_readback") biasReadback = samples[i].values;
+  }
+  if(monBiasVals.empty() || monValueVals.empty() || biasReadback.empty())
+    return;
+
   /// The formula from register readings to voltage is provided in the SSP
   /// manual
   unsigned int uAGND = (monValueVals[1] & 0x0000FFFF);
@@ -145,47 +172,40 @@ void ReadbackAndLog(SSPDAQ::DeviceInterface& dev, string outfn, zmq::socket_t& s
   /* get current timestamp and use it for every readings */
   string ts = GetCurrentTimeStamp();
   /* log values to be monitored */
-  ofstream outf(outfn.c_str(), ofstream::out | ofstream::app);
   for(unsigned int i = 0; i < monVolts.size(); i++)
   {
     stringstream Vmon, Imon, Vset;
     Vmon << "35T.SSP_Vmon_ch" << i << ".F_CV";
     Imon << "35T.SSP_Imon_ch" << i << ".F_CV";
     Vset << "35T.SSP_Vset_ch" << i << ".F_CV";
-    outf << Vmon.str() << "," << ts << "," << monVolts[i] << endl;
-    outf << Imon.str() << "," << ts << "," << monAmps[i] << endl;
-    outf << Vset.str() << "," << ts << "," << biasReadback[i]/((double)0x00000FFF)*30 << endl;
+    fOutFile << Vmon.str() << "," << ts << "," << monVolts[i] << "\n";
+    fOutFile << Imon.str() << "," << ts << "," << monAmps[i] << "\n";
+    fOutFile << Vset.str() << "," << ts << "," << biasReadback[i]/((double)0x00000FFF)*30 << "\n";
     
-    /* set up JSON message with jsoncpp */
-    Json::Value jsonV, jsonI;
-    Json::FastWriter fastWriterV, fastWriterI;
     stringstream varnameV, varnameI;
     varnameV << "SSP08_Vmon_ch" << i;
     varnameI << "SSP08_Imon_ch" << i;
-    /// standard fields
-    jsonV["type"] = "moni";
-    jsonV["service"] = "test_service";
-    jsonV["varname"] = varnameV.str().c_str();
-    jsonV["value"] = monVolts[i];
-    jsonI["type"] = "moni";
-    jsonI["service"] = "test_service";
-    jsonI["varname"] = varnameI.str().c_str();
-    jsonI["value"] = monAmps[i];
-    std::string jsonMessageV = fastWriterV.write(jsonV);
-    std::string jsonMessageI = fastWriterI.write(jsonI);
-    zmq::message_t messageV(jsonMessageV.length());
-    zmq::message_t messageI(jsonMessageI.length());
-    memcpy(messageV.data(), jsonMessageV.c_str(), jsonMessageV.length());
-    memcpy(messageI.data(), jsonMessageI.c_str(), jsonMessageI.length());
-    cout << "voltage sent? " << socket.send(messageV) << endl;
-    cout << "current sent? " << socket.send(messageI) << endl;
+    for(unsigned int p = 0; p < fPublishers.size(); p++)
+    {
+      fPublishers[p]->Add(varnameV.str(), monVolts[i]);
+      fPublishers[p]->Add(varnameI.str(), monAmps[i]);
+    }
   }
-  outf.close();
+  /* whole cycle goes out as one batch */
+  for(unsigned int p = 0; p < fPublishers.size(); p++)
+    fPublishers[p]->Publish(samples.front().board, samples.front().time);
+  /* one flush per cycle so the file is current without reopening it */
+  fOutFile.flush();
   cout << "Monitor values logged." << endl;
 }
 
 int main(int argc, char** argv){
   
+  TCLAP::CmdLine cmd("Monitor SSP bias voltages and currents",' ',"1.0");
+  TCLAP::ValueArg<string> jsonArg("j","json","Send legacy JSON messages to this endpoint (empty to disable)",false,"tcp://lbnedaq1:5000","endpoint",cmd);
+  TCLAP::ValueArg<string> pubArg("b","binary","Publish binary telemetry batches on this endpoint",false,"","endpoint",cmd);
+  cmd.parse(argc,argv);
+
   //Open SSP device
   unsigned long board_id=inet_network("192.168.1.107");
   SSPDAQ::DeviceInterface dev(SSPDAQ::kEthernet,board_id);
@@ -201,15 +221,31 @@ int main(int argc, char** argv){
   outf.close();
   /* setup the server connection with ZeroMQ */
   zmq::context_t zmq_context(1);
-  zmq::socket_t zmq_socket(zmq_context, ZMQ_PUSH);
-  //zmq_socket.connect("tcp://lbne-moni:5000"); // this is a test machine at UMD
-  zmq_socket.connect("tcp://lbnedaq1:5000");
+  VmonSink sink(outfn);
+  unique_ptr<SSPDAQ::TelemetryPublisher> jsonPublisher, binaryPublisher;
+  if(!jsonArg.getValue().empty())
+  {
+    //"tcp://lbne-moni:5000" is a test machine at UMD
+    jsonPublisher.reset(new SSPDAQ::TelemetryPublisher(zmq_context, jsonArg.getValue(), SSPDAQ::TelemetryPublisher::kJSON));
+    sink.AddPublisher(jsonPublisher.get());
+  }
+  if(!pubArg.getValue().empty())
+  {
+    binaryPublisher.reset(new SSPDAQ::TelemetryPublisher(zmq_context, pubArg.getValue()));
+    sink.AddPublisher(binaryPublisher.get());
+  }
   /* read values back from the registers and log the value to file */
   /* read values every x seconds. */
+  SSPDAQ::RegisterPoller poller;
+  poller.AddBoard(board_id, &dev);
+  poller.AddRegister(board_id, "mon_bias", 30000); /// in milliseconds
+  poller.AddRegister(board_id, "mon_value", 30000);
+  poller.AddRegister(board_id, "bias_readback", 30000);
+  poller.AddSink(&sink);
+  poller.Start();
   while(1)
   {
-    ReadbackAndLog(dev, outfn, zmq_socket);
-    usleep(30e6); /// in microseconds
+    pause();
   }
-  zmq_socket.close();
+  poller.Stop();
 }
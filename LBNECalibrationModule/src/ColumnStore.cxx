@@ -0,0 +1,387 @@
+#include "ColumnStore.h"
+#include "EventDecoder.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t SSPDAQ::ColumnWriter::bufferBytes;
+
+//==============================================================================
+// ColumnWriter
+//==============================================================================
+
+unsigned int SSPDAQ::ColumnElementSize(unsigned int type){
+  switch(type){
+  case kColUInt8: return 1;
+  case kColUInt16: case kColInt16: return 2;
+  case kColUInt32: case kColInt32: return 4;
+  case kColUInt64: return 8;
+  default: return 0;
+  }
+}
+
+SSPDAQ::ColumnWriter::ColumnWriter(std::string path, std::string name, ColumnType_t type,
+				   unsigned int width, unsigned int chunkRows):
+  fPath(path),
+  fRowBytes(ColumnElementSize(type)*width)
+{
+  fFile=fopen(path.c_str(),"wb");
+  if(!fFile){
+    SSPDAQ::Log::Error()<<"Couldn't create column file "<<path<<": "<<std::strerror(errno)<<std::endl;
+    throw(EFileError(""));
+  }
+
+  std::memset(&fHeader,0,sizeof(fHeader));
+  fHeader.magic=columnMagic;
+  fHeader.version=columnVersion;
+  fHeader.type=type;
+  fHeader.width=width;
+  fHeader.chunkRows=chunkRows;
+  std::strncpy(fHeader.name,name.c_str(),sizeof(fHeader.name)-1);
+
+  //Rewritten with the real row count on Close
+  fBuffer.reserve(bufferBytes+fRowBytes);
+  fBuffer.insert(fBuffer.end(),(const char*)&fHeader,(const char*)&fHeader+sizeof(fHeader));
+}
+
+SSPDAQ::ColumnWriter::~ColumnWriter(){
+  if(fFile){
+    //Close has already logged any failure; don't throw out of a destructor
+    try{
+      this->Close();
+    }
+    catch(EFileError&){
+    }
+  }
+}
+
+void SSPDAQ::ColumnWriter::AppendRaw(const void* data, size_t bytes){
+  fBuffer.insert(fBuffer.end(),(const char*)data,(const char*)data+bytes);
+  if(fBuffer.size()>=bufferBytes){
+    this->Flush();
+  }
+}
+
+void SSPDAQ::ColumnWriter::Flush(){
+  if(fBuffer.size()&&fwrite(&fBuffer[0],1,fBuffer.size(),fFile)!=fBuffer.size()){
+    SSPDAQ::Log::Error()<<"Failed writing column file "<<fPath<<": "<<std::strerror(errno)<<std::endl;
+    throw(EFileError(""));
+  }
+  fBuffer.clear();
+}
+
+void SSPDAQ::ColumnWriter::Close(){
+  this->Flush();
+  if(fseek(fFile,0,SEEK_SET)||fwrite(&fHeader,sizeof(fHeader),1,fFile)!=1||fclose(fFile)){
+    SSPDAQ::Log::Error()<<"Failed finishing column file "<<fPath<<": "<<std::strerror(errno)<<std::endl;
+    fFile=0;
+    throw(EFileError(""));
+  }
+  fFile=0;
+}
+
+//==============================================================================
+// EventStoreWriter
+//==============================================================================
+
+SSPDAQ::EventStoreWriter::EventStoreWriter(std::string directory, unsigned int chunkEvents):
+  fDirectory(directory),
+  fChunkEvents(std::max(chunkEvents,1u)),
+  fEvents(0),
+  fDuplicates(0),
+  fOpen(true),
+  fChunkSamples(0)
+{
+  if(mkdir(directory.c_str(),0755)&&errno!=EEXIST){
+    SSPDAQ::Log::Error()<<"Couldn't create column store "<<directory<<": "<<std::strerror(errno)<<std::endl;
+    throw(EFileError(""));
+  }
+
+  std::string base=directory+"/";
+  fModule.reset(new ColumnWriter(base+"module.col","module",kColUInt16));
+  fChannel.reset(new ColumnWriter(base+"channel.col","channel",kColUInt8));
+  fTimestamp.reset(new ColumnWriter(base+"timestamp.col","timestamp",kColUInt64));
+  fPeakSum.reset(new ColumnWriter(base+"peakSum.col","peakSum",kColInt32));
+  fPrerise.reset(new ColumnWriter(base+"prerise.col","prerise",kColUInt32));
+  fIntegratedSum.reset(new ColumnWriter(base+"integratedSum.col","integratedSum",kColUInt32));
+  fBaseline.reset(new ColumnWriter(base+"baseline.col","baseline",kColUInt16));
+  fCfdPoint.reset(new ColumnWriter(base+"cfdPoint.col","cfdPoint",kColInt16,4));
+  fWaveformOffset.reset(new ColumnWriter(base+"waveformOffset.col","waveformOffset",kColUInt64,1,fChunkEvents));
+}
+
+SSPDAQ::EventStoreWriter::~EventStoreWriter(){
+  if(fOpen){
+    try{
+      this->Close();
+    }
+    catch(EFileError&){
+      SSPDAQ::Log::Error()<<"Column store "<<fDirectory<<" was not closed cleanly"<<std::endl;
+    }
+  }
+}
+
+void SSPDAQ::EventStoreWriter::Add(const EventHeader& header, const unsigned short* samples, unsigned int nSamples){
+
+  if(fEvents%fChunkEvents==0){
+    this->StartChunk();
+  }
+
+  unsigned short module=Decode::ModuleID(header);
+  unsigned char channel=Decode::ChannelID(header);
+  unsigned long timestamp=Decode::InternalTimestamp(header);
+  int peakSum=Decode::PeakSum(header);
+  unsigned int prerise=Decode::Prerise(header);
+  unsigned int integratedSum=Decode::IntegratedSum(header);
+  unsigned short baseline=Decode::Baseline(header);
+
+  fModule->Append(&module);
+  fChannel->Append(&channel);
+  fTimestamp->Append(&timestamp);
+  fPeakSum->Append(&peakSum);
+  fPrerise->Append(&prerise);
+  fIntegratedSum->Append(&integratedSum);
+  fBaseline->Append(&baseline);
+  fCfdPoint->Append(header.cfdPoint);
+
+  fWaveformOffset->Append(&fChunkSamples);
+  fWaveform->AppendRaw(samples,nSamples*sizeof(unsigned short));
+  fChunkSamples+=nSamples;
+
+  ++fEvents;
+  if(fEvents%fChunkEvents==0){
+    this->EndChunk();
+  }
+}
+
+void SSPDAQ::EventStoreWriter::AddMillislice(const unsigned int* slice, size_t words){
+
+  if(words<MillisliceHeader::sizeInUInts){
+    return;
+  }
+  const MillisliceHeader& sliceHeader=*(const MillisliceHeader*)slice;
+  size_t sliceWords=std::min((size_t)sliceHeader.length,words);
+  if(sliceWords<MillisliceHeader::sizeInUInts){
+    return;
+  }
+  const unsigned int* data=slice+MillisliceHeader::sizeInUInts;
+  size_t dataWords=sliceWords-MillisliceHeader::sizeInUInts;
+
+  //Decode the header fields of the whole slice at once
+  DecoderConfig config={kInternalTime,TimingService::Transform(),true,0};
+  size_t n=SelectDecoder(config)(data,dataWords,config,fDecoded);
+
+  fOverlap.NextSlice(sliceHeader);
+  size_t decodedWords=0;
+  for(size_t i=0;i<n;++i){
+    const EventHeader& header=*(const EventHeader*)(data+fDecoded.offset[i]);
+    decodedWords=fDecoded.offset[i]+header.length;
+    if(fOverlap.IsCopy(header)){
+      ++fDuplicates;
+    }
+    else{
+      this->AddDecoded(data,i);
+    }
+  }
+  if(dataWords-decodedWords>=Decode::headerWords){
+    SSPDAQ::Log::Warning()<<"Bad event in millislice, skipping rest of slice"<<std::endl;
+  }
+}
+
+void SSPDAQ::EventStoreWriter::AddDecoded(const unsigned int* data, size_t i){
+
+  if(fEvents%fChunkEvents==0){
+    this->StartChunk();
+  }
+
+  const EventHeader& header=*(const EventHeader*)(data+fDecoded.offset[i]);
+  unsigned int nSamples=fDecoded.nSamples[i];
+
+  fModule->Append(&fDecoded.module[i]);
+  fChannel->Append(&fDecoded.channel[i]);
+  fTimestamp->Append(&fDecoded.timestamp[i]);
+  fPeakSum->Append(&fDecoded.peakSum[i]);
+  fPrerise->Append(&fDecoded.prerise[i]);
+  fIntegratedSum->Append(&fDecoded.integratedSum[i]);
+  fBaseline->Append(&fDecoded.baseline[i]);
+  fCfdPoint->Append(header.cfdPoint);
+
+  fWaveformOffset->Append(&fChunkSamples);
+  fWaveform->AppendRaw(&header+1,nSamples*sizeof(unsigned short));
+  fChunkSamples+=nSamples;
+
+  ++fEvents;
+  if(fEvents%fChunkEvents==0){
+    this->EndChunk();
+  }
+}
+
+void SSPDAQ::EventStoreWriter::Close(){
+  if(fWaveform){
+    this->EndChunk();
+  }
+  fModule->Close();
+  fChannel->Close();
+  fTimestamp->Close();
+  fPeakSum->Close();
+  fPrerise->Close();
+  fIntegratedSum->Close();
+  fBaseline->Close();
+  fCfdPoint->Close();
+  fWaveformOffset->Close();
+  fOpen=false;
+}
+
+void SSPDAQ::EventStoreWriter::StartChunk(){
+  char name[32];
+  snprintf(name,sizeof(name),"waveform_%04lu",fEvents/fChunkEvents);
+  fWaveform.reset(new ColumnWriter(fDirectory+"/"+name+".col",name,kColUInt16));
+  fChunkSamples=0;
+}
+
+void SSPDAQ::EventStoreWriter::EndChunk(){
+  //Mark end of last waveform in chunk
+  fWaveformOffset->Append(&fChunkSamples);
+  fWaveform->Close();
+  fWaveform.reset();
+}
+
+//==============================================================================
+// MappedColumn
+//==============================================================================
+
+SSPDAQ::MappedColumn::MappedColumn(std::string path):
+  fHeader(0),
+  fSize(0)
+{
+  int fd=open(path.c_str(),O_RDONLY);
+  struct stat info;
+  if(fd<0||fstat(fd,&info)){
+    SSPDAQ::Log::Error()<<"Couldn't open column file "<<path<<": "<<std::strerror(errno)<<std::endl;
+    if(fd>=0){
+      close(fd);
+    }
+    throw(EFileError(""));
+  }
+  fSize=info.st_size;
+
+  void* map=fSize>=sizeof(ColumnHeader)?mmap(0,fSize,PROT_READ,MAP_SHARED,fd,0):MAP_FAILED;
+  close(fd);
+  if(map==MAP_FAILED){
+    SSPDAQ::Log::Error()<<"Couldn't map column file "<<path<<std::endl;
+    throw(EFileError(""));
+  }
+  fHeader=(const ColumnHeader*)map;
+
+  if(fHeader->magic!=columnMagic||fHeader->version!=columnVersion){
+    SSPDAQ::Log::Error()<<path<<" is not a version "<<columnVersion<<" column file"<<std::endl;
+    munmap(map,fSize);
+    throw(EFileError(""));
+  }
+  if(sizeof(ColumnHeader)+fHeader->rows*fHeader->width*ColumnElementSize(fHeader->type)>fSize){
+    SSPDAQ::Log::Error()<<"Column file "<<path<<" is truncated"<<std::endl;
+    munmap(map,fSize);
+    throw(EFileError(""));
+  }
+
+  //Columns are almost always scanned front to back
+  madvise(map,fSize,MADV_SEQUENTIAL);
+}
+
+SSPDAQ::MappedColumn::~MappedColumn(){
+  munmap((void*)fHeader,fSize);
+}
+
+//==============================================================================
+// EventStoreReader
+//==============================================================================
+
+SSPDAQ::EventStoreReader::EventStoreReader(std::string directory):
+  fDirectory(directory)
+{
+  MappedColumn& offsets=this->Map("waveformOffset");
+  fChunkEvents=offsets.Header().chunkRows;
+  fEvents=this->Map("module").Rows();
+}
+
+void SSPDAQ::EventStoreReader::Waveform(unsigned long event, const unsigned short*& samples, unsigned int& nSamples){
+
+  if(event>=fEvents){
+    SSPDAQ::Log::Error()<<"No event "<<event<<" in store of "<<fEvents<<" events"<<std::endl;
+    throw(std::out_of_range(""));
+  }
+
+  unsigned long chunk=event/fChunkEvents;
+  const unsigned long* offsets=this->Column<unsigned long>("waveformOffset");
+
+  //Each chunk has one extra offset, for the end of its last waveform
+  unsigned long start=offsets[event+chunk];
+  unsigned long end=offsets[event+chunk+1];
+
+  char name[32];
+  snprintf(name,sizeof(name),"waveform_%04lu",chunk);
+  samples=this->Column<unsigned short>(name)+start;
+  nSamples=end-start;
+}
+
+SSPDAQ::MappedColumn& SSPDAQ::EventStoreReader::Map(std::string name){
+  std::unique_ptr<MappedColumn>& column=fColumns[name];
+  if(!column){
+    column.reset(new MappedColumn(fDirectory+"/"+name+".col"));
+  }
+  return *column;
+}
+
+//==============================================================================
+// Scans
+//==============================================================================
+
+unsigned long SSPDAQ::Scan::Count(const unsigned short* module, const unsigned char* channel, size_t n,
+				  unsigned int selectModule, unsigned int selectChannel){
+  unsigned long count=0;
+  for(size_t i=0;i<n;++i){
+    count+=(module[i]==selectModule)&(channel[i]==selectChannel);
+  }
+  return count;
+}
+
+void SSPDAQ::Scan::Range(const unsigned long* values, size_t n, unsigned long& lowest, unsigned long& highest){
+  unsigned long low=~0UL;
+  unsigned long high=0;
+  for(size_t i=0;i<n;++i){
+    low=values[i]<low?values[i]:low;
+    high=values[i]>high?values[i]:high;
+  }
+  lowest=low;
+  highest=high;
+}
+
+void SSPDAQ::Scan::Histogram(const int* values, size_t n, int low, int high, std::vector<unsigned long>& bins){
+
+  if(bins.empty()||high<=low){
+    return;
+  }
+  const double scale=(double)bins.size()/((double)high-low);
+  const int nBins=bins.size();
+
+  //Work out bin numbers a block at a time (this part vectorises), then fill
+  static const size_t blockSize=1024;
+  int index[blockSize];
+  for(size_t start=0;start<n;start+=blockSize){
+    size_t count=std::min(blockSize,n-start);
+    for(size_t i=0;i<count;++i){
+      double bin=((double)values[start+i]-low)*scale;
+      //Send out of range values to -1
+      index[i]=(bin>=0&&bin<nBins)?(int)bin:-1;
+    }
+    for(size_t i=0;i<count;++i){
+      if(index[i]>=0){
+	++bins[index[i]];
+      }
+    }
+  }
+}
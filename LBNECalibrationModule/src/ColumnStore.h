@@ -0,0 +1,254 @@
+#ifndef COLUMNSTORE_H__
+#define COLUMNSTORE_H__
+
+#include "anlTypes.h"
+#include "anlExceptions.h"
+#include "EventDecoder.h"
+#include "Log.h"
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Column-oriented store of SSP events for offline analysis. A store is a
+  //directory with one file per header field, so a scan only touches the fields
+  //it needs:
+  //  module (uint16), channel (uint8), timestamp (uint64, 48-bit internal),
+  //  peakSum (int32), prerise (uint32), integratedSum (uint32),
+  //  baseline (uint16), cfdPoint (4 x int16)
+  //Waveforms are kept apart in chunk files waveform_NNNN.col, each holding the
+  //samples of a fixed number of events back to back. waveformOffset (uint64)
+  //gives where each event starts in its chunk, with one extra entry per chunk
+  //marking its end.
+  //
+  //Each file is a ColumnHeader followed by the values, so it can be mapped
+  //straight into memory and used as an array.
+
+  static const unsigned int columnMagic=0x43505353; // "SSPC"
+  static const unsigned short columnVersion=1;
+
+  enum ColumnType_t{kColUInt8=1,kColUInt16=2,kColUInt32=3,kColUInt64=4,
+		    kColInt16=5,kColInt32=6};
+
+  //64 bytes, so that values start cache line aligned
+  struct ColumnHeader{
+    unsigned int magic;
+    unsigned short version;
+    unsigned short type;        // ColumnType_t
+    unsigned int width;         // values per row
+    unsigned int chunkRows;     // rows per chunk for chunked columns, otherwise 0
+    unsigned long long rows;
+    char name[40];
+  };
+
+  static_assert(sizeof(ColumnHeader)==64,"ColumnHeader must be 64 bytes");
+
+  //Bytes per value of a ColumnType_t (0 if unknown)
+  unsigned int ColumnElementSize(unsigned int type);
+
+  //Column type for each C++ type
+  template<typename T> struct ColumnTraits;
+  template<> struct ColumnTraits<unsigned char>{static const ColumnType_t type=kColUInt8;};
+  template<> struct ColumnTraits<unsigned short>{static const ColumnType_t type=kColUInt16;};
+  template<> struct ColumnTraits<unsigned int>{static const ColumnType_t type=kColUInt32;};
+  template<> struct ColumnTraits<unsigned long>{static const ColumnType_t type=kColUInt64;};
+  template<> struct ColumnTraits<short>{static const ColumnType_t type=kColInt16;};
+  template<> struct ColumnTraits<int>{static const ColumnType_t type=kColInt32;};
+
+  //Appends values to one column file, buffering writes
+  class ColumnWriter{
+
+  public:
+
+    ColumnWriter(std::string path, std::string name, ColumnType_t type,
+		 unsigned int width=1, unsigned int chunkRows=0);
+
+    //Closes if still open
+    ~ColumnWriter();
+
+    //Append one row (width values)
+    inline void Append(const void* values){
+      fBuffer.insert(fBuffer.end(),(const char*)values,(const char*)values+fRowBytes);
+      ++fHeader.rows;
+      if(fBuffer.size()>=bufferBytes){
+	this->Flush();
+      }
+    }
+
+    //Append raw values not counted as rows (waveform samples)
+    void AppendRaw(const void* data, size_t bytes);
+
+    //Write buffered values and fill in the final row count
+    void Close();
+
+  private:
+
+    void Flush();
+
+    static const size_t bufferBytes=1024*1024;
+
+    std::string fPath;
+
+    FILE* fFile;
+
+    ColumnHeader fHeader;
+
+    unsigned int fRowBytes;
+
+    std::vector<char> fBuffer;
+  };
+
+  //Converts events into a column store
+  class EventStoreWriter{
+
+  public:
+
+    //Creates directory if needed. Existing column files are overwritten.
+    explicit EventStoreWriter(std::string directory, unsigned int chunkEvents=65536);
+
+    ~EventStoreWriter();
+
+    //Add one event; samples is the waveform following the header
+    void Add(const EventHeader& header, const unsigned short* samples, unsigned int nSamples);
+
+    //Add every event in a millislice, as built by DeviceInterface. Slices must
+    //be added in order; events repeated from the overlap window of the
+    //previous slice are skipped (see SliceOverlap).
+    void AddMillislice(const unsigned int* slice, size_t words);
+
+    //Call before adding the slices of another file, which don't overlap those
+    //added so far
+    inline void StartFile(){fOverlap.Reset();}
+
+    void Close();
+
+    inline unsigned long Events() const{return fEvents;}
+
+    //Overlap events skipped by AddMillislice
+    inline unsigned long Duplicates() const{return fDuplicates;}
+
+  private:
+
+    //Add event i of fDecoded, decoded from data
+    void AddDecoded(const unsigned int* data, size_t i);
+
+    void StartChunk();
+
+    void EndChunk();
+
+    std::string fDirectory;
+
+    unsigned int fChunkEvents;
+
+    unsigned long fEvents;
+
+    unsigned long fDuplicates;
+
+    //Finds events repeated from the slice before in AddMillislice
+    SliceOverlap fOverlap;
+
+    //Header fields of the slice being added, reused for every slice
+    DecodedEvents fDecoded;
+
+    bool fOpen;
+
+    std::unique_ptr<ColumnWriter> fModule;
+    std::unique_ptr<ColumnWriter> fChannel;
+    std::unique_ptr<ColumnWriter> fTimestamp;
+    std::unique_ptr<ColumnWriter> fPeakSum;
+    std::unique_ptr<ColumnWriter> fPrerise;
+    std::unique_ptr<ColumnWriter> fIntegratedSum;
+    std::unique_ptr<ColumnWriter> fBaseline;
+    std::unique_ptr<ColumnWriter> fCfdPoint;
+    std::unique_ptr<ColumnWriter> fWaveformOffset;
+
+    //Current waveform chunk, and samples written to it so far
+    std::unique_ptr<ColumnWriter> fWaveform;
+    unsigned long fChunkSamples;
+  };
+
+  //Read-only memory map of one column file
+  class MappedColumn{
+
+  public:
+
+    //Throws EFileError if the file is missing or not a column
+    explicit MappedColumn(std::string path);
+
+    ~MappedColumn();
+
+    inline const ColumnHeader& Header() const{return *fHeader;}
+
+    inline const void* Data() const{return fHeader+1;}
+
+    inline unsigned long Rows() const{return fHeader->rows;}
+
+  private:
+
+    MappedColumn(const MappedColumn&);
+    MappedColumn& operator=(const MappedColumn&);
+
+    const ColumnHeader* fHeader;
+
+    size_t fSize;
+  };
+
+  //Gives access to the columns of a store as plain arrays. Files are mapped on
+  //first use, and pages are read in by the OS as they are touched.
+  class EventStoreReader{
+
+  public:
+
+    explicit EventStoreReader(std::string directory);
+
+    inline unsigned long Events() const{return fEvents;}
+
+    //Values of a column, width values per event. Throws EFileError if the column
+    //doesn't exist or doesn't hold type T.
+    template<typename T> const T* Column(std::string name){
+      MappedColumn& column=this->Map(name);
+      if(column.Header().type!=ColumnTraits<T>::type){
+	SSPDAQ::Log::Error()<<"Column "<<name<<" is type "<<column.Header().type<<", not "
+			    <<ColumnTraits<T>::type<<std::endl;
+	throw(EFileError(""));
+      }
+      return (const T*)column.Data();
+    }
+
+    //Waveform of an event
+    void Waveform(unsigned long event, const unsigned short*& samples, unsigned int& nSamples);
+
+  private:
+
+    MappedColumn& Map(std::string name);
+
+    std::string fDirectory;
+
+    unsigned long fEvents;
+
+    unsigned int fChunkEvents;
+
+    std::map<std::string,std::unique_ptr<MappedColumn> > fColumns;
+  };
+
+  //Scans over columns. Loops are branch free over contiguous arrays so that
+  //the compiler can vectorise them.
+  namespace Scan{
+
+    //Events with the given module and channel
+    unsigned long Count(const unsigned short* module, const unsigned char* channel, size_t n,
+			unsigned int selectModule, unsigned int selectChannel);
+
+    //Lowest and highest values
+    void Range(const unsigned long* values, size_t n, unsigned long& lowest, unsigned long& highest);
+
+    //Fill bins (which sets the number of bins) over [low,high). Values outside are ignored.
+    void Histogram(const int* values, size_t n, int low, int high, std::vector<unsigned long>& bins);
+
+  }//namespace Scan
+
+}//namespace
+#endif
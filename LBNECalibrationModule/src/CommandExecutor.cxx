@@ -0,0 +1,272 @@
+#include "CommandExecutor.h"
+#include "anlTypes.h"
+#include "Log.h"
+#include <algorithm>
+#include <stdexcept>
+
+SSPDAQ::CommandExecutor::CommandExecutor(Device* device):
+  fDevice(device),
+  fShouldStop(false),
+  fCommands(0),
+  fTransactions(0)
+{
+  fThread=std::thread(&SSPDAQ::CommandExecutor::Work,this);
+}
+
+SSPDAQ::CommandExecutor::~CommandExecutor(){
+  {
+    std::lock_guard<std::mutex> lock(fQueueMutex);
+    fShouldStop=true;
+  }
+  fQueueCondition.notify_one();
+  fThread.join();
+  SSPDAQ::Log::Debug()<<"Command executor ran "<<fCommands<<" commands in "
+		      <<fTransactions<<" transactions"<<std::endl;
+}
+
+std::future<unsigned int> SSPDAQ::CommandExecutor::Read(unsigned int address){
+  return this->ReadMask(address,0xFFFFFFFF);
+}
+
+std::future<unsigned int> SSPDAQ::CommandExecutor::ReadMask(unsigned int address, unsigned int mask){
+  std::shared_ptr<std::promise<unsigned int> > result=std::make_shared<std::promise<unsigned int> >();
+  Command command;
+  command.type=kRead;
+  command.address=address;
+  command.size=1;
+  command.mask=mask;
+  command.complete=[result,mask](const unsigned int* values, std::exception_ptr error){
+    if(error){
+      result->set_exception(error);
+    }
+    else{
+      result->set_value(values[0]&mask);
+    }
+  };
+  std::future<unsigned int> future=result->get_future();
+  this->Submit(command);
+  return future;
+}
+
+std::future<std::vector<unsigned int> > SSPDAQ::CommandExecutor::ReadArray(unsigned int address, unsigned int size){
+  std::shared_ptr<std::promise<std::vector<unsigned int> > > result=std::make_shared<std::promise<std::vector<unsigned int> > >();
+  Command command;
+  command.type=kRead;
+  command.address=address;
+  command.size=size;
+  command.mask=0xFFFFFFFF;
+  command.complete=[result,size](const unsigned int* values, std::exception_ptr error){
+    if(error){
+      result->set_exception(error);
+    }
+    else{
+      result->set_value(std::vector<unsigned int>(values,values+size));
+    }
+  };
+  std::future<std::vector<unsigned int> > future=result->get_future();
+  this->Submit(command);
+  return future;
+}
+
+void SSPDAQ::CommandExecutor::Read(unsigned int address, ReadCallback_t callback){
+  Command command;
+  command.type=kRead;
+  command.address=address;
+  command.size=1;
+  command.mask=0xFFFFFFFF;
+  command.complete=[callback](const unsigned int* values, std::exception_ptr error){
+    callback(error?0:values[0],error);
+  };
+  this->Submit(command);
+}
+
+std::future<void> SSPDAQ::CommandExecutor::Write(unsigned int address, unsigned int value){
+  return this->WriteArray(address,1,&value);
+}
+
+std::future<void> SSPDAQ::CommandExecutor::WriteMask(unsigned int address, unsigned int mask, unsigned int value){
+  std::shared_ptr<std::promise<void> > result=std::make_shared<std::promise<void> >();
+  Command command;
+  command.type=kWriteMask;
+  command.address=address;
+  command.size=1;
+  command.mask=mask;
+  command.values.assign(1,value);
+  command.complete=CompleteVoid(result);
+  std::future<void> future=result->get_future();
+  this->Submit(command);
+  return future;
+}
+
+std::future<void> SSPDAQ::CommandExecutor::WriteArray(unsigned int address, unsigned int size, const unsigned int* data){
+  std::shared_ptr<std::promise<void> > result=std::make_shared<std::promise<void> >();
+  Command command;
+  command.type=kWrite;
+  command.address=address;
+  command.size=size;
+  command.mask=0xFFFFFFFF;
+  command.values.assign(data,data+size);
+  command.complete=CompleteVoid(result);
+  std::future<void> future=result->get_future();
+  this->Submit(command);
+  return future;
+}
+
+std::future<void> SSPDAQ::CommandExecutor::Run(std::function<void(Device&)> task){
+  std::shared_ptr<std::promise<void> > result=std::make_shared<std::promise<void> >();
+  Command command;
+  command.type=kTask;
+  command.address=0;
+  command.size=0;
+  command.mask=0;
+  command.task=task;
+  command.complete=CompleteVoid(result);
+  std::future<void> future=result->get_future();
+  this->Submit(command);
+  return future;
+}
+
+SSPDAQ::CommandExecutor::Completion_t SSPDAQ::CommandExecutor::CompleteVoid(std::shared_ptr<std::promise<void> > result){
+  return [result](const unsigned int*, std::exception_ptr error){
+    if(error){
+      result->set_exception(error);
+    }
+    else{
+      result->set_value();
+    }
+  };
+}
+
+void SSPDAQ::CommandExecutor::Submit(Command& command){
+  std::unique_lock<std::mutex> lock(fQueueMutex);
+  if(fShouldStop){
+    lock.unlock();
+    SSPDAQ::Log::Error()<<"Command submitted to stopped command executor!"<<std::endl;
+    command.complete(0,std::make_exception_ptr(std::logic_error("")));
+    return;
+  }
+  fQueue.push_back(std::move(command));
+  lock.unlock();
+  fQueueCondition.notify_one();
+}
+
+void SSPDAQ::CommandExecutor::Work(){
+  std::vector<Command> commands;
+  while(true){
+    {
+      std::unique_lock<std::mutex> lock(fQueueMutex);
+      fQueueCondition.wait(lock,[this]{return fShouldStop||!fQueue.empty();});
+      if(fQueue.empty()){
+	return;
+      }
+      std::swap(commands,fQueue);
+    }
+    for(size_t i=0;i<commands.size();){
+      i=this->Execute(commands,i);
+    }
+    commands.clear();
+  }
+}
+
+size_t SSPDAQ::CommandExecutor::Execute(std::vector<Command>& commands, size_t begin){
+
+  Command& first=commands[begin];
+  size_t end=begin+1;
+  std::exception_ptr error;
+
+  //Words read, starting at first.address
+  std::vector<unsigned int> readValues;
+
+  try{
+    switch(first.type){
+
+    case kRead:{
+      //Take in following reads which start inside or just after this range
+      unsigned int stop=first.address+0x4*first.size;
+      for(;end<commands.size()&&commands[end].type==kRead;++end){
+	unsigned int nextStop=std::max(stop,commands[end].address+0x4*commands[end].size);
+	if(commands[end].address<first.address||commands[end].address>stop||
+	   (nextStop-first.address)/0x4>MAX_CTRL_DATA){
+	  break;
+	}
+	stop=nextStop;
+      }
+      readValues.resize((stop-first.address)/0x4);
+      if(readValues.size()==1){
+	fDevice->DeviceRead(first.address,&readValues[0]);
+      }
+      else if(readValues.size()>1){
+	fDevice->DeviceArrayRead(first.address,readValues.size(),&readValues[0]);
+      }
+      break;
+    }
+
+    case kWrite:{
+      //Append following writes which carry on from the end of this one
+      std::vector<unsigned int>& values=first.values;
+      for(;end<commands.size()&&commands[end].type==kWrite;++end){
+	if(commands[end].address!=first.address+0x4*values.size()||
+	   values.size()+commands[end].values.size()>MAX_CTRL_DATA){
+	  break;
+	}
+	values.insert(values.end(),commands[end].values.begin(),commands[end].values.end());
+      }
+      if(values.size()==1){
+	fDevice->DeviceWrite(first.address,values[0]);
+      }
+      else if(values.size()>1){
+	fDevice->DeviceArrayWrite(first.address,values.size(),&values[0]);
+      }
+      break;
+    }
+
+    case kWriteMask:{
+      //Later masked writes to the same word take precedence where masks overlap
+      unsigned int mask=first.mask;
+      unsigned int value=first.values[0]&first.mask;
+      for(;end<commands.size()&&commands[end].type==kWriteMask&&commands[end].address==first.address;++end){
+	value=(value&~commands[end].mask)|(commands[end].values[0]&commands[end].mask);
+	mask|=commands[end].mask;
+      }
+      fDevice->DeviceWriteMask(first.address,mask,value);
+      break;
+    }
+
+    case kTask:
+      first.task(*fDevice);
+      break;
+    }
+  }
+  catch(...){
+    error=std::current_exception();
+  }
+  ++fTransactions;
+
+  for(size_t i=begin;i<end;++i){
+    const unsigned int* values=0;
+    if(!error&&first.type==kRead){
+      values=readValues.data()+(commands[i].address-first.address)/0x4;
+    }
+    commands[i].complete(values,error);
+  }
+  fCommands+=end-begin;
+  return end;
+}
+
+void SSPDAQ::CommandBatch::Wait(){
+  std::exception_ptr error;
+  for(auto pending=fPending.begin();pending!=fPending.end();++pending){
+    try{
+      pending->get();
+    }
+    catch(...){
+      if(!error){
+	error=std::current_exception();
+      }
+    }
+  }
+  fPending.clear();
+  if(error){
+    std::rethrow_exception(error);
+  }
+}
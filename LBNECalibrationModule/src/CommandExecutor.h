@@ -0,0 +1,149 @@
+#ifndef COMMANDEXECUTOR_H__
+#define COMMANDEXECUTOR_H__
+
+#include "Device.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Owns the control channel of one board. Register operations can be submitted
+  //from any thread; a single worker thread, the only one to touch the control
+  //channel, carries them out in the order they were submitted.
+  //
+  //The SSP protocol allows one request in flight per channel, so rather than
+  //pipelining on the wire the worker takes everything queued when it wakes and
+  //merges neighbouring commands where the result is the same:
+  //  - reads of adjacent or overlapping words become one array read
+  //  - writes to consecutive words become one array write
+  //  - masked writes to the same word become one masked write
+  //A burst of requests from several threads then costs fewer round trips.
+  class CommandExecutor{
+
+  public:
+
+    //Device must be open, and must outlive the executor
+    CommandExecutor(Device* device);
+
+    //Completes all commands already submitted, then stops the worker
+    ~CommandExecutor();
+
+    std::future<unsigned int> Read(unsigned int address);
+
+    //Bits which are low in the mask read as zeros
+    std::future<unsigned int> ReadMask(unsigned int address, unsigned int mask);
+
+    std::future<std::vector<unsigned int> > ReadArray(unsigned int address, unsigned int size);
+
+    std::future<void> Write(unsigned int address, unsigned int value);
+
+    //Only bits which are high in the mask are changed
+    std::future<void> WriteMask(unsigned int address, unsigned int mask, unsigned int value);
+
+    std::future<void> WriteArray(unsigned int address, unsigned int size, const unsigned int* data);
+
+    //Read with a callback instead of a future. The callback runs on the worker
+    //thread and must not throw; if the read failed, error holds the exception
+    //and value is 0.
+    typedef std::function<void(unsigned int value, std::exception_ptr error)> ReadCallback_t;
+
+    void Read(unsigned int address, ReadCallback_t callback);
+
+    //Run task on the worker thread with sole use of the device, e.g. for flash
+    //operations or a read-modify-write which mustn't be interleaved with others
+    std::future<void> Run(std::function<void(Device&)> task);
+
+    //Commands completed, and the device transactions used for them
+    inline unsigned long Commands() const{return fCommands;}
+    inline unsigned long Transactions() const{return fTransactions;}
+
+  private:
+
+    enum Type_t{kRead,kWrite,kWriteMask,kTask};
+
+    //Called with the words read (or written), or with the error
+    typedef std::function<void(const unsigned int* values, std::exception_ptr error)> Completion_t;
+
+    struct Command{
+      Type_t type;
+      unsigned int address;
+      unsigned int size;
+      unsigned int mask;
+      std::vector<unsigned int> values; // to be written
+      std::function<void(Device&)> task;
+      Completion_t complete;
+    };
+
+    static Completion_t CompleteVoid(std::shared_ptr<std::promise<void> > result);
+
+    void Submit(Command& command);
+
+    //Thread function; runs commands until the executor is destroyed
+    void Work();
+
+    //Run the command at begin, merged with as many of those following it as
+    //possible, as one device transaction and complete them. Returns the index
+    //of the first command not run.
+    size_t Execute(std::vector<Command>& commands, size_t begin);
+
+    Device* fDevice;
+
+    std::vector<Command> fQueue;
+    std::mutex fQueueMutex;
+    std::condition_variable fQueueCondition;
+    bool fShouldStop;
+
+    std::atomic<unsigned long> fCommands;
+    std::atomic<unsigned long> fTransactions;
+
+    std::thread fThread;
+  };
+
+  //Queues writes on an executor without waiting for each one, then waits for
+  //them all together, e.g. for a configuration script
+  class CommandBatch{
+
+  public:
+
+    CommandBatch(CommandExecutor& executor):fExecutor(executor){}
+
+    void Write(unsigned int address, unsigned int value){
+      fPending.push_back(fExecutor.Write(address,value));
+    }
+
+    void WriteMask(unsigned int address, unsigned int mask, unsigned int value){
+      fPending.push_back(fExecutor.WriteMask(address,mask,value));
+    }
+
+    void WriteArray(unsigned int address, unsigned int size, const unsigned int* data){
+      fPending.push_back(fExecutor.WriteArray(address,size,data));
+    }
+
+    //Set or clear the bits which are high in mask
+    void Set(unsigned int address, unsigned int mask){
+      this->WriteMask(address,mask,0xFFFFFFFF);
+    }
+
+    void Clear(unsigned int address, unsigned int mask){
+      this->WriteMask(address,mask,0x00000000);
+    }
+
+    //Wait for everything queued so far, rethrowing the first error
+    void Wait();
+
+  private:
+
+    CommandExecutor& fExecutor;
+
+    std::vector<std::future<void> > fPending;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,204 @@
+#include "CounterHarvester.h"
+#include "RegMap.h"
+#include "anlExceptions.h"
+#include "Log.h"
+#include <sstream>
+
+namespace{
+
+  //Poll sample names for the counter blocks
+  const char* const kCountersName="harvest_event_counters";
+  const char* const kLinkErrorsName="harvest_link_errors";
+  const char* const kOverflowName="harvest_overflow_status";
+
+  //dropped_event_count up to the end of disc_count
+  const unsigned int kCountersAddress=SSPDAQ::RegMap::dropped_event_count.Address();
+  const unsigned int kCountersSize=(SSPDAQ::RegMap::disc_count.Address()+4*SSPDAQ::RegMap::disc_count.Size()
+				    -kCountersAddress)/4;
+
+  //codeErrCounts up to the end of dispErrCounts
+  const unsigned int kLinkErrorsAddress=SSPDAQ::RegMap::codeErrCounts.Address();
+  const unsigned int kLinkErrorsSize=(SSPDAQ::RegMap::dispErrCounts.Address()+4*SSPDAQ::RegMap::dispErrCounts.Size()
+				      -kLinkErrorsAddress)/4;
+
+  //Word of a register array element within the block starting at blockAddress
+  unsigned int Word(const SSPDAQ::Register& reg, unsigned int i, unsigned int blockAddress){
+    return (reg[i].Address()-blockAddress)/4;
+  }
+
+  //Counts since last poll, allowing for one wrap of the 32-bit counter
+  unsigned int Delta(const std::vector<unsigned int>& now, const std::vector<unsigned int>& last, unsigned int word){
+    return now[word]-last[word];
+  }
+
+  unsigned long SumDeltas(const std::vector<unsigned int>& now, const std::vector<unsigned int>& last,
+			  const SSPDAQ::Register& reg, unsigned int blockAddress){
+    unsigned long sum=0;
+    for(unsigned int i=0;i<reg.Size();++i){
+      sum+=Delta(now,last,Word(reg,i,blockAddress));
+    }
+    return sum;
+  }
+}
+
+void SSPDAQ::CounterHarvester::AddBoard(unsigned long boardId, SSPDAQ::DeviceInterface* device){
+  std::lock_guard<std::mutex> lock(fMutex);
+  if(fBoards.count(boardId)){
+    SSPDAQ::Log::Error()<<"Board "<<boardId<<" already added to CounterHarvester!"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  Board& board=fBoards[boardId];
+  board.device=device;
+  board.stats.periodInSeconds=0;
+  board.stats.polls=0;
+  board.stats.channels.assign(nChannels,ChannelStats());
+  board.stats.codeErrors=0;
+  board.stats.dispErrors=0;
+  board.stats.overflowStatus=0;
+}
+
+void SSPDAQ::CounterHarvester::AddTo(SSPDAQ::RegisterPoller& poller, unsigned int periodInms){
+  std::lock_guard<std::mutex> lock(fMutex);
+  for(auto board=fBoards.begin();board!=fBoards.end();++board){
+    poller.AddRegister(board->first,kCountersName,kCountersAddress,kCountersSize,periodInms);
+    poller.AddRegister(board->first,kLinkErrorsName,kLinkErrorsAddress,kLinkErrorsSize,periodInms);
+    poller.AddRegister(board->first,kOverflowName,SSPDAQ::RegMap::overflow_status,1,periodInms);
+  }
+  poller.AddSink(this);
+}
+
+bool SSPDAQ::CounterHarvester::GetStats(unsigned long boardId, BoardStats& stats) const{
+  std::lock_guard<std::mutex> lock(fMutex);
+  auto board=fBoards.find(boardId);
+  if(board==fBoards.end()){
+    SSPDAQ::Log::Error()<<"Attempt to get counter stats for unknown board "<<boardId<<std::endl;
+    throw(ENoSuchDevice(""));
+  }
+  if(board->second.stats.polls<2){
+    return false;
+  }
+  stats=board->second.stats;
+  return true;
+}
+
+void SSPDAQ::CounterHarvester::Consume(const std::vector<SSPDAQ::PollSample>& samples){
+
+  //Samples from one poll all come from the same board, but may be from a
+  //group of registers which doesn't include the counters
+  const PollSample* counters=0;
+  const PollSample* linkErrors=0;
+  const PollSample* overflow=0;
+  for(auto sample=samples.begin();sample!=samples.end();++sample){
+    if(sample->name==kCountersName){
+      counters=&*sample;
+    }
+    else if(sample->name==kLinkErrorsName){
+      linkErrors=&*sample;
+    }
+    else if(sample->name==kOverflowName){
+      overflow=&*sample;
+    }
+  }
+  if(!counters||!linkErrors||!overflow){
+    return;
+  }
+
+  BoardStats stats;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto board=fBoards.find(counters->board);
+    if(board==fBoards.end()){
+      return;
+    }
+    this->Update(board->second,*counters,*linkErrors,overflow->values[0]);
+    if(board->second.stats.polls<2||fPublishers.empty()){
+      return;
+    }
+    stats=board->second.stats;
+  }
+  this->Publish(counters->board,stats);
+}
+
+void SSPDAQ::CounterHarvester::Update(Board& board, const SSPDAQ::PollSample& counters,
+				      const SSPDAQ::PollSample& linkErrors, unsigned int overflowStatus){
+
+  //Taken as soon after the hardware read as possible
+  std::vector<unsigned long> read(nChannels);
+  for(unsigned int i=0;i<nChannels;++i){
+    read[i]=board.device->GetEventsRead(i);
+  }
+
+  BoardStats& stats=board.stats;
+  if(stats.overflowStatus!=overflowStatus&&overflowStatus){
+    SSPDAQ::Log::Warning()<<"Board "<<counters.board<<" overflow status is now 0x"<<std::hex
+			  <<overflowStatus<<std::dec<<std::endl;
+  }
+  stats.overflowStatus=overflowStatus;
+
+  //First poll is the baseline for everything that follows
+  if(stats.polls++>0){
+    const std::vector<unsigned int>& now=counters.values;
+    const std::vector<unsigned int>& last=board.lastCounters;
+    stats.periodInSeconds=std::chrono::duration<double>(counters.time-board.lastTime).count();
+    double period=stats.periodInSeconds>0?stats.periodInSeconds:1.;
+
+    for(unsigned int i=0;i<nChannels;++i){
+      ChannelStats& channel=stats.channels[i];
+      unsigned int accepted=Delta(now,last,Word(SSPDAQ::RegMap::accepted_event_count,i,kCountersAddress));
+      unsigned int dropped=Delta(now,last,Word(SSPDAQ::RegMap::dropped_event_count,i,kCountersAddress));
+      unsigned long eventsRead=read[i]-board.lastRead[i];
+
+      channel.accepted+=accepted;
+      channel.dropped+=dropped;
+      channel.read+=eventsRead;
+      channel.ahits+=Delta(now,last,Word(SSPDAQ::RegMap::ahit_count,i,kCountersAddress));
+      channel.discs+=Delta(now,last,Word(SSPDAQ::RegMap::disc_count,i,kCountersAddress));
+
+      channel.acceptedRate=accepted/period;
+      channel.droppedRate=dropped/period;
+      channel.readRate=eventsRead/period;
+      channel.liveFraction=accepted+dropped?(double)accepted/((double)accepted+dropped):1.;
+      //Events accepted before the first poll but read after it could make this negative
+      channel.readoutLoss=channel.accepted&&channel.read<channel.accepted?
+	1.-(double)channel.read/channel.accepted:0.;
+    }
+
+    stats.codeErrors+=SumDeltas(linkErrors.values,board.lastLinkErrors,SSPDAQ::RegMap::codeErrCounts,kLinkErrorsAddress);
+    stats.dispErrors+=SumDeltas(linkErrors.values,board.lastLinkErrors,SSPDAQ::RegMap::dispErrCounts,kLinkErrorsAddress);
+  }
+  else{
+    for(unsigned int i=0;i<nChannels;++i){
+      ChannelStats& channel=stats.channels[i];
+      channel.accepted=channel.dropped=channel.read=channel.ahits=channel.discs=0;
+      channel.acceptedRate=channel.droppedRate=channel.readRate=0.;
+      channel.liveFraction=1.;
+      channel.readoutLoss=0.;
+    }
+  }
+
+  stats.time=counters.time;
+  board.lastCounters=counters.values;
+  board.lastLinkErrors=linkErrors.values;
+  board.lastRead.swap(read);
+  board.lastTime=counters.time;
+}
+
+void SSPDAQ::CounterHarvester::Publish(unsigned long boardId, const BoardStats& stats){
+
+  for(auto publisher=fPublishers.begin();publisher!=fPublishers.end();++publisher){
+    for(unsigned int i=0;i<stats.channels.size();++i){
+      const ChannelStats& channel=stats.channels[i];
+      std::stringstream prefix;
+      prefix<<"ch"<<i<<"_";
+      (*publisher)->Add(prefix.str()+"live_fraction",channel.liveFraction);
+      (*publisher)->Add(prefix.str()+"readout_loss",channel.readoutLoss);
+      (*publisher)->Add(prefix.str()+"accepted_rate",channel.acceptedRate);
+      (*publisher)->Add(prefix.str()+"dropped_rate",channel.droppedRate);
+      (*publisher)->Add(prefix.str()+"read_rate",channel.readRate);
+    }
+    (*publisher)->Add("code_errors",stats.codeErrors);
+    (*publisher)->Add("disp_errors",stats.dispErrors);
+    (*publisher)->Add("overflow_status",stats.overflowStatus);
+    (*publisher)->Publish(boardId,stats.time);
+  }
+}
@@ -0,0 +1,100 @@
+#ifndef COUNTERHARVESTER_H__
+#define COUNTERHARVESTER_H__
+
+#include "RegisterPoller.h"
+#include "TelemetryPublisher.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Loss accounting during a run. Reads each board's hardware counters through
+  //a RegisterPoller, which uses the slow control path and leaves the data
+  //channel alone, and compares them with the events DeviceInterface has read out.
+  //
+  //The counters are read as three blocks per poll: the dropped, accepted, ahit
+  //and disc counters together, the Comm link error counters together, and
+  //overflow_status. All counts are differences from the first poll of a board,
+  //so the hardware counters needn't be reset at the start of a run.
+  //
+  //For each channel this gives:
+  //  - live fraction: accepted/(accepted+dropped), over the last poll period
+  //  - readout loss: fraction of accepted events not read out, since the first
+  //    poll. Events still in the board's FIFO count as lost until read, so this
+  //    is slightly high while events are flowing.
+  class CounterHarvester : public PollSink{
+
+  public:
+
+    static const unsigned int nChannels=12;
+
+    struct ChannelStats{
+      //Counts since the first poll
+      unsigned long accepted;
+      unsigned long dropped;
+      unsigned long read; // by DeviceInterface
+      unsigned long ahits;
+      unsigned long discs;
+      //Rates over the last poll period, in Hz
+      double acceptedRate;
+      double droppedRate;
+      double readRate;
+      double liveFraction;
+      double readoutLoss;
+    };
+
+    struct BoardStats{
+      std::chrono::system_clock::time_point time; // of the last poll
+      double periodInSeconds;                     // covered by the rates
+      unsigned long polls;
+      std::vector<ChannelStats> channels;
+      unsigned long codeErrors; // Comm link errors since the first poll
+      unsigned long dispErrors;
+      unsigned int overflowStatus; // as last read
+    };
+
+    //Device must be the one the poller reads for this board, and must outlive the harvester
+    void AddBoard(unsigned long boardId, DeviceInterface* device);
+
+    //Poll the counters of every board added so far, and take the results.
+    //The boards must already have been added to the poller.
+    void AddTo(RegisterPoller& poller, unsigned int periodInms);
+
+    //Publish every board's stats after each poll. Publisher must outlive the harvester.
+    void AddPublisher(TelemetryPublisher* publisher){fPublishers.push_back(publisher);}
+
+    //Latest stats for a board. Returns false until the board has been polled twice.
+    bool GetStats(unsigned long boardId, BoardStats& stats) const;
+
+    virtual void Consume(const std::vector<PollSample>& samples);
+
+  private:
+
+    struct Board{
+      DeviceInterface* device;
+      //Values at the last poll. Counts are accumulated from the differences,
+      //so 32-bit hardware counters may wrap between polls.
+      std::vector<unsigned int> lastCounters;
+      std::vector<unsigned int> lastLinkErrors;
+      std::vector<unsigned long> lastRead;
+      std::chrono::system_clock::time_point lastTime;
+      BoardStats stats;
+    };
+
+    void Update(Board& board, const PollSample& counters, const PollSample& linkErrors,
+		unsigned int overflowStatus);
+
+    void Publish(unsigned long boardId, const BoardStats& stats);
+
+    std::map<unsigned long,Board> fBoards;
+
+    std::vector<TelemetryPublisher*> fPublishers;
+
+    //Consume runs on poller threads, GetStats on any other
+    mutable std::mutex fMutex;
+  };
+
+}//namespace
+#endif
@@ -46,6 +46,14 @@ class Device{
   //Read data into vector, up to defined size
   virtual void DeviceReceive(std::vector<unsigned int>& data, unsigned int size) = 0;
 
+  //Drop data from the data channel, up to defined size, returning the number of words dropped.
+  //Derived classes should override this to skip the data without copying it anywhere.
+  virtual unsigned int DeviceDiscard(unsigned int size){
+    std::vector<unsigned int> data;
+    this->DeviceReceive(data,size);
+    return data.size();
+  }
+
   //============================//
   //Read from/write to registers//
   //============================//
@@ -2,14 +2,23 @@
 #include "anlExceptions.h"
 #include "Log.h"
 #include "RegMap.h"
+#include "EventDecoder.h"
+#include <algorithm>
 #include <time.h>
 #include <utility>
 
 SSPDAQ::DeviceInterface::DeviceInterface(SSPDAQ::Comm_t commType, unsigned long deviceId)
   : fCommType(commType), fDeviceId(deviceId), fState(SSPDAQ::DeviceInterface::kUninitialized),
+    fEventPoolSize(4096), fSliceAllocations(0),
     fMillisliceLength(1E8), fMillisliceOverlap(1E7), fUseExternalTimestamp(false),
-    fHardwareClockRateInMHz(128), fEmptyWriteDelayInus(1000000), fSlowControlOnly(false){
+    fHardwareClockRateInMHz(150), fEmptyWriteDelayInus(1000000), fSlowControlOnly(false), fCapture(0), fClock(0),
+    fReadoutMode(SSPDAQ::kFullReadout), fMinPeakSum(0), fWaveformsDropped(0), fEventsFiltered(0){
   fReadThread=0;
+  for(unsigned int i=0;i<maxChannelIds;++i){
+    fEventsRead[i]=0;
+    fWaveformPrescale[i]=1;
+    fPrescaleCount[i]=0;
+  }
 }
 
 void SSPDAQ::DeviceInterface::OpenSlowControl(){
@@ -18,7 +27,7 @@ void SSPDAQ::DeviceInterface::OpenSlowControl(){
 
   SSPDAQ::Device* device=0;
 
-  SSPDAQ::Log::Info()<<"Opening "<<((fCommType==SSPDAQ::kUSB)?"USB":((fCommType==SSPDAQ::kEthernet)?"Ethernet":"Emulated"))
+  SSPDAQ::Log::Info()<<"Opening "<<((fCommType==SSPDAQ::kUSB)?"USB":((fCommType==SSPDAQ::kEthernet)?"Ethernet":((fCommType==SSPDAQ::kReplay)?"Replay":"Emulated")))
 		     <<" device #"<<fDeviceId<<" for slow control only..."<<std::endl;
   
   device=devman.OpenDevice(fCommType,fDeviceId,true);
@@ -29,6 +38,7 @@ void SSPDAQ::DeviceInterface::OpenSlowControl(){
   }
 
   fDevice=device;
+  fExecutor.reset(new SSPDAQ::CommandExecutor(fDevice));
   fSlowControlOnly=true;
 }
 
@@ -39,7 +49,7 @@ void SSPDAQ::DeviceInterface::Initialize(){
 
   SSPDAQ::Device* device=0;
 
-  SSPDAQ::Log::Info()<<"Initializing "<<((fCommType==SSPDAQ::kUSB)?"USB":((fCommType==SSPDAQ::kEthernet)?"Ethernet":"Emulated"))
+  SSPDAQ::Log::Info()<<"Initializing "<<((fCommType==SSPDAQ::kUSB)?"USB":((fCommType==SSPDAQ::kEthernet)?"Ethernet":((fCommType==SSPDAQ::kReplay)?"Replay":"Emulated")))
 		     <<" device #"<<fDeviceId<<"..."<<std::endl;
   
   device=devman.OpenDevice(fCommType,fDeviceId);
@@ -50,6 +60,7 @@ void SSPDAQ::DeviceInterface::Initialize(){
   }
 
   fDevice=device;
+  fExecutor.reset(new SSPDAQ::CommandExecutor(fDevice));
 
   //Put device into sensible state
   this->Stop();
@@ -69,19 +80,36 @@ void SSPDAQ::DeviceInterface::Stop(){
       
   fShouldStop=true;
 
+  //Don't leave the read thread waiting for room in the queue
+  fQueue.Interrupt();
+  fRing.Interrupt();
+
   if(fReadThread){
     fReadThread->join();
     fReadThread.reset();
+    //Get the read thread's queued messages out before ours
+    SSPDAQ::Log::Flush();
     SSPDAQ::Log::Info()<<"Read thread terminated"<<std::endl;
+    SSPDAQ::Log::Info()<<"Readout made "<<fEventPool.Allocations()<<" event and "<<fSliceAllocations
+		       <<" millislice allocations during run"<<std::endl;
+    SSPDAQ::MillisliceQueue::Stats queueStats=fQueue.GetStats();
+    SSPDAQ::Log::Info()<<"Millislice queue: "<<queueStats.pushed<<" queued, "<<queueStats.dropped<<" dropped, peak "
+		       <<queueStats.highWaterSlices<<" slices / "<<queueStats.highWaterBytes<<" bytes, blocked "
+		       <<queueStats.blockedInus/1000<<"ms"<<std::endl;
+    if(fRing.Published()){
+      SSPDAQ::Log::Info()<<"Millislice ring: "<<fRing.Published()<<" published, "<<fRing.Dropped()<<" dropped"<<std::endl;
+    }
   }  
 
-  fDevice->DeviceWrite(lbneReg.eventDataControl, 0x0013001F);
-  fDevice->DeviceClear(lbneReg.master_logic_control, 0x00000001);
+  SSPDAQ::CommandBatch batch(*fExecutor);
+  batch.Write(lbneReg.eventDataControl, 0x0013001F);
+  batch.Clear(lbneReg.master_logic_control, 0x00000001);
   // Clear the FIFOs
-  fDevice->DeviceWrite(lbneReg.fifo_control, 0x08000000);
-  fDevice->DeviceWrite(lbneReg.PurgeDDR, 0x00000001);
+  batch.Write(lbneReg.fifo_control, 0x08000000);
+  batch.Write(lbneReg.PurgeDDR, 0x00000001);
   // Reset the links and flags				
-  fDevice->DeviceWrite(lbneReg.event_data_control, 0x00020001);
+  batch.Write(lbneReg.event_data_control, 0x00020001);
+  batch.Wait();
   // Flush RX buffer
   fDevice->DevicePurgeData();
   SSPDAQ::Log::Info()<<"Hardware set to stopped state"<<std::endl;
@@ -107,40 +135,87 @@ void SSPDAQ::DeviceInterface::Start(){
 
   SSPDAQ::Log::Info()<<"Device interface starting run"<<std::endl;
   SSPDAQ::RegMap& lbneReg=SSPDAQ::RegMap::Get();
+
+  //Size event buffers from the longest readout window (two samples per word),
+  //so that the read thread doesn't need to allocate any
+  std::vector<unsigned int> readoutWindow;
+  this->ReadRegisterArrayByName("readout_window",readoutWindow);
+  unsigned int maxWindow=*std::max_element(readoutWindow.begin(),readoutWindow.end());
+  fEventPool.Prepare((maxWindow+1)/2,fEventPoolSize);
+
+  //Events are all the same length if every channel has the same window
+  unsigned int minWindow=*std::min_element(readoutWindow.begin(),readoutWindow.end());
+  fDecoderConfig.timeMode=fClock?SSPDAQ::kUnifiedTime:(fUseExternalTimestamp?SSPDAQ::kExternalTime:SSPDAQ::kInternalTime);
+  //The transform is filled in when the config is asked for, as it changes during the run
+  fDecoderConfig.transform=SSPDAQ::TimingService::Transform();
+  fDecoderConfig.allFields=true;
+  fDecoderConfig.fixedLength=(minWindow==maxWindow&&maxWindow)?SSPDAQ::Decode::headerWords+maxWindow/2:0;
+  if(fReadoutMode==SSPDAQ::kHeadersOnly){
+    fDecoderConfig.fixedLength=SSPDAQ::Decode::headerWords;
+  }
+  else if(fReadoutMode!=SSPDAQ::kFullReadout){
+    fDecoderConfig.fixedLength=0;
+  }
+  for(unsigned int i=0;i<maxChannelIds;++i){
+    fPrescaleCount[i]=0;
+  }
+  fWaveformsDropped=0;
+  fEventsFiltered=0;
+  fReadBuffer.reserve(sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int));
+  fSliceAllocations=0;
+  SSPDAQ::Log::Debug()<<"Prepared "<<fEventPoolSize<<" event buffers of "<<(maxWindow+1)/2<<" words"<<std::endl;
   // This script enables all logic and FIFOs and starts data acquisition in the device
   // Operations MUST be performed in this order
   
   //Load window settings and bias voltage into channels
-  fDevice->DeviceWrite(lbneReg.channel_pulsed_control, 0x1);
-  fDevice->DeviceWrite(lbneReg.bias_control, 0x1);
-  fDevice->DeviceWriteMask(lbneReg.mon_control, 0x1, 0x1);
+  SSPDAQ::CommandBatch batch(*fExecutor);
+  batch.Write(lbneReg.channel_pulsed_control, 0x1);
+  batch.Write(lbneReg.bias_control, 0x1);
+  batch.WriteMask(lbneReg.mon_control, 0x1, 0x1);
 
-  fDevice->DeviceWrite(lbneReg.event_data_control, 0x00000000);
+  batch.Write(lbneReg.event_data_control, 0x00000000);
   // Release the FIFO reset						
-  fDevice->DeviceWrite(lbneReg.fifo_control, 0x00000000);
+  batch.Write(lbneReg.fifo_control, 0x00000000);
   // Registers in the Zynq FPGA (Comm)
   // Reset the links and flags (note eventDataControl!=event_data_control)
-  fDevice->DeviceWrite(lbneReg.eventDataControl, 0x00000000);
+  batch.Write(lbneReg.eventDataControl, 0x00000000);
   // Registers in the Artix FPGA (DSP)
   // Release master logic reset & enable active channels
-  fDevice->DeviceWrite(lbneReg.master_logic_control, 0x00000001);
+  batch.Write(lbneReg.master_logic_control, 0x00000001);
+  batch.Wait();
 
   fShouldStop=false;
+  fQueue.Resume();
+  fQueue.ResetWaterMarks();
+  fRing.Resume();
   fState=SSPDAQ::DeviceInterface::kRunning;
   SSPDAQ::Log::Debug()<<"Device interface starting read thread...";
 
-  fReadThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::DeviceInterface::ReadEvents,this));
+  //Decide how to find event times once, rather than for every event
+  if(fClock){
+    fReadThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::DeviceInterface::ReadEvents<SSPDAQ::Decode::FittedTime>,
+							     this,SSPDAQ::Decode::FittedTime(fClock)));
+  }
+  else if(fUseExternalTimestamp){
+    fReadThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::DeviceInterface::ReadEvents<SSPDAQ::Decode::ExternalTime>,
+							     this,SSPDAQ::Decode::ExternalTime()));
+  }
+  else{
+    fReadThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::DeviceInterface::ReadEvents<SSPDAQ::Decode::InternalTime>,
+							     this,SSPDAQ::Decode::InternalTime()));
+  }
   SSPDAQ::Log::Info()<<"Run started!"<<std::endl;
 }
 
-void SSPDAQ::DeviceInterface::ReadEvents(){
+template<class Time> void SSPDAQ::DeviceInterface::ReadEvents(Time time){
 
   if(fState!=kRunning){
     SSPDAQ::Log::Warning()<<"Attempt to get data from non-running device refused!"<<std::endl;
     return;
   }
 
-  bool useExternalTimestamp=fUseExternalTimestamp;
+  //Rate of the clock slices are built in
+  double clockRateInMHz=fClock?fClock->SharedClockRateInMHz():fHardwareClockRateInMHz;
   bool hasSeenEvent=false;
   unsigned int discardedEvents=0;
   //REALLY needs to be set up to know real run start time.
@@ -161,15 +236,20 @@ void SSPDAQ::DeviceInterface::ReadEvents(){
   std::vector<SSPDAQ::EventPacket> events_thisSlice;
   std::vector<SSPDAQ::EventPacket> events_nextSlice;
 
+  //Reused for every event; its payload buffer comes from fEventPool
+  SSPDAQ::EventPacket event;
+
   //Check whether other thread has set the stop flag
   //Really need to know the timestamp at which to stop so we build the
   //same total number of slices as the other generators
   while(!fShouldStop){
-    SSPDAQ::EventPacket event;
     //Ask for event and check that one was returned.
     //ReadEventFromDevice Will return an empty packet with header word set to 0xDEADBEEF
     //if there was no event to read from the SSP.
-    this->ReadEventFromDevice(event);
+    //Events rejected by the filter come back as just a header. They aren't
+    //put in any slice, but their times still close slices as they go by, so
+    //that a board whose events are all rejected still sends slices on time.
+    bool accepted=this->ReadEventFromDevice(event);
 
     //If there is no event, sleep for a bit and try again
     if(event.header.header!=0xAAAAAAAA){
@@ -181,39 +261,34 @@ void SSPDAQ::DeviceInterface::ReadEvents(){
       //This stops the aggregator waiting indefinitely for a fragment.
       if(sleepTime>fEmptyWriteDelayInus&&hasSeenEvent){	
 	if(!haveWarnedNoEvents){
-	  SSPDAQ::Log::Warning()<<"Warning: DeviceInterface is seeing no events, starting to write empty slices"<<std::endl;
+	  SSPDAQ_LOG(SSPDAQ::Log::kWarning)<<"Warning: DeviceInterface is seeing no events, starting to write empty slices"<<std::endl;
 	  haveWarnedNoEvents=true;
 	}
 	//Write a full or empty millislice
 	if(events_thisSlice.size()){
 	  this->BuildMillislice(events_thisSlice,millisliceStartTime,millisliceStartTime+millisliceLengthInTicks+millisliceOverlapInTicks);
-	  events_thisSlice.clear();
+	  fEventPool.Release(events_thisSlice);
 	}
 	else{
 	  this->BuildEmptyMillislice(millisliceStartTime,millisliceStartTime+millisliceLengthInTicks+millisliceOverlapInTicks);
 	}
 	++millisliceCount;
 	millisliceStartTime+=millisliceLengthInTicks;
-	sleepTime-=1./fHardwareClockRateInMHz*fMillisliceLength;
+	sleepTime-=1./clockRateInMHz*fMillisliceLength;
       }
       continue;
     }
     sleepTime=0;
     haveWarnedNoEvents=false;
 
-    //Convert unsigned shorts into 1*unsigned long event timestamp
-    unsigned long eventTime=0;
-    if(useExternalTimestamp){
-      for(unsigned int iWord=0;iWord<=3;++iWord){
-	eventTime+=((unsigned long)(event.header.timestamp[iWord]))<<16*iWord;
-      }
-    }
-    else{
-      for(unsigned int iWord=1;iWord<=3;++iWord){
-	eventTime+=((unsigned long)(event.header.intTimestamp[iWord]))<<16*(iWord-1);
-      }
+    //Only this thread writes the counts, so a plain load and store is enough.
+    //Rejected events were counted when they were read.
+    if(accepted){
+      std::atomic<unsigned long>& eventsRead=fEventsRead[SSPDAQ::Decode::ChannelID(event.header)];
+      eventsRead.store(eventsRead.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
     }
-    
+
+    unsigned long eventTime=time(event.header);
 
     //Deal with stuff for first event
     if(!hasSeenEvent){
@@ -233,15 +308,15 @@ void SSPDAQ::DeviceInterface::ReadEvents(){
 	  //It's bad if we didn't discard any events since this might mean the
 	  //hardware was not ready at the defined start time
 	  if(discardedEvents==0){
-	    SSPDAQ::Log::Warning()<<"Warning: SSP daq did not see any events before start time"
-				  <<" - may have missed first valid events!"<<std::endl;
+	    SSPDAQ_LOG(SSPDAQ::Log::kWarning)<<"Warning: SSP daq did not see any events before start time"
+					     <<" - may have missed first valid events!"<<std::endl;
 	  }
 	  hasSeenEvent=true;
 	}
       }
     }
 
-    SSPDAQ::Log::Debug()<<"Interface got event with timestamp "<<eventTime<<"("<<(eventTime-runStartTime)/150E6<<"s from run start)"<<std::endl;
+    SSPDAQ_LOG(SSPDAQ::Log::kTrace)<<"Interface got event with timestamp "<<eventTime<<"("<<(eventTime-runStartTime)/(clockRateInMHz*1E6)<<"s from run start)"<<std::endl;
     if(eventTime<millisliceStartTime){
       SSPDAQ::Log::Error()<<"Error: Event seen with timestamp less than start of current slice!"<<std::endl;
       throw(EEventReadError("Bad timestamp"));
@@ -249,21 +324,25 @@ void SSPDAQ::DeviceInterface::ReadEvents(){
     //Event fits into the current slice
     //Add to current slice only
     if(eventTime<millisliceStartTime+millisliceLengthInTicks){
-      events_thisSlice.push_back(std::move(event));
+      if(accepted){
+	events_thisSlice.push_back(std::move(event));
+      }
     }
     //Event is in next slice, but in the overlap window of the current slice
     //Add to both slices
     else if(eventTime<millisliceStartTime+millisliceLengthInTicks+millisliceOverlapInTicks){
-      events_thisSlice.push_back(std::move(event));
-      events_nextSlice.push_back(events_thisSlice.back());
+      if(accepted){
+	events_thisSlice.push_back(std::move(event));
+	this->DuplicateEvent(events_thisSlice.back(),events_nextSlice);
+      }
     }
     //Event is not in overlap window of current slice
     else{
-      SSPDAQ::Log::Debug()<<"Device interface building millislice with "<<events_thisSlice.size()<<" events"<<std::endl;
+      SSPDAQ_LOG(SSPDAQ::Log::kDebug)<<"Device interface building millislice with "<<events_thisSlice.size()<<" events"<<std::endl;
       //Build a millislice based on the existing events
       //and swap next-slice event list into current-slice list
       this->BuildMillislice(events_thisSlice,millisliceStartTime,millisliceStartTime+millisliceLengthInTicks+millisliceOverlapInTicks);
-      events_thisSlice.clear();
+      fEventPool.Release(events_thisSlice);
       std::swap(events_thisSlice,events_nextSlice);
       millisliceStartTime+=millisliceLengthInTicks;
       ++millisliceCount;
@@ -273,7 +352,7 @@ void SSPDAQ::DeviceInterface::ReadEvents(){
 	//Write next millislice if it is not empty (i.e. there were some events in overlap period)
 	if(events_thisSlice.size()){
 	  this->BuildMillislice(events_thisSlice,millisliceStartTime,millisliceStartTime+millisliceLengthInTicks+millisliceOverlapInTicks);
-	  events_thisSlice.clear();
+	  fEventPool.Release(events_thisSlice);
 	}
 	//Then just write empty millislices until we get to the slice which contains this event
 	else{
@@ -284,10 +363,12 @@ void SSPDAQ::DeviceInterface::ReadEvents(){
       }
 
       //Start collecting events into the next non-empty slice
-      events_thisSlice.push_back(std::move(event));
-      //If this event is in overlap period put it into both slices
-      if(eventTime>millisliceStartTime+millisliceLengthInTicks){
-	events_nextSlice.push_back(events_thisSlice.back());
+      if(accepted){
+	events_thisSlice.push_back(std::move(event));
+	//If this event is in overlap period put it into both slices
+	if(eventTime>millisliceStartTime+millisliceLengthInTicks){
+	  this->DuplicateEvent(events_thisSlice.back(),events_nextSlice);
+	}
       }
     }
   }
@@ -315,12 +396,23 @@ void SSPDAQ::DeviceInterface::BuildMillislice(const std::vector<EventPacket>& ev
   sliceHeader.nTriggers=events.size();
   sliceHeader.startTime=startTime;
   sliceHeader.endTime=endTime;
+  sliceHeader.flags=((fReadoutMode<<SSPDAQ::MillisliceHeader::kReadoutModeShift)&SSPDAQ::MillisliceHeader::kReadoutModeMask)|
+    ((fDecoderConfig.timeMode<<SSPDAQ::MillisliceHeader::kTimeBaseShift)&SSPDAQ::MillisliceHeader::kTimeBaseMask);
+  sliceHeader.nDroppedSlices=0;
 
   //=================================================//
   //Allocate space for whole slice and fill with data//
   //=================================================//
 
-  std::vector<unsigned int> sliceData(dataSizeInWords);
+  //Reuse a slice vector handed back by the consumer if there is one
+  std::vector<unsigned int> sliceData;
+  fSpareSlices.try_pop(sliceData,std::chrono::microseconds(0));
+  if(sliceData.capacity()<dataSizeInWords){
+    //Leave some headroom so that slightly bigger slices fit next time
+    sliceData.reserve(dataSizeInWords+dataSizeInWords/4);
+    ++fSliceAllocations;
+  }
+  sliceData.resize(dataSizeInWords);
 
   static unsigned int headerSizeInWords=
     sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int);   //Size of DAQ event header
@@ -349,8 +441,19 @@ void SSPDAQ::DeviceInterface::BuildMillislice(const std::vector<EventPacket>& ev
   //Add millislice to queue//
   //=======================//
 
-  SSPDAQ::Log::Debug()<<"Pushing slice with "<<events.size()<<" triggers onto queue!"<<std::endl;
-  fQueue.push(std::move(sliceData));
+  SSPDAQ_LOG(SSPDAQ::Log::kDebug)<<"Pushing slice with "<<events.size()<<" triggers onto queue!"<<std::endl;
+  if(fRing.HasConsumers()){
+    fRing.Publish(sliceData);
+  }
+  else{
+    fQueue.Push(sliceData);
+  }
+
+  //Whatever was handed back (a dropped or retired slice, or nothing) can be reused
+  if(sliceData.capacity()&&fSpareSlices.size()<maxSpareSlices){
+    sliceData.clear();
+    fSpareSlices.push(std::move(sliceData));
+  }
 }
 
 void SSPDAQ::DeviceInterface::BuildEmptyMillislice(unsigned long startTime, unsigned long endTime){
@@ -358,19 +461,93 @@ void SSPDAQ::DeviceInterface::BuildEmptyMillislice(unsigned long startTime, unsi
   this->BuildMillislice(emptySlice,startTime,endTime);
 }
 
+void SSPDAQ::DeviceInterface::DuplicateEvent(const SSPDAQ::EventPacket& event, std::vector<SSPDAQ::EventPacket>& events){
+  events.push_back(SSPDAQ::EventPacket());
+  SSPDAQ::EventPacket& copy=events.back();
+  fEventPool.Acquire(copy,event.data.size());
+  copy.header=event.header;
+  copy.data.assign(event.data.begin(),event.data.end());
+}
+
 void SSPDAQ::DeviceInterface::GetMillislice(std::vector<unsigned int>& sliceData){
-  fQueue.try_pop(sliceData,std::chrono::microseconds(100000)); //Try to pop from queue for 100ms
+  //Take back the caller's previous slice so its storage can be reused
+  if(sliceData.capacity()&&fSpareSlices.size()<maxSpareSlices){
+    fSpareSlices.push(std::move(sliceData));
+  }
+  sliceData.clear();
+  fQueue.TryPop(sliceData,std::chrono::microseconds(100000)); //Try to pop from queue for 100ms
 }
 
-void SSPDAQ::DeviceInterface::ReadEventFromDevice(EventPacket& event){
+std::shared_ptr<SSPDAQ::MillisliceRing::Consumer> SSPDAQ::DeviceInterface::AddSliceConsumer(bool mandatory){
+  SSPDAQ::Log::Info()<<"Adding "<<(mandatory?"mandatory":"optional")<<" millislice consumer"<<std::endl;
+  return fRing.AddConsumer(mandatory);
+}
+
+void SSPDAQ::DeviceInterface::Receive(std::vector<unsigned int>& data, unsigned int size){
+  fDevice->DeviceReceive(data,size);
+  if(fCapture&&!data.empty()){
+    fCapture->Write(&data[0],data.size());
+  }
+}
+
+void SSPDAQ::DeviceInterface::Discard(unsigned int size){
+  unsigned int discarded=0;
+  if(fCapture){
+    this->Receive(fReadBuffer,size);
+    discarded=fReadBuffer.size();
+  }
+  else{
+    //Every call drops something while data is queued, so this only repeats if the
+    //device hands out less than asked for
+    while(discarded<size){
+      unsigned int dropped=fDevice->DeviceDiscard(size-discarded);
+      if(!dropped){
+	break;
+      }
+      discarded+=dropped;
+    }
+  }
+
+  if(discarded!=size){
+    SSPDAQ::Log::Error()<<"SSP returned truncated event even though FIFO queue is of sufficient length! ("
+			<<discarded<<" of "<<size<<" words dropped)"<<std::endl;
+    throw(EEventReadError());
+  }
+}
+
+bool SSPDAQ::DeviceInterface::KeepWaveform(const EventHeader& header){
+  switch(fReadoutMode){
+  case SSPDAQ::kHeadersOnly:
+    return false;
+  case SSPDAQ::kPrescaledWaveforms:{
+    unsigned int channel=SSPDAQ::Decode::ChannelID(header);
+    unsigned int prescale=fWaveformPrescale[channel];
+    return prescale&&(fPrescaleCount[channel]++%prescale==0);
+  }
+  case SSPDAQ::kAmplitudeCut:
+    return SSPDAQ::Decode::PeakSum(header)>=fMinPeakSum;
+  default:
+    return true;
+  }
+}
+
+void SSPDAQ::DeviceInterface::SetWaveformPrescale(unsigned int channel, unsigned int prescale){
+  if(channel>=maxChannelIds){
+    SSPDAQ::Log::Error()<<"Channel "<<channel<<" out of range for waveform prescale"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  fWaveformPrescale[channel]=prescale;
+}
+
+bool SSPDAQ::DeviceInterface::ReadEventFromDevice(EventPacket& event){
   
   if(fState!=kRunning){
-    SSPDAQ::Log::Warning()<<"Attempt to get data from non-running device refused!"<<std::endl;
+    SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Attempt to get data from non-running device refused!"<<std::endl;
     event.SetEmpty();
-    return;
+    return true;
   }
 
-  std::vector<unsigned int> data;
+  std::vector<unsigned int>& data=fReadBuffer;
 
   unsigned int skippedWords=0;
 
@@ -378,22 +555,23 @@ void SSPDAQ::DeviceInterface::ReadEventFromDevice(EventPacket& event){
 
   //Find first word in event header (0xAAAAAAAA)
   while(true){
+    data.clear();
 
     fDevice->DeviceQueueStatus(&queueLengthInUInts);
     
     if(queueLengthInUInts){
-      fDevice->DeviceReceive(data,1);
+      this->Receive(data,1);
     }
 
     //If no data is available in pipe then return
     //without filling packet
     if(data.size()==0){
       if(skippedWords){
-	SSPDAQ::Log::Warning()<<"Warning: GetEvent skipped "<<skippedWords<<"words "
-			      <<"and has not seen header for next event!"<<std::endl;
+	SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: GetEvent skipped "<<skippedWords<<"words "
+							   <<"and has not seen header for next event!"<<std::endl;
       }
       event.SetEmpty();
-      return;
+      return true;
     }
 
     //Header found - continue reading rest of event
@@ -408,8 +586,8 @@ void SSPDAQ::DeviceInterface::ReadEventFromDevice(EventPacket& event){
   }
 
   if(skippedWords){
-    SSPDAQ::Log::Warning()<<"Warning: GetEvent skipped "<<skippedWords<<"words "
-			<<"before finding next event header!"<<std::endl;
+    SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: GetEvent skipped "<<skippedWords<<"words "
+						       <<"before finding next event header!"<<std::endl;
   }
     
   unsigned int* headerBlock=(unsigned int*)&event.header;
@@ -435,7 +613,7 @@ void SSPDAQ::DeviceInterface::ReadEventFromDevice(EventPacket& event){
   }while(queueLengthInUInts<headerReadSize);
 
   //Get header from device and check it is the right length
-  fDevice->DeviceReceive(data,headerReadSize);
+  this->Receive(data,headerReadSize);
   if(data.size()!=headerReadSize){
     SSPDAQ::Log::Error()<<"SSP returned truncated header even though FIFO queue is of sufficient length!"
 			<<std::endl;
@@ -464,24 +642,43 @@ void SSPDAQ::DeviceInterface::ReadEventFromDevice(EventPacket& event){
       }
     }
   }while(queueLengthInUInts<bodyReadSize);
+
+  //Drop the whole event if the filter rejects it, counting it as read so that
+  //readout loss still compares with the hardware counters
+  if(!fFilter.Accept(event.header)){
+    this->Discard(bodyReadSize);
+    std::atomic<unsigned long>& eventsRead=fEventsRead[SSPDAQ::Decode::ChannelID(event.header)];
+    eventsRead.store(eventsRead.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+    fEventsFiltered.store(fEventsFiltered.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+    event.data.clear();
+    return false;
+  }
+
+  //Drop the waveform if the readout mode doesn't want it, leaving a header-only event
+  if(bodyReadSize&&!this->KeepWaveform(event.header)){
+    this->Discard(bodyReadSize);
+    event.header.length=sizeof(EventHeader)/sizeof(unsigned int);
+    event.data.clear();
+    fWaveformsDropped.store(fWaveformsDropped.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+    return true;
+  }
    
-  //Get event from SSP and check that it is the right length
-  fDevice->DeviceReceive(data,bodyReadSize);
+  //Get event from SSP straight into a pooled buffer and check that it is the right length
+  fEventPool.Acquire(event,bodyReadSize);
+  this->Receive(event.data,bodyReadSize);
 
-  if(data.size()!=bodyReadSize){
+  if(event.data.size()!=bodyReadSize){
     SSPDAQ::Log::Error()<<"SSP returned truncated event even though FIFO queue is of sufficient length!"
 			<<std::endl;
     event.SetEmpty();
     throw(EEventReadError());
   }
 
-  //Copy event data into event packet
-  event.data=std::move(data);
-
-  return;
+  return true;
 }
 
 void SSPDAQ::DeviceInterface::Shutdown(){
+  fExecutor.reset();
   fDevice->Close();
   fState=kUninitialized;
 }
@@ -490,10 +687,10 @@ void SSPDAQ::DeviceInterface::SetRegister(unsigned int address, unsigned int val
 					  unsigned int mask){
 
   if(mask==0xFFFFFFFF){
-    fDevice->DeviceWrite(address,value);
+    fExecutor->Write(address,value).get();
   }
   else{
-    fDevice->DeviceWriteMask(address,mask,value);
+    fExecutor->WriteMask(address,mask,value).get();
   }
 }
 
@@ -504,18 +701,13 @@ void SSPDAQ::DeviceInterface::SetRegisterArray(unsigned int address, std::vector
 
 void SSPDAQ::DeviceInterface::SetRegisterArray(unsigned int address, unsigned int* value, unsigned int size){
 
-  fDevice->DeviceArrayWrite(address,size,value);
+  fExecutor->WriteArray(address,size,value).get();
 }
 
 void SSPDAQ::DeviceInterface::ReadRegister(unsigned int address, unsigned int& value,
 					  unsigned int mask){
 
-  if(mask==0xFFFFFFFF){
-    fDevice->DeviceRead(address,&value);
-  }
-  else{
-    fDevice->DeviceReadMask(address,mask,&value);
-  }
+  value=fExecutor->ReadMask(address,mask).get();
 }
 
 void SSPDAQ::DeviceInterface::ReadRegisterArray(unsigned int address, std::vector<unsigned int>& value, unsigned int size){
@@ -526,36 +718,37 @@ void SSPDAQ::DeviceInterface::ReadRegisterArray(unsigned int address, std::vecto
 
 void SSPDAQ::DeviceInterface::ReadRegisterArray(unsigned int address, unsigned int* value, unsigned int size){
 
-  fDevice->DeviceArrayRead(address,size,value);
+  std::vector<unsigned int> values=fExecutor->ReadArray(address,size).get();
+  std::copy(values.begin(),values.end(),value);
 }
 
-void SSPDAQ::DeviceInterface::ReadRegisterArrayByName(std::string name, std::vector<unsigned int>& value)
+void SSPDAQ::DeviceInterface::ReadRegisterArrayByName(const std::string& name, std::vector<unsigned int>& value)
 {
   SSPDAQ::RegMap::Register reg=(SSPDAQ::RegMap::Get())[name];
   unsigned int regSize = reg.Size();
   this->ReadRegisterArray(reg[0], value, regSize);
 }
 
-void SSPDAQ::DeviceInterface::SetRegisterByName(std::string name, unsigned int value){
+void SSPDAQ::DeviceInterface::SetRegisterByName(const std::string& name, unsigned int value){
   SSPDAQ::RegMap::Register reg=(SSPDAQ::RegMap::Get())[name];
   
   this->SetRegister(reg,value,reg.WriteMask());
 }
 
-void SSPDAQ::DeviceInterface::SetRegisterElementByName(std::string name, unsigned int index, unsigned int value){
+void SSPDAQ::DeviceInterface::SetRegisterElementByName(const std::string& name, unsigned int index, unsigned int value){
   SSPDAQ::RegMap::Register reg=(SSPDAQ::RegMap::Get())[name][index];
   
   this->SetRegister(reg,value,reg.WriteMask());
 }
 
-void SSPDAQ::DeviceInterface::SetRegisterArrayByName(std::string name, unsigned int value){
-  unsigned int regSize=(SSPDAQ::RegMap::Get())[name].Size();
-  std::vector<unsigned int> arrayContents(regSize,value);
+void SSPDAQ::DeviceInterface::SetRegisterArrayByName(const std::string& name, unsigned int value){
+  SSPDAQ::RegMap::Register reg=(SSPDAQ::RegMap::Get())[name];
+  std::vector<unsigned int> arrayContents(reg.Size(),value);
 
-  this->SetRegisterArrayByName(name,arrayContents);
+  this->SetRegisterArray(reg[0],arrayContents);
 }
 
-void SSPDAQ::DeviceInterface::SetRegisterArrayByName(std::string name, std::vector<unsigned int> values){
+void SSPDAQ::DeviceInterface::SetRegisterArrayByName(const std::string& name, std::vector<unsigned int> values){
   SSPDAQ::RegMap::Register reg=(SSPDAQ::RegMap::Get())[name];
   if(reg.Size()!=values.size()){
     SSPDAQ::Log::Error()<<"Request to set named register array "<<name<<", length "<<reg.Size()
@@ -565,14 +758,39 @@ void SSPDAQ::DeviceInterface::SetRegisterArrayByName(std::string name, std::vect
   this->SetRegisterArray(reg[0],values);
 }
 
+void SSPDAQ::DeviceInterface::SetRegisterFields(const SSPDAQ::Register& reg, unsigned int mask, unsigned int value){
+  if(mask&~reg.WriteMask()){
+    SSPDAQ::Log::Error()<<"Request to set bits "<<std::hex<<mask<<" of SSP register at "<<reg.Address()
+			<<", which has write mask "<<reg.WriteMask()<<std::dec<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  if(mask==0){
+    return;
+  }
+
+  //Fields covering every writable bit don't need a read-modify-write,
+  //so a whole array can go in one transaction
+  if((mask|~reg.WriteMask())==0xFFFFFFFF){
+    std::vector<unsigned int> words(reg.Size(),value);
+    fExecutor->WriteArray(reg.Address(),words.size(),&(words[0])).get();
+  }
+  else{
+    SSPDAQ::CommandBatch batch(*fExecutor);
+    for(unsigned int i=0;i<reg.Size();++i){
+      batch.WriteMask(reg[i],mask,value);
+    }
+    batch.Wait();
+  }
+}
+
 void SSPDAQ::DeviceInterface::EraseFirmwareBlock(unsigned int address)
 {
-  fDevice->DeviceNVEraseBlock(address);
+  fExecutor->Run([address](SSPDAQ::Device& device){device.DeviceNVEraseBlock(address);}).get();
 }
 
 void SSPDAQ::DeviceInterface::SetFirmwareArray(unsigned int address, unsigned int size, unsigned int* data)
 {
-  fDevice->DeviceNVArrayWrite(address, size, data);
+  fExecutor->Run([address,size,data](SSPDAQ::Device& device){device.DeviceNVArrayWrite(address,size,data);}).get();
 }
 
 void SSPDAQ::DeviceInterface::Configure(){
@@ -645,6 +863,10 @@ void SSPDAQ::DeviceInterface::Configure(){
 	int i = 0;
 	uint data[12];
 
+	// Writes are queued without waiting for each round trip; the executor
+	// merges runs of consecutive registers into array writes
+	SSPDAQ::CommandBatch batch(*fExecutor);
+
 	// This script of register writes sets up the digitizer for basic real event operation
 	// Comments next to each register are excerpts from the VHDL or C code
 	// ALL existing registers are shown here however many are commented out because they are
@@ -653,89 +875,90 @@ void SSPDAQ::DeviceInterface::Configure(){
 	// Therefore, it is assumed DeviceStopReset() has been called so these changes will not
 	// cause crazy things to happen along the way
 
-	fDevice->DeviceWrite(lbneReg.c2c_control,0x00000007);
-	fDevice->DeviceWrite(lbneReg.c2c_master_intr_control,0x00000000);
-	fDevice->DeviceWrite(lbneReg.comm_clock_control,0x00000001);
-	fDevice->DeviceWrite(lbneReg.comm_led_config, 0x00000000);
-	fDevice->DeviceWrite(lbneReg.comm_led_input, 0x00000000);
-	fDevice->DeviceWrite(lbneReg.qi_dac_config,0x00000000);
-	fDevice->DeviceWrite(lbneReg.qi_dac_control,0x00000001);
-
-	fDevice->DeviceWrite(lbneReg.bias_config[0],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[1],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[2],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[3],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[4],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[5],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[6],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[7],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[8],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[9],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[10],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_config[11],0x00000000);
-	fDevice->DeviceWrite(lbneReg.bias_control,0x00000001);
-
-	fDevice->DeviceWrite(lbneReg.mon_config,0x0012F000);
-	fDevice->DeviceWrite(lbneReg.mon_select,0x00FFFF00);
-	fDevice->DeviceWrite(lbneReg.mon_gpio,0x00000000);
-	fDevice->DeviceWrite(lbneReg.mon_control,0x00010001);
+	batch.Write(lbneReg.c2c_control,0x00000007);
+	batch.Write(lbneReg.c2c_master_intr_control,0x00000000);
+	batch.Write(lbneReg.comm_clock_control,0x00000001);
+	batch.Write(lbneReg.comm_led_config, 0x00000000);
+	batch.Write(lbneReg.comm_led_input, 0x00000000);
+	batch.Write(lbneReg.qi_dac_config,0x00000000);
+	batch.Write(lbneReg.qi_dac_control,0x00000001);
+
+	batch.Write(lbneReg.bias_config[0],0x00000000);
+	batch.Write(lbneReg.bias_config[1],0x00000000);
+	batch.Write(lbneReg.bias_config[2],0x00000000);
+	batch.Write(lbneReg.bias_config[3],0x00000000);
+	batch.Write(lbneReg.bias_config[4],0x00000000);
+	batch.Write(lbneReg.bias_config[5],0x00000000);
+	batch.Write(lbneReg.bias_config[6],0x00000000);
+	batch.Write(lbneReg.bias_config[7],0x00000000);
+	batch.Write(lbneReg.bias_config[8],0x00000000);
+	batch.Write(lbneReg.bias_config[9],0x00000000);
+	batch.Write(lbneReg.bias_config[10],0x00000000);
+	batch.Write(lbneReg.bias_config[11],0x00000000);
+	batch.Write(lbneReg.bias_control,0x00000001);
+
+	batch.Write(lbneReg.mon_config,0x0012F000);
+	batch.Write(lbneReg.mon_select,0x00FFFF00);
+	batch.Write(lbneReg.mon_gpio,0x00000000);
+	batch.Write(lbneReg.mon_control,0x00010001);
 
 	//Registers in the Artix FPGA (DSP)//AddressDefault ValueRead MaskWrite MaskCode Name
-	fDevice->DeviceWrite(lbneReg.module_id,module_id);
-	fDevice->DeviceWrite(lbneReg.c2c_slave_intr_control,0x00000000);
+	batch.Write(lbneReg.module_id,module_id);
+	batch.Write(lbneReg.c2c_slave_intr_control,0x00000000);
 
 	for (i = 0; i < 12; i++) data[i] = channel_control[i];
-	fDevice->DeviceArrayWrite(lbneReg.channel_control[0], 12, data);
+	batch.WriteArray(lbneReg.channel_control[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = led_threshold;
-	fDevice->DeviceArrayWrite(lbneReg.led_threshold[0], 12, data);
+	batch.WriteArray(lbneReg.led_threshold[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = cfd_fraction;
-	fDevice->DeviceArrayWrite(lbneReg.cfd_parameters[0], 12, data);
+	batch.WriteArray(lbneReg.cfd_parameters[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = readout_pretrigger;
-	fDevice->DeviceArrayWrite(lbneReg.readout_pretrigger[0], 12, data);
+	batch.WriteArray(lbneReg.readout_pretrigger[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = event_packet_length;
-	fDevice->DeviceArrayWrite(lbneReg.readout_window[0], 12, data);
+	batch.WriteArray(lbneReg.readout_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = p_window;
-	fDevice->DeviceArrayWrite(lbneReg.p_window[0], 12, data);
+	batch.WriteArray(lbneReg.p_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = i2_window;
-	fDevice->DeviceArrayWrite(lbneReg.i2_window[0], 12, data);
+	batch.WriteArray(lbneReg.i2_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = m1_window;
-	fDevice->DeviceArrayWrite(lbneReg.m1_window[0], 12, data);
+	batch.WriteArray(lbneReg.m1_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = m2_window;
-	fDevice->DeviceArrayWrite(lbneReg.m2_window[0], 12, data);
+	batch.WriteArray(lbneReg.m2_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = d_window;
-	fDevice->DeviceArrayWrite(lbneReg.d_window[0], 12, data);
+	batch.WriteArray(lbneReg.d_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = i1_window;
-	fDevice->DeviceArrayWrite(lbneReg.i1_window[0], 12, data);
+	batch.WriteArray(lbneReg.i1_window[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = disc_width;
-	fDevice->DeviceArrayWrite(lbneReg.disc_width[0], 12, data);
+	batch.WriteArray(lbneReg.disc_width[0], 12, data);
 
 	for (i = 0; i < 12; i++) data[i] = baseline_start;
-	fDevice->DeviceArrayWrite(lbneReg.baseline_start[0], 12, data);
-
-	fDevice->DeviceWrite(lbneReg.trigger_input_delay,0x00000001);
-	fDevice->DeviceWrite(lbneReg.gpio_output_width,0x00001000);
-	fDevice->DeviceWrite(lbneReg.front_panel_config, 0x00001111);
-	fDevice->DeviceWrite(lbneReg.dsp_led_config,0x00000000);
-	fDevice->DeviceWrite(lbneReg.dsp_led_input, 0x00000000);
-	fDevice->DeviceWrite(lbneReg.baseline_delay,baseline_delay);
-	fDevice->DeviceWrite(lbneReg.diag_channel_input,0x00000000);
-	fDevice->DeviceWrite(lbneReg.qi_config,0x0FFF1F00);
-	fDevice->DeviceWrite(lbneReg.qi_delay,0x00000000);
-	fDevice->DeviceWrite(lbneReg.qi_pulse_width,0x00000000);
-	fDevice->DeviceWrite(lbneReg.external_gate_width,0x00008000);
-	fDevice->DeviceWrite(lbneReg.dsp_clock_control,0x00000000);
+	batch.WriteArray(lbneReg.baseline_start[0], 12, data);
+
+	batch.Write(lbneReg.trigger_input_delay,0x00000001);
+	batch.Write(lbneReg.gpio_output_width,0x00001000);
+	batch.Write(lbneReg.front_panel_config, 0x00001111);
+	batch.Write(lbneReg.dsp_led_config,0x00000000);
+	batch.Write(lbneReg.dsp_led_input, 0x00000000);
+	batch.Write(lbneReg.baseline_delay,baseline_delay);
+	batch.Write(lbneReg.diag_channel_input,0x00000000);
+	batch.Write(lbneReg.qi_config,0x0FFF1F00);
+	batch.Write(lbneReg.qi_delay,0x00000000);
+	batch.Write(lbneReg.qi_pulse_width,0x00000000);
+	batch.Write(lbneReg.external_gate_width,0x00008000);
+	batch.Write(lbneReg.dsp_clock_control,0x00000000);
 
 	// Load the window settings - This MUST be the last operation
 
+	batch.Wait();
 }
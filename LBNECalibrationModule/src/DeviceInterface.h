@@ -5,7 +5,15 @@
 #include "Device.h"
 #include "anlTypes.h"
 #include "SafeQueue.h"
+#include "MillisliceQueue.h"
+#include "MillisliceRing.h"
 #include "EventPacket.h"
+#include "RegMap.h"
+#include "CommandExecutor.h"
+#include "RawCapture.h"
+#include "TimingService.h"
+#include "EventDecoder.h"
+#include "EventFilter.h"
 
 namespace SSPDAQ{
 
@@ -27,9 +35,19 @@ namespace SSPDAQ{
     //Start a run :-)
     void Start();
 
-    //Pop a millislice from fQueue and place into sliceData
+    //Pop a millislice from fQueue and place into sliceData.
+    //sliceData is left empty if no slice arrives within 100ms.
+    //Not fed while any slice consumers are attached (see AddSliceConsumer).
     void GetMillislice(std::vector<unsigned int>& sliceData);
 
+    //Attach a consumer to receive every millislice, shared with any other
+    //consumers rather than copied (see MillisliceRing). While consumers are
+    //attached, slices go to them instead of to GetMillislice. Mandatory consumers
+    //hold up readout if they fall behind; optional ones skip slices instead.
+    std::shared_ptr<MillisliceRing::Consumer> AddSliceConsumer(bool mandatory);
+
+    void RemoveSliceConsumer(const std::shared_ptr<MillisliceRing::Consumer>& consumer){fRing.RemoveConsumer(consumer);}
+
     //Stop a run. Also resets device state and purges buffers.
     //This is called automatically by Initialize().
     void Stop();
@@ -46,6 +64,11 @@ namespace SSPDAQ{
     //Obtain current state of device
     inline State_t State(){return fState;}
 
+    //Executor owning the board's control channel. Register operations can be
+    //submitted to it from any thread, e.g. for monitoring during a run, and the
+    //register methods below go through it too.
+    CommandExecutor& Executor(){return *fExecutor;}
+
     //Setter for single register
     //If mask is given then only bits which are high in the mask will be set.
     void SetRegister(unsigned int address, unsigned int value, unsigned int mask=0xFFFFFFFF);
@@ -69,21 +92,37 @@ namespace SSPDAQ{
     //Methods to set registers with names (as defined in SSPDAQ::RegMap)
 
     //Set single named register
-    void SetRegisterByName(std::string name, unsigned int value);
+    void SetRegisterByName(const std::string& name, unsigned int value);
 
     //Set single element of an array of registers
-    void SetRegisterElementByName(std::string name, unsigned int index, unsigned int value);
+    void SetRegisterElementByName(const std::string& name, unsigned int index, unsigned int value);
       
     //Set all elements of an array to a single value
-    void SetRegisterArrayByName(std::string name, unsigned int value);
+    void SetRegisterArrayByName(const std::string& name, unsigned int value);
       
     //Set all elements of an array using values vector
-    void SetRegisterArrayByName(std::string name, std::vector<unsigned int> values);
+    void SetRegisterArrayByName(const std::string& name, std::vector<unsigned int> values);
     
     /* Methods to read registers with names (as defined in SSPDAQ::RegMap) */
     
     // Read all elements of an array using values vector
-    void ReadRegisterArrayByName(std::string name, std::vector<unsigned int>& value);
+    void ReadRegisterArrayByName(const std::string& name, std::vector<unsigned int>& value);
+
+    /* Methods for fields of packed registers (as defined in SSPDAQ::RegMap) */
+
+    //Set fields of a register, or of every element of a register array, leaving
+    //its other bits alone. All fields of a word go in one masked write. The
+    //register must be one laid out with these fields, e.g. RegMap::BiasConfig::bias_config.
+    template<class Tag> void SetRegisterFields(const TypedRegister<Tag>& reg, const FieldValues<Tag>& values){
+      this->SetRegisterFields(reg,values.Mask(),values.Value());
+    }
+
+    //Read a single field of a register
+    template<class Tag> unsigned int ReadRegisterField(const TypedRegister<Tag>& reg, const Field<Tag>& field){
+      unsigned int value;
+      this->ReadRegister(reg,value,field.Mask());
+      return field.Decode(value);
+    }
     
     // Wrapper of Device::DeviceNV functions
     void EraseFirmwareBlock(unsigned int);
@@ -99,7 +138,86 @@ namespace SSPDAQ{
 
     void SetUseExternalTimestamp(bool val){fUseExternalTimestamp=val;}
 
+    //Build millislices in unified time from service, which must outlive the
+    //interface, or in raw time if service is 0. Set while stopped. Millislice
+    //length and overlap are then in ticks of the shared clock.
+    void SetTimingService(TimingService* service){fClock=service?&service->Board(fDeviceId):0;}
+
+    //What to read out for each event. Set while stopped.
+    //  kFullReadout: header and waveform
+    //  kHeadersOnly: header only; waveforms are dropped as they are read, never copied
+    //  kPrescaledWaveforms: waveforms for one event in every n on each channel (see SetWaveformPrescale)
+    //  kAmplitudeCut: waveforms for events whose peak sum passes a cut (see SetAmplitudeCut)
+    //Events without waveforms go into millislices with their length set to the header
+    //length, and each slice's flags record the mode.
+    void SetReadoutMode(ReadoutMode_t mode){fReadoutMode=mode;}
+
+    //Keep the waveform of the first of every prescale events on channel, or of none if 0
+    void SetWaveformPrescale(unsigned int channel, unsigned int prescale);
+
+    //Keep waveforms of events with peak sum at least minPeakSum
+    void SetAmplitudeCut(int minPeakSum){fMinPeakSum=minPeakSum;}
+
+    //Waveforms dropped by the readout mode since Start
+    inline unsigned long GetWaveformsDropped() const{return fWaveformsDropped;}
+
+    //Drop events the filter rejects as soon as their headers are read, before
+    //their waveforms are copied. Rejected events never reach millislices but
+    //still count as read (see GetEventsRead). Set while stopped.
+    void SetEventFilter(const EventFilter& filter){fFilter=filter;}
+
+    //Events rejected by the event filter since Start
+    inline unsigned long GetEventsFiltered() const{return fEventsFiltered;}
+
+    //Number of preallocated event payload buffers, set up at Start
+    void SetEventPoolSize(unsigned int size){fEventPoolSize=size;}
+
+    //Heap allocations made by the readout path since Start, for event payloads
+    //and millislices. Should stop increasing once readout reaches steady state.
+    inline unsigned long GetEventAllocations() const{return fEventPool.Allocations();}
+    inline unsigned long GetSliceAllocations() const{return fSliceAllocations;}
+
+    //Bound the millislice queue by number of slices and total bytes, and choose
+    //what happens when the consumer falls behind (see MillisliceQueue). The
+    //queue is unbounded unless limits are set, and only drops slices under
+    //kDropOldest or kDropNewest.
+    void SetQueueLimits(size_t maxSlices, size_t maxBytes){fQueue.SetLimits(maxSlices,maxBytes);}
+
+    void SetQueuePolicy(MillisliceQueue::Policy_t policy){fQueue.SetPolicy(policy);}
+
+    //Occupancy, water marks and drop counts for the millislice queue.
+    //Water marks restart at each Start.
+    inline MillisliceQueue::Stats GetQueueStats() const{return fQueue.GetStats();}
+
+    //Events read from the device on a channel since this interface was created.
+    //Not reset at Start, so they can be compared with the hardware event counters.
+    inline unsigned long GetEventsRead(unsigned int channel) const{
+      return channel<maxChannelIds?fEventsRead[channel].load():0;
+    }
+
+    //How the events of the current run can be decoded, set at Start. Pass to
+    //SelectDecoder to get a decoder for the run's millislices. With a timing
+    //service attached, times are unified with the board's latest transform;
+    //it changes as the clock is steered, so get the config again (or just the
+    //transform, from TimingService::GetTransform) before decoding later slices.
+    inline DecoderConfig GetDecoderConfig() const{
+      DecoderConfig config=fDecoderConfig;
+      if(fClock){
+	config.transform=fClock->GetTransform();
+      }
+      return config;
+    }
+
+    //Copy everything read from the data channel to capture, or stop if capture is 0.
+    //Set while stopped; capture must be open for as long as runs are taken.
+    void SetRawCapture(RawCapture* capture){fCapture=capture;}
+
+    //Channel IDs are four bits in the event header
+    static const unsigned int maxChannelIds=16;
+
   private:
+
+    void SetRegisterFields(const SSPDAQ::Register& reg, unsigned int mask, unsigned int value);
     
     //Internal device object used for hardware operations.
     //Owned by the device manager, not this object.
@@ -119,13 +237,28 @@ namespace SSPDAQ{
     std::atomic<bool> fShouldStop;
 
     //Call at Start. Will read events from device and monitor for
-    //millislice boundaries
-    void ReadEvents();
+    //millislice boundaries. Specialised on how event times are found
+    //(one of the Decode time modes), which Start chooses for the run.
+    template<class Time> void ReadEvents(Time time);
 
     //Called by ReadEvents
     //Get an event off the hardware buffer.
-    //Timeout after some wait period
-    void ReadEventFromDevice(EventPacket& event);
+    //Timeout after some wait period.
+    //Returns false if an event was read but rejected by fFilter, in which case
+    //only its header is left in event, for its time to move slices on.
+    bool ReadEventFromDevice(EventPacket& event);
+
+    //Called by ReadEventFromDevice
+    //Read from the data channel, passing the words on to fCapture if set
+    void Receive(std::vector<unsigned int>& data, unsigned int size);
+
+    //Called by ReadEventFromDevice
+    //Drop words from the data channel, unless they are needed for fCapture.
+    //Throws EEventReadError if fewer than size words are there.
+    void Discard(unsigned int size);
+
+    //Whether the readout mode keeps the waveform of an event with this header
+    bool KeepWaveform(const EventHeader& header);
 
     //Called by ReadEvents
     //Build millislice from events in buffer and place in fQueue
@@ -134,7 +267,31 @@ namespace SSPDAQ{
     //Build a millislice containing only a header and place in fQueue
     void BuildEmptyMillislice(unsigned long startTime,unsigned long endTime);
 
-    SafeQueue<std::vector<unsigned int> > fQueue;
+    //Append a copy of event to events, using a payload buffer from fEventPool
+    void DuplicateEvent(const EventPacket& event, std::vector<EventPacket>& events);
+
+    MillisliceQueue fQueue;
+
+    //Fan-out to slice consumers, used in place of fQueue when there are any
+    MillisliceRing fRing;
+
+    //Payload buffers for events between readout and millislice building
+    EventPacketPool fEventPool;
+
+    unsigned int fEventPoolSize;
+
+    //Scratch space for reading header words
+    std::vector<unsigned int> fReadBuffer;
+
+    //Slice vectors handed back by GetMillislice, for reuse by BuildMillislice
+    SafeQueue<std::vector<unsigned int> > fSpareSlices;
+
+    static const unsigned int maxSpareSlices=16;
+
+    std::atomic<unsigned long> fSliceAllocations;
+
+    //Written only by the read thread
+    std::atomic<unsigned long> fEventsRead[maxChannelIds];
 
     std::unique_ptr<std::thread> fReadThread;
 
@@ -150,6 +307,32 @@ namespace SSPDAQ{
 
     bool fSlowControlOnly;
 
+    //Raw data tap, not owned
+    RawCapture* fCapture;
+
+    //Unifies timestamps for this board, owned by the timing service
+    TimingService::BoardClock* fClock;
+
+    DecoderConfig fDecoderConfig;
+
+    ReadoutMode_t fReadoutMode;
+
+    unsigned int fWaveformPrescale[maxChannelIds];
+
+    //Events seen on each channel since Start, for prescaling; read thread only
+    unsigned int fPrescaleCount[maxChannelIds];
+
+    int fMinPeakSum;
+
+    std::atomic<unsigned long> fWaveformsDropped;
+
+    EventFilter fFilter;
+
+    std::atomic<unsigned long> fEventsFiltered;
+
+    //Owns the control channel; every register access goes through it
+    std::unique_ptr<CommandExecutor> fExecutor;
+
   };
   
 }//namespace
@@ -18,6 +18,7 @@ SSPDAQ::DeviceManager& SSPDAQ::DeviceManager::Get(){
 }
 
 SSPDAQ::DeviceManager::DeviceManager(){
+  fEmulatorLatencyInus=0;
 }
 
 unsigned int SSPDAQ::DeviceManager::GetNUSBDevices(){
@@ -31,7 +32,7 @@ void SSPDAQ::DeviceManager::RefreshDevices()
 {
 
   for(auto device=fUSBDevices.begin();device!=fUSBDevices.end();++device){
-    if(device->IsOpen()){
+    if((*device)->IsOpen()){
       SSPDAQ::Log::Warning()<<"Device manager refused request to refresh device list"
 			    <<"due to USB devices still open"<<std::endl;
     }
@@ -134,7 +135,7 @@ void SSPDAQ::DeviceManager::RefreshDevices()
       delete deviceInfoNodes;
       throw(EBadDeviceList());
     }
-    fUSBDevices.push_back(USBDevice(dIter->second,cIter->second));
+    fUSBDevices.push_back(std::move(std::unique_ptr<SSPDAQ::USBDevice>(new SSPDAQ::USBDevice(dIter->second,cIter->second))));
     SSPDAQ::Log::Info()<<"Found a device with serial "<<dIter->first<<std::endl;
   }
 
@@ -145,14 +146,14 @@ void SSPDAQ::DeviceManager::RefreshDevices()
 SSPDAQ::Device* SSPDAQ::DeviceManager::OpenDevice(SSPDAQ::Comm_t commType, unsigned int deviceNum, bool slowControlOnly)
 {
   //Check for devices if this hasn't yet been done
-  if(!fHaveLookedForDevices&&commType!=SSPDAQ::kEmulated){
+  if(!fHaveLookedForDevices&&commType!=SSPDAQ::kEmulated&&commType!=SSPDAQ::kReplay){
     this->RefreshDevices();
   }
 
   Device* device=0;
   switch(commType){
   case SSPDAQ::kUSB:
-    device=&fUSBDevices[deviceNum];
+    device=fUSBDevices[deviceNum].get();
     if(device->IsOpen()){
       SSPDAQ::Log::Error()<<"Attempt to open already open device!"<<std::endl;
       throw(EDeviceAlreadyOpen());
@@ -177,6 +178,7 @@ SSPDAQ::Device* SSPDAQ::DeviceManager::OpenDevice(SSPDAQ::Comm_t commType, unsig
   case SSPDAQ::kEmulated:
     while(fEmulatedDevices.size()<=deviceNum){
       fEmulatedDevices.push_back(std::move(std::unique_ptr<SSPDAQ::EmulatedDevice>(new SSPDAQ::EmulatedDevice(fEmulatedDevices.size()))));
+      fEmulatedDevices.back()->SetTransactionLatency(fEmulatorLatencyInus);
     }
     device=fEmulatedDevices[deviceNum].get();
     if(device->IsOpen()){
@@ -187,9 +189,45 @@ SSPDAQ::Device* SSPDAQ::DeviceManager::OpenDevice(SSPDAQ::Comm_t commType, unsig
       device->Open(slowControlOnly);
     }
     break;
+  case SSPDAQ::kReplay:
+    if(fReplayDevices.find(deviceNum)==fReplayDevices.end()){
+      SSPDAQ::Log::Error()<<"No file given for replay device "<<deviceNum<<"!"<<std::endl;
+      throw(ENoSuchDevice());
+    }
+    device=fReplayDevices[deviceNum].get();
+    if(device->IsOpen()){
+      SSPDAQ::Log::Error()<<"Attempt to open already open device!"<<std::endl;
+      throw(EDeviceAlreadyOpen());
+    }
+    else{
+      device->Open(slowControlOnly);
+    }
+    break;
   default:
     SSPDAQ::Log::Error()<<"Unrecognised interface type!"<<std::endl;
     throw(std::invalid_argument(""));
   }
   return device;
 }
+
+void SSPDAQ::DeviceManager::SetEmulatorLatency(unsigned int latencyInus){
+  fEmulatorLatencyInus=latencyInus;
+  for(auto device=fEmulatedDevices.begin();device!=fEmulatedDevices.end();++device){
+    (*device)->SetTransactionLatency(latencyInus);
+  }
+  for(auto device=fReplayDevices.begin();device!=fReplayDevices.end();++device){
+    device->second->SetTransactionLatency(latencyInus);
+  }
+}
+
+void SSPDAQ::DeviceManager::SetReplaySource(unsigned int deviceId, std::string path, double speed){
+  auto replay=fReplayDevices.find(deviceId);
+  if(replay!=fReplayDevices.end()&&replay->second->IsOpen()){
+    SSPDAQ::Log::Error()<<"Attempt to change file of open replay device "<<deviceId<<"!"<<std::endl;
+    throw(EDeviceAlreadyOpen());
+  }
+  std::unique_ptr<SSPDAQ::ReplayDevice> device(new SSPDAQ::ReplayDevice(deviceId,path));
+  device->SetSpeed(speed);
+  device->SetTransactionLatency(fEmulatorLatencyInus);
+  fReplayDevices[deviceId]=std::move(device);
+}
@@ -6,6 +6,7 @@
 #include "USBDevice.h"
 #include "EmulatedDevice.h"
 #include "EthernetDevice.h"
+#include "ReplayDevice.h"
 
 #include <vector>
 #include <map>
@@ -36,6 +37,13 @@ class DeviceManager{
   //if it has not yet been run, so it should not normally be necessary to call this directly.
   void RefreshDevices();
 
+  //Set per-transaction latency of emulated devices, including any opened later
+  void SetEmulatorLatency(unsigned int latencyInus);
+
+  //Play back path (a raw data stream or millislice file) as replay device deviceId,
+  //at speed times the recorded rate (0 for as fast as possible). See ReplayDevice.
+  void SetReplaySource(unsigned int deviceId, std::string path, double speed=1.);
+
  private:
 
   DeviceManager();
@@ -45,7 +53,8 @@ class DeviceManager{
   void operator=(DeviceManager const&); //Don't implement
 
   //List of USB devices on FTDI link
-  std::vector<USBDevice> fUSBDevices;
+  //(Held by pointer since each has its own reader thread and can't be copied)
+  std::vector<std::unique_ptr<USBDevice> > fUSBDevices;
 
   //Ethernet devices keyed by IP address
   std::map<unsigned long,std::unique_ptr<EthernetDevice> > fEthernetDevices;
@@ -53,7 +62,12 @@ class DeviceManager{
   //List of emulated devices
   std::vector<std::unique_ptr<EmulatedDevice> > fEmulatedDevices;
 
+  //Replay devices keyed by device ID, created by SetReplaySource
+  std::map<unsigned int,std::unique_ptr<ReplayDevice> > fReplayDevices;
+
   bool fHaveLookedForDevices;
+
+  unsigned int fEmulatorLatencyInus;
 };
 
 }//namespace
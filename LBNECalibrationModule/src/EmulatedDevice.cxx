@@ -6,16 +6,24 @@
 #include "RegMap.h"
 #include <chrono>
 #include <iostream>
+#include <algorithm>
 
 SSPDAQ::EmulatedDevice::EmulatedDevice(unsigned int deviceNumber){
   fDeviceNumber=deviceNumber;
   isOpen=false;
   fEmulatorThread=0;
+  fCurrentOffset=0;
+  fBufferedWords=0;
+  fLatencyInus=0;
+  fEventRateInHz=10.;
+  fPayloadWords=100;
+  fMaxBufferedWords=0x1000000;//64MB
 }
 
 void SSPDAQ::EmulatedDevice::Open(bool slowControlOnly){
 
   fSlowControlOnly=slowControlOnly;
+  this->BuildRegisterFile();
   SSPDAQ::Log::Info()<<"Emulated device open"<<std::endl;
   isOpen=true;
 }
@@ -32,65 +40,98 @@ void SSPDAQ::EmulatedDevice::DevicePurgeComm()
 
 void SSPDAQ::EmulatedDevice::DevicePurgeData()
 {
-  while(fEmulatedBuffer.size()){
-    fEmulatedBuffer.pop();
+  std::vector<unsigned int> event;
+  while(fEmulatedBuffer.try_pop(event,std::chrono::microseconds(0))){
+    fBufferedWords-=event.size();
   }
+  fBufferedWords-=fCurrentEvent.size()-fCurrentOffset;
+  fCurrentEvent.clear();
+  fCurrentOffset=0;
 }
 
 void SSPDAQ::EmulatedDevice::DeviceQueueStatus (unsigned int* numWords)
 {
-  (*numWords)=fEmulatedBuffer.size();
+  (*numWords)=fBufferedWords;
 }
 
 void SSPDAQ::EmulatedDevice::DeviceReceive(std::vector<unsigned int>& data, unsigned int size){
 
   data.clear();
-  unsigned int element;
-  for(unsigned int iElement=0;iElement<size;++iElement){
-    bool gotData=fEmulatedBuffer.try_pop(element,std::chrono::microseconds(1000));
-    if(gotData){
-      data.push_back(element);
-	}
-    else{
-      break;
+  while(data.size()<size){
+    if(fCurrentOffset==fCurrentEvent.size()){
+      fCurrentOffset=0;
+      if(!fEmulatedBuffer.try_pop(fCurrentEvent,std::chrono::microseconds(1000))){
+	fCurrentEvent.clear();
+	break;
+      }
     }
+    unsigned int nWords=std::min(size-(unsigned int)data.size(),(unsigned int)fCurrentEvent.size()-fCurrentOffset);
+    data.insert(data.end(),fCurrentEvent.begin()+fCurrentOffset,fCurrentEvent.begin()+fCurrentOffset+nWords);
+    fCurrentOffset+=nWords;
+    fBufferedWords-=nWords;
   }
 }
 
+unsigned int SSPDAQ::EmulatedDevice::DeviceDiscard(unsigned int size){
+
+  unsigned int discarded=0;
+  while(discarded<size){
+    if(fCurrentOffset==fCurrentEvent.size()){
+      fCurrentOffset=0;
+      if(!fEmulatedBuffer.try_pop(fCurrentEvent,std::chrono::microseconds(1000))){
+	fCurrentEvent.clear();
+	break;
+      }
+    }
+    unsigned int nWords=std::min(size-discarded,(unsigned int)fCurrentEvent.size()-fCurrentOffset);
+    discarded+=nWords;
+    fCurrentOffset+=nWords;
+    fBufferedWords-=nWords;
+  }
+  return discarded;
+}
+
 //==============================================================================
 // Command Functions
 //==============================================================================
 
-//Only respond to specific commands needed to simulate normal operations
 void SSPDAQ::EmulatedDevice::DeviceRead (unsigned int address, unsigned int* value)
 {
-  (void)address;
-  (void)value;
+  this->SimulateLatency();
+  std::lock_guard<std::mutex> lock(fRegisterMutex);
+  *value=IsFlashAddress(address)?this->ReadFlashWord(address):this->ReadRegisterValue(address);
 }
 
 void SSPDAQ::EmulatedDevice::DeviceReadMask (unsigned int address, unsigned int mask, unsigned int* value)
 {
-  (void)address;
-  (void)mask;
-  (void)value;
+  this->DeviceRead(address,value);
+  *value&=mask;
 }
 
 void SSPDAQ::EmulatedDevice::DeviceWrite (unsigned int address, unsigned int value)
 {
-  SSPDAQ::RegMap& lbneReg=SSPDAQ::RegMap::Get();
-  if(address==lbneReg.master_logic_control&&value==0x00000001){
-    this->Start();
-  }
-  else if(address==lbneReg.event_data_control&&value==0x00020001){
-    this->Stop();
-  }
+  this->DeviceWriteMask(address,0xFFFFFFFF,value);
 }
 
 void SSPDAQ::EmulatedDevice::DeviceWriteMask (unsigned int address, unsigned int mask, unsigned int value)
 {
-  (void)address;
-  (void)mask;
-  (void)value;
+  this->SimulateLatency();
+  {
+    std::lock_guard<std::mutex> lock(fRegisterMutex);
+    this->WriteRegisterValue(address,mask,value);
+  }
+
+  //Start and stop the event generator on the same register writes
+  //which DeviceInterface uses to start and stop real hardware
+  SSPDAQ::RegMap& lbneReg=SSPDAQ::RegMap::Get();
+  if(address==lbneReg.master_logic_control&&(mask&0x00000001)){
+    if(value&0x00000001){
+      this->Start();
+    }
+  }
+  else if(address==lbneReg.event_data_control&&(mask&value)==0x00020001){
+    this->Stop();
+  }
 }
 
 void SSPDAQ::EmulatedDevice::DeviceSet (unsigned int address, unsigned int mask)
@@ -105,44 +146,145 @@ void SSPDAQ::EmulatedDevice::DeviceClear (unsigned int address, unsigned int mas
 
 void SSPDAQ::EmulatedDevice::DeviceArrayRead (unsigned int address, unsigned int size, unsigned int* data)
 {
-  (void)address;
-  (void)size;
-  (void)data;
+  this->SimulateLatency();
+  std::lock_guard<std::mutex> lock(fRegisterMutex);
+  for(unsigned int i=0;i<size;++i){
+    unsigned int wordAddress=address+0x4*i;
+    data[i]=IsFlashAddress(wordAddress)?this->ReadFlashWord(wordAddress):this->ReadRegisterValue(wordAddress);
+  }
 }
 
 void SSPDAQ::EmulatedDevice::DeviceArrayWrite (unsigned int address, unsigned int size, unsigned int* data)
 {
-  (void)address;
-  (void)size;
-  (void)data;
+  this->SimulateLatency();
+  std::lock_guard<std::mutex> lock(fRegisterMutex);
+  for(unsigned int i=0;i<size;++i){
+    this->WriteRegisterValue(address+0x4*i,0xFFFFFFFF,data[i]);
+  }
 }
 
 void SSPDAQ::EmulatedDevice::DeviceNVWrite(unsigned int address, unsigned int value)
 {
-  (void)address;
-  (void)value;
+  this->DeviceNVArrayWrite(address,1,&value);
 }
 
 void SSPDAQ::EmulatedDevice::DeviceNVArrayWrite(unsigned int address, unsigned int size, unsigned int* data)
 {
-  (void)address;
-  (void)size;
-  (void)data;
+  this->SimulateLatency();
+  std::lock_guard<std::mutex> lock(fRegisterMutex);
+  for(unsigned int i=0;i<size;++i){
+    this->ProgramFlashWord(address+0x4*i,data[i]);
+  }
 }
 
 void SSPDAQ::EmulatedDevice::DeviceNVEraseSector(unsigned int address)
 {
-  (void)address;
+  this->SimulateLatency();
+  this->EraseFlash(address,flashSectorBytes);
 }
 
 void SSPDAQ::EmulatedDevice::DeviceNVEraseBlock(unsigned int address)
 {
-  (void)address;
+  this->SimulateLatency();
+  this->EraseFlash(address,flashBlockBytes);
 }
 
 void SSPDAQ::EmulatedDevice::DeviceNVEraseChip(unsigned int address)
 {
-  (void)address;
+  this->SimulateLatency();
+  this->EraseFlash(address,flashChipBytes);
+}
+
+//==============================================================
+//Register file and flash
+//==============================================================
+
+void SSPDAQ::EmulatedDevice::SimulateLatency(){
+  unsigned int latency=fLatencyInus;
+  if(latency){
+    usleep(latency);
+  }
+}
+
+void SSPDAQ::EmulatedDevice::BuildRegisterFile(){
+  std::lock_guard<std::mutex> lock(fRegisterMutex);
+  fRegisters.clear();
+  const SSPDAQ::RegMap::Entry* named=SSPDAQ::RegMap::Table();
+  for(unsigned int r=0;r<SSPDAQ::RegMap::kNRegisters;++r){
+    const SSPDAQ::Register& reg=named[r].reg;
+    for(unsigned int i=0;i<reg.Size();++i){
+      EmulatedRegister& emReg=fRegisters[reg.Address()+0x4*i];
+      emReg.value=0;
+      emReg.readMask=reg.ReadMask();
+      emReg.writeMask=reg.WriteMask();
+    }
+  }
+
+  //Report the emulator's device number as the module ID
+  fRegisters[SSPDAQ::RegMap::Get().module_id].value=fDeviceNumber&0xFFF;
+}
+
+bool SSPDAQ::EmulatedDevice::IsFlashAddress(unsigned int address) const{
+  //Regions 1-3 (DSP, config, comm) each start at a multiple of 0x10000000 and
+  //hold one flash chip; the rest of each 256MB range is not flash
+  unsigned int region=address>>28;
+  return region>=1&&region<=3&&(address&0x0FFFFFFF)<flashChipBytes;
+}
+
+unsigned int SSPDAQ::EmulatedDevice::ReadRegisterValue(unsigned int address){
+  auto reg=fRegisters.find(address);
+
+  //Addresses not described in RegMap behave as plain read/write words
+  if(reg==fRegisters.end()){
+    SSPDAQ::Log::Debug()<<"Emulator read from unmapped address "<<std::hex<<address<<std::dec<<std::endl;
+    return 0;
+  }
+  return reg->second.value&reg->second.readMask;
+}
+
+void SSPDAQ::EmulatedDevice::WriteRegisterValue(unsigned int address, unsigned int mask, unsigned int value){
+  auto reg=fRegisters.find(address);
+  if(reg==fRegisters.end()){
+    SSPDAQ::Log::Debug()<<"Emulator write to unmapped address "<<std::hex<<address<<std::dec<<std::endl;
+    EmulatedRegister newReg={0,0xFFFFFFFF,0xFFFFFFFF};
+    reg=fRegisters.insert(std::make_pair(address,newReg)).first;
+  }
+  unsigned int writable=mask&reg->second.writeMask;
+  reg->second.value=(reg->second.value&~writable)|(value&writable);
+}
+
+unsigned int SSPDAQ::EmulatedDevice::ReadFlashWord(unsigned int address){
+  unsigned int sector=address&~(flashSectorBytes-1);
+  auto programmed=fFlashSectors.find(sector);
+  if(programmed==fFlashSectors.end()){
+    return 0xFFFFFFFF;
+  }
+  unsigned int value;
+  std::memcpy(&value,&(programmed->second[address-sector]),sizeof(value));
+  return value;
+}
+
+void SSPDAQ::EmulatedDevice::ProgramFlashWord(unsigned int address, unsigned int value){
+  unsigned int sector=address&~(flashSectorBytes-1);
+  std::vector<unsigned char>& bytes=fFlashSectors[sector];
+  if(bytes.empty()){
+    bytes.assign(flashSectorBytes,0xFF);
+  }
+  unsigned int current;
+  std::memcpy(&current,&bytes[address-sector],sizeof(current));
+  current&=value;
+  std::memcpy(&bytes[address-sector],&current,sizeof(current));
+}
+
+void SSPDAQ::EmulatedDevice::EraseFlash(unsigned int address, unsigned int bytes){
+  if(!IsFlashAddress(address)){
+    SSPDAQ::Log::Error()<<"Emulator asked to erase flash at non-flash address "
+			<<std::hex<<address<<std::dec<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  unsigned int first=address&~(bytes-1);
+  std::lock_guard<std::mutex> lock(fRegisterMutex);
+  fFlashSectors.erase(fFlashSectors.lower_bound(first),fFlashSectors.lower_bound(first+bytes));
 }
 
 //==============================================================
@@ -150,6 +292,9 @@ void SSPDAQ::EmulatedDevice::DeviceNVEraseChip(unsigned int address)
 //==============================================================
 
 void SSPDAQ::EmulatedDevice::Start(){
+  if(fEmulatorThread){
+    return;
+  }
   SSPDAQ::Log::Debug()<<"Creating emulator thread..."<<std::endl;
   fEmulatorShouldStop=false;
   fEmulatorThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::EmulatedDevice::EmulatorLoop,this));
@@ -166,67 +311,100 @@ void SSPDAQ::EmulatedDevice::Stop(){
 void SSPDAQ::EmulatedDevice::EmulatorLoop(){
 
   SSPDAQ::Log::Debug()<<"Starting emulator loop..."<<std::endl;
-  static unsigned int headerSizeInWords=sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int);
 
   //We want to generate events on random channels at random times
   std::default_random_engine generator;
-  std::exponential_distribution<double> timeDistribution(1./100000.);//10Hz
+  std::exponential_distribution<double> timeDistribution(fEventRateInHz);
   std::uniform_int_distribution<int> channelDistribution(0,11);//12 channels
 
   std::chrono::steady_clock::time_point runStartTime = std::chrono::steady_clock::now();
 
+  //Time of next event in seconds since start of run
+  double nextEventTime=timeDistribution(generator);
+
   //Thread should terminate once "hardware" stop request has been issued
   while(!fEmulatorShouldStop){
 
-    //Wait for random period, then generate event with system timestamp and random channel
-    double waitTime = timeDistribution(generator);
-    usleep(int(waitTime));
-    std::chrono::steady_clock::time_point eventTime = std::chrono::steady_clock::now();
-    unsigned long eventTimestamp = (std::chrono::duration_cast<std::chrono::duration<unsigned long,std::ratio<1, 150000000>>>(eventTime - runStartTime)).count();//150MHz clock
-    int channel = channelDistribution(generator);
-
-    //Build an event header. 
-    SSPDAQ::EventHeader header;
-
-    //Standard header word
-    header.header=0xAAAAAAAA;
-    //Assign a junk payload of 100 words
-    header.length=headerSizeInWords+100;
-    //Assign randomly generated channel
-    header.group2=channel;
-    
-    //Set timestamps correctly? Need to figure out better how these are defined
-    for(int iWord=1;iWord<=3;++iWord){
-      header.timestamp[iWord]=(eventTimestamp>>(iWord)*16)%65536;
-    }
-    for(int iWord=0;iWord<=2;++iWord){
-      header.intTimestamp[iWord+1]=(eventTimestamp>>(iWord)*16)%65536;//First word of intTimestamp is reserved
+    double now=std::chrono::duration<double>(std::chrono::steady_clock::now()-runStartTime).count();
+
+    //Generate all events which are now due, in bursts small enough that a stop
+    //request is still seen promptly at high rates
+    for(unsigned int nGenerated=0;nextEventTime<=now&&nGenerated<10000;++nGenerated){
+      unsigned long eventTimestamp=(unsigned long)(nextEventTime*150E6);//150MHz clock
+      this->GenerateEvent(channelDistribution(generator),eventTimestamp);
+      nextEventTime+=timeDistribution(generator);
     }
 
-    //Don't bother with any other fields for now
-    header.group1=0x0;
-    header.triggerID=0x0;
-    header.peakSumLow=0x0;
-    header.group3=0x0;
-    header.preriseLow=0x0;
-    header.group4=0x0;
-    header.intSumHigh=0x0;
-    header.baseline=0x0;
-
-    for(int iWord=0;iWord<=3;++iWord){
-      header.cfdPoint[iWord]=0;
+    //Sleep until the next event is due, but wake up regularly to check for stop
+    if(nextEventTime>now){
+      usleep((useconds_t)std::min(10000.,(nextEventTime-now)*1E6));
     }
+  }
+}
 
-    
-    //Push header onto emulated buffer
-    unsigned int* headerPtr=(unsigned int*)(&header);
-    for(unsigned int element=0;element<headerSizeInWords;++element){
-      fEmulatedBuffer.push(headerPtr[element]);
+void SSPDAQ::EmulatedDevice::GenerateEvent(unsigned int channel, unsigned long eventTimestamp){
+
+  static unsigned int headerSizeInWords=sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int);
+  SSPDAQ::RegMap& lbneReg=SSPDAQ::RegMap::Get();
+
+  //Waveform length follows readout_window (in 16-bit samples) if it has been configured
+  unsigned int payloadWords;
+  unsigned int moduleId;
+  {
+    std::lock_guard<std::mutex> lock(fRegisterMutex);
+    payloadWords=fRegisters[lbneReg.readout_window[channel]].value/2;
+    moduleId=fRegisters[lbneReg.module_id].value;
+    if(!payloadWords){
+      payloadWords=fPayloadWords;
     }
 
-    //Payload contains 100 words; each word is just iWord+channel number
-    for(unsigned int iWord=0;iWord<100;++iWord){
-      fEmulatedBuffer.push(iWord+channel);
+    //Drop event if the buffer is full, just like the hardware FIFO
+    if(fBufferedWords+headerSizeInWords+payloadWords>fMaxBufferedWords){
+      ++fRegisters[lbneReg.dropped_event_count[channel]].value;
+      return;
     }
+    ++fRegisters[lbneReg.accepted_event_count[channel]].value;
+  }
+
+  std::vector<unsigned int> event(headerSizeInWords+payloadWords);
+
+  //Build an event header. 
+  SSPDAQ::EventHeader& header=*reinterpret_cast<SSPDAQ::EventHeader*>(&event[0]);
+
+  //Standard header word
+  header.header=0xAAAAAAAA;
+  header.length=headerSizeInWords+payloadWords;
+  //Assign randomly generated channel
+  header.group2=((moduleId&0xFFF)<<4)|channel;
+    
+  //No external clock, so just put internal time into external timestamp too
+  for(int iWord=0;iWord<=3;++iWord){
+    header.timestamp[iWord]=(eventTimestamp>>(iWord)*16)%65536;
   }
+  header.intTimestamp[0]=0;//First word of intTimestamp is reserved
+  for(int iWord=0;iWord<=2;++iWord){
+    header.intTimestamp[iWord+1]=(eventTimestamp>>(iWord)*16)%65536;
+  }
+
+  //Don't bother with any other fields for now
+  header.group1=0x0;
+  header.triggerID=0x0;
+  header.peakSumLow=0x0;
+  header.group3=0x0;
+  header.preriseLow=0x0;
+  header.group4=0x0;
+  header.intSumHigh=0x0;
+  header.baseline=0x0;
+
+  for(int iWord=0;iWord<=3;++iWord){
+    header.cfdPoint[iWord]=0;
+  }
+
+  //Payload words are just iWord+channel number
+  for(unsigned int iWord=0;iWord<payloadWords;++iWord){
+    event[headerSizeInWords+iWord]=iWord+channel;
+  }
+
+  fBufferedWords+=event.size();
+  fEmulatedBuffer.push(std::move(event));
 }
@@ -14,6 +14,8 @@
 #include <memory>
 #include "SafeQueue.h"
 #include <atomic>
+#include <map>
+#include <mutex>
 
 namespace SSPDAQ{
 
@@ -43,6 +45,8 @@ class EmulatedDevice : public Device{
 
   virtual void DeviceReceive(std::vector<unsigned int>& data, unsigned int size);
 
+  virtual unsigned int DeviceDiscard(unsigned int size);
+
   virtual void DeviceRead(unsigned int address, unsigned int* value);
 
   virtual void DeviceReadMask(unsigned int address, unsigned int mask, unsigned int* value);
@@ -69,21 +73,73 @@ class EmulatedDevice : public Device{
   
   virtual void DeviceNVEraseChip(unsigned int address);
 
- private:
+  //Delay applied to every register/NV transaction, to mimic the round trip
+  //to real hardware when benchmarking slow control code offline
+  void SetTransactionLatency(unsigned int latencyInus){fLatencyInus=latencyInus;}
+
+  //Mean rate of generated events, summed over all channels
+  void SetEventRate(double rateInHz){fEventRateInHz=rateInHz;}
+
+  //Waveform length used for channels whose readout_window register is zero
+  void SetPayloadWords(unsigned int words){fPayloadWords=words;}
+
+  //Limit on data held in the emulated event buffer. Further events are dropped
+  //and counted in dropped_event_count, as the hardware does when its FIFO is full.
+  void SetMaxBufferedWords(unsigned int words){fMaxBufferedWords=words;}
+
+  //Geometry of the emulated NV flash (see commandConstants in anlTypes.h)
+  static const unsigned int flashSectorBytes=0x1000;    //4KB
+  static const unsigned int flashBlockBytes=0x10000;    //64KB
+  static const unsigned int flashChipBytes=0x1000000;   //16MB
+
+ protected:
 
   virtual void Open(bool slowControlOnly=false);
 
   //Start generation of events by emulator thread
   //Called when appropriate register is set via DeviceWrite
-  void Start();
+  virtual void Start();
 
   //Stop generation of events by emulator thread
   //Called when appropriate register is set via DeviceWrite
-  void Stop();
+  virtual void Stop();
+
+ private:
+
+  //Contents of one emulated register, with masks taken from RegMap
+  struct EmulatedRegister{
+    unsigned int value;
+    unsigned int readMask;
+    unsigned int writeMask;
+  };
 
   //Add fake events to fEmulatedBuffer periodically
   void EmulatorLoop();
 
+  //Build one event and push it onto fEmulatedBuffer
+  void GenerateEvent(unsigned int channel, unsigned long timestamp);
+
+  //Sleep for the configured transaction latency
+  void SimulateLatency();
+
+  //Fill register file from the named registers in RegMap
+  void BuildRegisterFile();
+
+  //Whether address lies in one of the flash regions rather than register space
+  bool IsFlashAddress(unsigned int address) const;
+
+  //Read/write registers, applying masks. Caller must hold fRegisterMutex.
+  unsigned int ReadRegisterValue(unsigned int address);
+  void WriteRegisterValue(unsigned int address, unsigned int mask, unsigned int value);
+
+  //Read/program one word of flash. Programming can only clear bits, as for a real
+  //NOR flash; erased bytes read back as 0xFF. Caller must hold fRegisterMutex.
+  unsigned int ReadFlashWord(unsigned int address);
+  void ProgramFlashWord(unsigned int address, unsigned int value);
+
+  //Erase all sectors in [address, address+bytes), aligned down to bytes
+  void EraseFlash(unsigned int address, unsigned int bytes);
+
   //Device number to put into event headers
   unsigned int fDeviceNumber;
 
@@ -92,11 +148,36 @@ class EmulatedDevice : public Device{
   //Separate thread to generate fake data asynchronously
   std::unique_ptr<std::thread> fEmulatorThread;
 
-  //Buffer for fake data, popped from by DeviceReceive
-  SafeQueue<unsigned int> fEmulatedBuffer;
+  //Buffer for fake data, one entry per event, popped from by DeviceReceive
+  SafeQueue<std::vector<unsigned int> > fEmulatedBuffer;
+
+  //Event currently being read out by DeviceReceive, and read position within it
+  std::vector<unsigned int> fCurrentEvent;
+  unsigned int fCurrentOffset;
+
+  //Total words waiting in fEmulatedBuffer and fCurrentEvent
+  std::atomic<unsigned int> fBufferedWords;
 
   //Set by Stop method; tells emulator thread to stop generating data
   std::atomic<bool> fEmulatorShouldStop;
+
+  //Register space, keyed by address
+  std::map<unsigned int,EmulatedRegister> fRegisters;
+
+  //Programmed flash sectors, keyed by sector start address.
+  //Sectors not in the map are in the erased state.
+  std::map<unsigned int,std::vector<unsigned char> > fFlashSectors;
+
+  //Protects fRegisters and fFlashSectors
+  std::mutex fRegisterMutex;
+
+  std::atomic<unsigned int> fLatencyInus;
+
+  std::atomic<double> fEventRateInHz;
+
+  std::atomic<unsigned int> fPayloadWords;
+
+  std::atomic<unsigned int> fMaxBufferedWords;
 };
 
 }//namespace
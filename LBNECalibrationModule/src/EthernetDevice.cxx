@@ -3,13 +3,18 @@
 #include <algorithm>
 #include "Log.h"
 #include "anlExceptions.h"
+#include <cerrno>
+#include <poll.h>
 
 boost::asio::io_service SSPDAQ::EthernetDevice::fIo_service;
 
+const unsigned int SSPDAQ::EthernetDevice::commTimeout;
+
 SSPDAQ::EthernetDevice::EthernetDevice(unsigned long ipAddress):
   isOpen(false),
   fCommSocket(fIo_service),fDataSocket(fIo_service),
-  fIP(boost::asio::ip::address_v4(ipAddress))
+  fIP(boost::asio::ip::address_v4(ipAddress)),
+  fDataBuffer(dataBufferSize),fDataStart(0),fDataEnd(0)
   {}
 
 void SSPDAQ::EthernetDevice::Open(bool slowControlOnly){
@@ -21,6 +26,10 @@ void SSPDAQ::EthernetDevice::Open(bool slowControlOnly){
   boost::asio::ip::tcp::resolver::query commQuery(fIP.to_string(), slowControlOnly?"55002":"55001");
   boost::asio::ip::tcp::resolver::iterator commEndpointIterator = resolver.resolve(commQuery);
   boost::asio::connect(fCommSocket, commEndpointIterator);
+
+  //Control packets are small request/reply pairs, so don't let Nagle hold them back
+  fCommSocket.set_option(boost::asio::ip::tcp::no_delay(true));
+  isOpen=true;
   
   if(slowControlOnly){
     SSPDAQ::Log::Info()<<"Connected to SSP Ethernet device at "<<fIP.to_string()<<std::endl;
@@ -44,20 +53,67 @@ void SSPDAQ::EthernetDevice::DevicePurgeComm (void){
 }
 
 void SSPDAQ::EthernetDevice::DevicePurgeData (void){
+  fDataStart=fDataEnd=0;
   DevicePurge(fDataSocket);
 }
 
 void SSPDAQ::EthernetDevice::DeviceQueueStatus(unsigned int* numWords){
-  unsigned int numBytes=fDataSocket.available();
-  (*numWords)=numBytes/sizeof(unsigned int);  
+  FillDataBuffer(false);
+  (*numWords)=(fDataEnd-fDataStart)/sizeof(unsigned int);
 }
 
 void SSPDAQ::EthernetDevice::DeviceReceive(std::vector<unsigned int>& data, unsigned int size){
-  data.resize(size);
-  unsigned int dataReturned=fDataSocket.read_some(boost::asio::buffer(data));
-  if(dataReturned<size*sizeof(unsigned int)){
-    data.resize(dataReturned/sizeof(unsigned int));
+
+  //Block for data only if we have none buffered, as read_some would
+  if(fDataEnd-fDataStart<sizeof(unsigned int)){
+    FillDataBuffer(true);
+  }
+  else{
+    FillDataBuffer(false);
+  }
+
+  //Hand over whole words only; any partial word stays in the buffer until the
+  //rest of it arrives
+  unsigned int wordsToCopy=std::min(size,(unsigned int)((fDataEnd-fDataStart)/sizeof(unsigned int)));
+  const unsigned int* words=reinterpret_cast<const unsigned int*>(&fDataBuffer[fDataStart]);
+  data.assign(words,words+wordsToCopy);
+  fDataStart+=wordsToCopy*sizeof(unsigned int);
+}
+
+unsigned int SSPDAQ::EthernetDevice::DeviceDiscard(unsigned int size){
+
+  //As DeviceReceive, but just move past the words in the buffer
+  if(fDataEnd-fDataStart<sizeof(unsigned int)){
+    FillDataBuffer(true);
+  }
+  else{
+    FillDataBuffer(false);
+  }
+  unsigned int wordsToDrop=std::min(size,(unsigned int)((fDataEnd-fDataStart)/sizeof(unsigned int)));
+  fDataStart+=wordsToDrop*sizeof(unsigned int);
+  return wordsToDrop;
+}
+
+void SSPDAQ::EthernetDevice::FillDataBuffer(bool block){
+
+  unsigned int bytesQueued=fDataSocket.available();
+  if(!bytesQueued&&!block){
+    return;
+  }
+
+  //Move unread data to the front of the buffer, and grow it if the socket
+  //has more waiting than we have room for
+  if(fDataStart){
+    std::memmove(&fDataBuffer[0],&fDataBuffer[fDataStart],fDataEnd-fDataStart);
+    fDataEnd-=fDataStart;
+    fDataStart=0;
+  }
+  unsigned int bytesWanted=std::max(bytesQueued,(unsigned int)sizeof(unsigned int));
+  if(fDataBuffer.size()-fDataEnd<bytesWanted){
+    fDataBuffer.resize(fDataEnd+bytesWanted);
   }
+
+  fDataEnd+=fDataSocket.read_some(boost::asio::buffer(&fDataBuffer[fDataEnd],fDataBuffer.size()-fDataEnd));
 }
 
 //==============================================================================
@@ -305,15 +361,11 @@ void SSPDAQ::EthernetDevice::SendReceive(SSPDAQ::CtrlPacket& tx, SSPDAQ::CtrlPac
   while(!success){
     try{
       SendEthernet(tx,txSize);
-      // Insert small delay between send and receive on Linux
-      usleep(100);
-      ReceiveEthernet(rx,rxSizeExpected);
-      usleep(2000);
+      ReceiveEthernet(tx.header,rx,rxSizeExpected);
       success=true;
     }
-    catch(ETCPError){
+    catch(ETCPError&){
       if(timesTried<retryCount){
-	DevicePurgeComm();
 	++timesTried;
 	SSPDAQ::Log::Warning()<<"Send/receive failed "<<timesTried<<" times on Ethernet link, retrying..."<<std::endl;
       }
@@ -327,19 +379,127 @@ void SSPDAQ::EthernetDevice::SendReceive(SSPDAQ::CtrlPacket& tx, SSPDAQ::CtrlPac
 	
 void SSPDAQ::EthernetDevice::SendEthernet(SSPDAQ::CtrlPacket& tx, unsigned int txSize)
 {
-  unsigned int txSizeWritten=fCommSocket.write_some(boost::asio::buffer((void*)(&tx),txSize));
-  if(txSizeWritten!=txSize){
+  //Gather header and payload into a single write
+  std::vector<boost::asio::const_buffer> buffers;
+  buffers.push_back(boost::asio::buffer((const void*)(&tx.header),sizeof(SSPDAQ::CtrlHeader)));
+  buffers.push_back(boost::asio::buffer((const void*)(tx.data),txSize-sizeof(SSPDAQ::CtrlHeader)));
+
+  boost::system::error_code ec;
+  unsigned int txSizeWritten=boost::asio::write(fCommSocket,buffers,ec);
+  if(ec||txSizeWritten!=txSize){
+    SSPDAQ::Log::Error()<<"Failed to send control packet: "<<ec.message()<<std::endl;
     throw(ETCPError(""));
   }
-  
 }
 
-void SSPDAQ::EthernetDevice::ReceiveEthernet(SSPDAQ::CtrlPacket& rx, unsigned int rxSizeExpected)
+void SSPDAQ::EthernetDevice::ReceiveEthernet(const SSPDAQ::CtrlHeader& request, SSPDAQ::CtrlPacket& rx,
+					     unsigned int rxSizeExpected)
 {
-  unsigned int rxSizeReturned=fCommSocket.read_some(boost::asio::buffer((void*)(&rx),rxSizeExpected));
-  if(rxSizeReturned!=rxSizeExpected){
+  std::chrono::steady_clock::time_point deadline=std::chrono::steady_clock::now()+std::chrono::milliseconds(commTimeout);
+
+  //Scatter the reply straight into header and payload, so that a complete reply
+  //normally arrives in one call. A late reply to an earlier attempt at this
+  //request may still be queued ahead of ours, so reading up to the expected size
+  //can run into the next frame; anything past a skipped frame is kept.
+  unsigned int frameSize=rxSizeExpected;
+  unsigned int bytesRead=0;
+  bool haveHeader=false;
+
+  while(true){
+    //Once the header is in, its length field tells us where the frame really ends
+    if(!haveHeader&&bytesRead>=sizeof(SSPDAQ::CtrlHeader)){
+      haveHeader=true;
+      if(rx.header.length<sizeof(SSPDAQ::CtrlHeader)||rx.header.length>sizeof(SSPDAQ::CtrlPacket)){
+	SSPDAQ::Log::Warning()<<"Control reply has bad length "<<rx.header.length<<", resynchronizing"<<std::endl;
+	DevicePurgeComm();
+	throw(ETCPError(""));
+      }
+      frameSize=rx.header.length;
+    }
+
+    if(haveHeader&&bytesRead>=frameSize){
+      if(rx.header.command==request.command&&rx.header.address==request.address){
+	break;
+      }
+      //Reply to some other request (e.g. one that timed out before a retry):
+      //drop it and carry on reading until the deadline
+      SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Dropping stale control reply for command "
+							  <<rx.header.command<<" at address "<<std::hex
+							  <<rx.header.address<<std::dec<<std::endl;
+      std::memmove((char*)(&rx),(char*)(&rx)+frameSize,bytesRead-frameSize);
+      bytesRead-=frameSize;
+      frameSize=rxSizeExpected;
+      haveHeader=false;
+      continue;
+    }
+
+    if(!WaitReadable(fCommSocket,deadline)){
+      SSPDAQ::Log::Warning()<<"Timed out waiting for control reply ("<<bytesRead<<" of "
+			    <<frameSize<<" bytes received)"<<std::endl;
+      DevicePurgeComm();
+      throw(ETCPError(""));
+    }
+
+    std::vector<boost::asio::mutable_buffer> buffers;
+    if(bytesRead<sizeof(SSPDAQ::CtrlHeader)){
+      buffers.push_back(boost::asio::buffer((char*)(&rx.header)+bytesRead,sizeof(SSPDAQ::CtrlHeader)-bytesRead));
+      buffers.push_back(boost::asio::buffer((void*)(rx.data),frameSize-sizeof(SSPDAQ::CtrlHeader)));
+    }
+    else{
+      buffers.push_back(boost::asio::buffer((char*)(&rx)+bytesRead,frameSize-bytesRead));
+    }
+
+    boost::system::error_code ec;
+    bytesRead+=fCommSocket.read_some(buffers,ec);
+    if(ec){
+      SSPDAQ::Log::Error()<<"Error reading from Ethernet socket: "<<ec.message()<<std::endl;
+      throw(ETCPError(""));
+    }
+  }
+
+  //Nothing should follow our reply, since it answers the only request in flight
+  if(bytesRead>frameSize){
+    SSPDAQ::Log::Warning()<<"Unexpected data after control reply, resynchronizing"<<std::endl;
+    DevicePurgeComm();
+    throw(ETCPError(""));
+  }
+  //Whole frame has been consumed, so the stream is still in step even if
+  //this isn't the reply we wanted
+  if(frameSize!=rxSizeExpected){
+    SSPDAQ::Log::Warning()<<"Unexpected control reply: length "<<rx.header.length
+			  <<" (expected "<<rxSizeExpected<<"), status "<<rx.header.status<<std::endl;
     throw(ETCPError(""));
   }
+  if(rx.header.status!=SSPDAQ::statusNoError){
+    SSPDAQ::Log::Warning()<<"SSP returned status "<<rx.header.status<<" for command "<<rx.header.command
+			  <<" at address "<<std::hex<<rx.header.address<<std::dec<<std::endl;
+  }
+}
+
+bool SSPDAQ::EthernetDevice::WaitReadable(boost::asio::ip::tcp::socket& socket, std::chrono::steady_clock::time_point deadline)
+{
+  //Boost 1.56 has no timeouts for synchronous reads, so poll the native handle
+  while(true){
+    int msLeft=std::chrono::duration_cast<std::chrono::milliseconds>(deadline-std::chrono::steady_clock::now()).count();
+    if(msLeft<0){
+      return false;
+    }
+    pollfd pfd;
+    pfd.fd=socket.native_handle();
+    pfd.events=POLLIN;
+    pfd.revents=0;
+    int ready=poll(&pfd,1,msLeft);
+    if(ready>0){
+      return true;
+    }
+    if(ready==0){
+      return false;
+    }
+    if(errno!=EINTR){
+      SSPDAQ::Log::Error()<<"Error polling Ethernet socket: "<<strerror(errno)<<std::endl;
+      throw(ETCPError(""));
+    }
+  }
 }
 
 void SSPDAQ::EthernetDevice::DevicePurge(boost::asio::ip::tcp::socket& socket){
@@ -12,6 +12,7 @@
 #include <cstdio>
 #include <cstring>
 #include <unistd.h>
+#include <chrono>
 
 namespace SSPDAQ{
 
@@ -44,6 +45,8 @@ class EthernetDevice : public Device{
 
   virtual void DeviceReceive(std::vector<unsigned int>& data, unsigned int size);
 
+  virtual unsigned int DeviceDiscard(unsigned int size);
+
   virtual void DeviceRead(unsigned int address, unsigned int* value);
 
   virtual void DeviceReadMask(unsigned int address, unsigned int mask, unsigned int* value);
@@ -76,12 +79,28 @@ class EthernetDevice : public Device{
 
   void SendEthernet(CtrlPacket& tx, unsigned int txSize);
 
-  void ReceiveEthernet(CtrlPacket& rx, unsigned int rxSizeExpected);
+  //Read the length-prefixed reply frame to request, dropping replies whose command
+  //and address don't match it. Throws ETCPError if the frame is not the expected
+  //size or does not arrive within commTimeout.
+  void ReceiveEthernet(const CtrlHeader& request, CtrlPacket& rx, unsigned int rxSizeExpected);
 
   void DevicePurge(boost::asio::ip::tcp::socket& socket);
 
  private:
 
+  static const unsigned int commTimeout = 1000;	// in ms
+  static const unsigned int dataBufferSize = 0x100000;	// initial size of data buffer in bytes
+
+  //Move whatever the data socket has waiting into fDataBuffer. If block is set,
+  //wait for at least some data to arrive.
+  //Keeping the socket drained matters: if we wait for a whole event to queue
+  //up in the kernel before reading, a partly read receive buffer can close the
+  //TCP window first, and then the rest of the event never arrives.
+  void FillDataBuffer(bool block);
+
+  //Wait until socket has data to read. Returns false if deadline passes first.
+  bool WaitReadable(boost::asio::ip::tcp::socket& socket, std::chrono::steady_clock::time_point deadline);
+
   bool isOpen;
 
   static boost::asio::io_service fIo_service;
@@ -91,6 +110,12 @@ class EthernetDevice : public Device{
 
   boost::asio::ip::address fIP;
 
+  //Data read from the data socket but not yet handed out by DeviceReceive,
+  //held in bytes [fDataStart,fDataEnd)
+  std::vector<char> fDataBuffer;
+  unsigned int fDataStart;
+  unsigned int fDataEnd;
+
   //Can only be opened by DeviceManager, not by user
   virtual void Open(bool slowControlOnly=false);
 
@@ -0,0 +1,139 @@
+#include "EventDecoder.h"
+#include <algorithm>
+
+void SSPDAQ::DecodedEvents::Reserve(size_t n, bool allFields){
+  if(offset.size()<n){
+    offset.resize(n);
+    module.resize(n);
+    channel.resize(n);
+    timestamp.resize(n);
+    nSamples.resize(n);
+  }
+  if(allFields&&peakSum.size()<n){
+    peakSum.resize(n);
+    prerise.resize(n);
+    integratedSum.resize(n);
+    baseline.resize(n);
+    triggerType.resize(n);
+    statusFlags.resize(n);
+  }
+}
+
+namespace{
+
+  using namespace SSPDAQ::Decode;
+
+  template<class Time, class Fields>
+  SSPDAQ::DecodeFunction_t SelectLength(const SSPDAQ::DecoderConfig& config){
+    if(config.fixedLength>=headerWords){
+      return &Decoder<Time,Fields,FixedLength>;
+    }
+    return &Decoder<Time,Fields,VariableLength>;
+  }
+
+  template<class Time>
+  SSPDAQ::DecodeFunction_t SelectFields(const SSPDAQ::DecoderConfig& config){
+    if(config.allFields){
+      return SelectLength<Time,AllFields>(config);
+    }
+    return SelectLength<Time,TimingFields>(config);
+  }
+
+}
+
+SSPDAQ::DecodeFunction_t SSPDAQ::SelectDecoder(const DecoderConfig& config){
+  switch(config.timeMode){
+  case kExternalTime: return SelectFields<ExternalTime>(config);
+  case kUnifiedTime: return SelectFields<UnifiedTime>(config);
+  default: return SelectFields<InternalTime>(config);
+  }
+}
+
+size_t SSPDAQ::DecodeGeneric(const unsigned int* data, size_t words, const DecoderConfig& config, DecodedEvents& out){
+
+  out.Reserve(words/Decode::headerWords,config.allFields);
+  size_t n=0;
+  size_t offset=0;
+  while(offset+Decode::headerWords<=words){
+    const EventHeader& h=*(const EventHeader*)(data+offset);
+    if(h.header!=0xAAAAAAAA||h.length<Decode::headerWords||offset+h.length>words){
+      break;
+    }
+
+    out.offset[n]=offset;
+    out.module[n]=Decode::ModuleID(h);
+    out.channel[n]=Decode::ChannelID(h);
+
+    //Build the timestamp a word at a time
+    unsigned long eventTime=0;
+    if(config.timeMode==kExternalTime){
+      for(unsigned int iWord=0;iWord<=3;++iWord){
+	eventTime+=((unsigned long)(h.timestamp[iWord]))<<16*iWord;
+      }
+    }
+    else{
+      for(unsigned int iWord=1;iWord<=3;++iWord){
+	eventTime+=((unsigned long)(h.intTimestamp[iWord]))<<16*(iWord-1);
+      }
+      if(config.timeMode==kUnifiedTime){
+	eventTime=config.transform.Apply(eventTime);
+      }
+    }
+    out.timestamp[n]=eventTime;
+    out.nSamples[n]=Decode::NSamples(h);
+
+    if(config.allFields){
+      out.peakSum[n]=Decode::PeakSum(h);
+      out.prerise[n]=Decode::Prerise(h);
+      out.integratedSum[n]=Decode::IntegratedSum(h);
+      out.baseline[n]=Decode::Baseline(h);
+      out.triggerType[n]=Decode::TriggerType(h);
+      out.statusFlags[n]=Decode::StatusFlags(h);
+    }
+    ++n;
+    offset+=h.length;
+  }
+  out.count=n;
+  return n;
+}
+
+SSPDAQ::SliceOverlap::SliceOverlap():
+  fHaveSlice(false),
+  fTimeBase(kInternalTime),
+  fStart(0),
+  fEnd(0),
+  fOverlaps(false),
+  fPreviousEnd(0),
+  fPreviousLatest(0),
+  fLatest(0)
+{}
+
+void SSPDAQ::SliceOverlap::Reset(){
+  fHaveSlice=false;
+  fOverlaps=false;
+}
+
+void SSPDAQ::SliceOverlap::NextSlice(const MillisliceHeader& header){
+  TimeMode_t timeBase=(TimeMode_t)((header.flags&MillisliceHeader::kTimeBaseMask)>>MillisliceHeader::kTimeBaseShift);
+  fOverlaps=fHaveSlice&&timeBase==fTimeBase&&header.startTime>=fStart&&header.startTime<fEnd;
+  fPreviousEnd=fEnd;
+  fPreviousLatest=fLatest;
+  fLatest=0;
+  fTimeBase=timeBase;
+  fStart=header.startTime;
+  fEnd=header.endTime;
+  fHaveSlice=true;
+}
+
+bool SSPDAQ::SliceOverlap::IsCopy(const EventHeader& header){
+  unsigned long internal=Decode::InternalTimestamp(header);
+  fLatest=std::max(fLatest,internal);
+  if(!fOverlaps){
+    return false;
+  }
+  switch(fTimeBase){
+  case kExternalTime: return Decode::ExternalTime()(header)<fPreviousEnd;
+  case kUnifiedTime: return internal<=fPreviousLatest;
+  default: return internal<fPreviousEnd;
+  }
+}
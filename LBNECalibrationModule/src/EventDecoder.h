@@ -0,0 +1,268 @@
+#ifndef EVENTDECODER_H__
+#define EVENTDECODER_H__
+
+#include "anlTypes.h"
+#include "TimingService.h"
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Fields packed into the hardware event header, decoded as LBNEWare's
+  //LBNE_EventUnpack does
+  namespace Decode{
+
+    inline unsigned int TriggerType(const EventHeader& h){return (h.group1&0xFF00)>>8;}
+
+    inline unsigned int StatusFlags(const EventHeader& h){return (h.group1&0x00F0)>>4;}
+
+    inline unsigned int HeaderType(const EventHeader& h){return h.group1&0x000F;}
+
+    inline unsigned int ModuleID(const EventHeader& h){return (h.group2&0xFFF0)>>4;}
+
+    inline unsigned int ChannelID(const EventHeader& h){return h.group2&0x000F;}
+
+    //Clocks since last sync pulse
+    inline unsigned int SyncDelay(const EventHeader& h){return ((unsigned int)h.timestamp[1]<<16)|h.timestamp[0];}
+
+    //Sync pulse count
+    inline unsigned int SyncCount(const EventHeader& h){return ((unsigned int)h.timestamp[3]<<16)|h.timestamp[2];}
+
+    //Signed 24-bit value, sign extended
+    inline int PeakSum(const EventHeader& h){
+      int peakSum=((h.group3&0x00FF)<<16)|h.peakSumLow;
+      return (peakSum&0x00800000)?(peakSum|(int)0xFF000000):peakSum;
+    }
+
+    inline unsigned int PeakTime(const EventHeader& h){return (h.group3&0xFF00)>>8;}
+
+    inline unsigned int Prerise(const EventHeader& h){return ((h.group4&0x00FF)<<16)|h.preriseLow;}
+
+    inline unsigned int IntegratedSum(const EventHeader& h){return ((unsigned int)h.intSumHigh<<8)|((h.group4&0xFF00)>>8);}
+
+    inline unsigned int Baseline(const EventHeader& h){return h.baseline;}
+
+    //48-bit internal timestamp (word 0 is reserved)
+    inline unsigned long InternalTimestamp(const EventHeader& h){
+      return ((unsigned long)h.intTimestamp[3]<<32)|((unsigned long)h.intTimestamp[2]<<16)|h.intTimestamp[1];
+    }
+
+    //Waveform length in 16-bit samples
+    inline unsigned int NSamples(const EventHeader& h){
+      return (h.length-sizeof(EventHeader)/sizeof(unsigned int))*2;
+    }
+
+  }//namespace Decode
+
+  //Header fields of a run of events, one array per field, in the types used by
+  //the column store. The fields after nSamples are only filled when decoding
+  //all fields. Arrays only ever grow, so that decoding into the same object
+  //again doesn't allocate or clear them; only the first size() entries are valid.
+  struct DecodedEvents{
+    DecodedEvents():count(0){}
+
+    std::vector<unsigned int> offset;     // of each event, in words from the start of the data
+    std::vector<unsigned short> module;
+    std::vector<unsigned char> channel;
+    std::vector<unsigned long> timestamp;
+    std::vector<unsigned int> nSamples;
+    std::vector<int> peakSum;
+    std::vector<unsigned int> prerise;
+    std::vector<unsigned int> integratedSum;
+    std::vector<unsigned short> baseline;
+    std::vector<unsigned char> triggerType;
+    std::vector<unsigned char> statusFlags;
+
+    size_t count;
+
+    inline size_t size() const{return count;}
+
+    //Make room for n events
+    void Reserve(size_t n, bool allFields);
+  };
+
+  enum TimeMode_t{kInternalTime,kExternalTime,kUnifiedTime};
+
+  //What the events of a run look like, and what to decode from them
+  struct DecoderConfig{
+    TimeMode_t timeMode;
+    TimingService::Transform transform; // for kUnifiedTime; may be updated between calls
+    bool allFields;                     // or just module, channel, timestamp and length
+    unsigned int fixedLength;           // of every event in words, or 0 if they vary
+  };
+
+  //Decodes the events in words of data (e.g. a millislice after its header)
+  //into out, returning the number decoded. Stops at the first bad event.
+  typedef size_t (*DecodeFunction_t)(const unsigned int* data, size_t words,
+				     const DecoderConfig& config, DecodedEvents& out);
+
+  //Decoder specialised for config, to be chosen once per run rather than
+  //deciding what to do for every event
+  DecodeFunction_t SelectDecoder(const DecoderConfig& config);
+
+  //Same result as any specialised decoder, but deciding everything per event
+  size_t DecodeGeneric(const unsigned int* data, size_t words, const DecoderConfig& config, DecodedEvents& out);
+
+  //Picks out the events of a millislice which DeviceInterface also put in the
+  //slice before, from its overlap window. Slices overlap only if this one starts
+  //inside the window of the one before, in the same time base; events before
+  //the end of that window are copies. Unified times can't be found again from
+  //an event, so slices built in unified time compare internal timestamps with
+  //the latest in the slice before, which gives the same answer as unified time
+  //never goes backward.
+  class SliceOverlap{
+
+  public:
+
+    SliceOverlap();
+
+    //Forget the slice before, e.g. at the start of a new file
+    void Reset();
+
+    //Move on to the next slice
+    void NextSlice(const MillisliceHeader& header);
+
+    //Whether an event of the current slice is a copy. Call for every event of
+    //the slice, in order.
+    bool IsCopy(const EventHeader& header);
+
+  private:
+
+    bool fHaveSlice;
+
+    TimeMode_t fTimeBase;
+
+    //Window of the current slice
+    unsigned long fStart;
+    unsigned long fEnd;
+
+    //Whether the current slice starts inside the window of the one before
+    bool fOverlaps;
+
+    //End of the window of the slice before
+    unsigned long fPreviousEnd;
+
+    //Latest internal timestamps in the slice before and this one
+    unsigned long fPreviousLatest;
+    unsigned long fLatest;
+  };
+
+  namespace Decode{
+
+    static const unsigned int headerWords=sizeof(EventHeader)/sizeof(unsigned int);
+
+    //Timestamp modes
+
+    struct InternalTime{
+      InternalTime(){}
+      explicit InternalTime(const DecoderConfig&){}
+      inline unsigned long operator()(const EventHeader& h) const{return InternalTimestamp(h);}
+    };
+
+    //Sync count and clocks since sync as one 64-bit count
+    struct ExternalTime{
+      ExternalTime(){}
+      explicit ExternalTime(const DecoderConfig&){}
+      inline unsigned long operator()(const EventHeader& h) const{
+	return ((unsigned long)SyncCount(h)<<32)|SyncDelay(h);
+      }
+    };
+
+    struct UnifiedTime{
+      explicit UnifiedTime(const DecoderConfig& config):transform(config.transform){}
+      inline unsigned long operator()(const EventHeader& h) const{return transform.Apply(InternalTimestamp(h));}
+      TimingService::Transform transform;
+    };
+
+    //Unified time taking timing samples as it goes. Only for the board's read
+    //thread, and never for decoding events twice.
+    struct FittedTime{
+      explicit FittedTime(TimingService::BoardClock* boardClock):clock(boardClock){}
+      inline unsigned long operator()(const EventHeader& h) const{return clock->Unify(h);}
+      TimingService::BoardClock* clock;
+    };
+
+    //Header field sets
+
+    struct TimingFields{static const bool all=false;};
+
+    struct AllFields{static const bool all=true;};
+
+    //Waveform length classes
+
+    struct VariableLength{
+      VariableLength(){}
+      explicit VariableLength(const DecoderConfig&){}
+    };
+
+    struct FixedLength{
+      explicit FixedLength(const DecoderConfig& config):words(config.fixedLength){}
+      unsigned int words;
+    };
+
+    template<class Fields, class Time>
+    inline void DecodeOne(const EventHeader& h, size_t i, unsigned int offset, const Time& time, DecodedEvents& out){
+      out.offset[i]=offset;
+      out.module[i]=ModuleID(h);
+      out.channel[i]=ChannelID(h);
+      out.timestamp[i]=time(h);
+      out.nSamples[i]=NSamples(h);
+      if(Fields::all){
+	out.peakSum[i]=PeakSum(h);
+	out.prerise[i]=Prerise(h);
+	out.integratedSum[i]=IntegratedSum(h);
+	out.baseline[i]=Baseline(h);
+	out.triggerType[i]=TriggerType(h);
+	out.statusFlags[i]=StatusFlags(h);
+      }
+    }
+
+    //Events of any length, walked using their length fields
+    template<class Fields, class Time>
+    size_t DecodeEvents(const unsigned int* data, size_t words, const Time& time, VariableLength, DecodedEvents& out){
+      out.Reserve(words/headerWords,Fields::all);
+      size_t n=0;
+      size_t offset=0;
+      while(offset+headerWords<=words){
+	const EventHeader& h=*(const EventHeader*)(data+offset);
+	if(h.header!=0xAAAAAAAA||h.length<headerWords||offset+h.length>words){
+	  break;
+	}
+	DecodeOne<Fields>(h,n,offset,time,out);
+	++n;
+	offset+=h.length;
+      }
+      out.count=n;
+      return n;
+    }
+
+    //Events all of the same length, at a fixed stride. Every event is checked,
+    //but without branching; if any is wrong the data is decoded again as
+    //variable length.
+    template<class Fields, class Time>
+    size_t DecodeEvents(const unsigned int* data, size_t words, const Time& time, FixedLength length, DecodedEvents& out){
+      const unsigned int stride=length.words;
+      size_t n=words/stride;
+      out.Reserve(n,Fields::all);
+      bool bad=words%stride!=0;
+      for(size_t i=0;i<n;++i){
+	const EventHeader& h=*(const EventHeader*)(data+i*stride);
+	bad|=(h.header!=0xAAAAAAAA)|(h.length!=stride);
+	DecodeOne<Fields>(h,i,i*stride,time,out);
+      }
+      if(bad){
+	return DecodeEvents<Fields>(data,words,time,VariableLength(),out);
+      }
+      out.count=n;
+      return n;
+    }
+
+    //Instantiated for each configuration and returned by SelectDecoder
+    template<class Time, class Fields, class Length>
+    size_t Decoder(const unsigned int* data, size_t words, const DecoderConfig& config, DecodedEvents& out){
+      return DecodeEvents<Fields>(data,words,Time(config),Length(config),out);
+    }
+
+  }//namespace Decode
+
+}//namespace
+#endif
@@ -0,0 +1,98 @@
+#include "EventFilter.h"
+#include "Log.h"
+#include <climits>
+#include <stdexcept>
+
+SSPDAQ::EventFilter::EventFilter():
+  fChannelMask(0xFFFF),
+  fRejectedFlags(0),
+  fPeakSumLow(INT_MIN),
+  fPeakSumHigh(INT_MAX),
+  fPreriseLow(0),
+  fPreriseHigh(UINT_MAX)
+{
+  for(unsigned int i=0;i<4;++i){
+    fTriggerTypes[i]=~0UL;
+  }
+}
+
+void SSPDAQ::EventFilter::SetChannelMask(unsigned int mask){
+  fChannelMask=mask&0xFFFF;
+}
+
+void SSPDAQ::EventFilter::SetPeakSumWindow(int low, int high){
+  if(low>high){
+    SSPDAQ::Log::Error()<<"Peak sum window "<<low<<" to "<<high<<" is empty"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  fPeakSumLow=low;
+  fPeakSumHigh=high;
+}
+
+void SSPDAQ::EventFilter::SetPreriseWindow(unsigned int low, unsigned int high){
+  if(low>high){
+    SSPDAQ::Log::Error()<<"Prerise window "<<low<<" to "<<high<<" is empty"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  fPreriseLow=low;
+  fPreriseHigh=high;
+}
+
+void SSPDAQ::EventFilter::SetRejectedStatusFlags(unsigned int flags){
+  fRejectedFlags=flags&0xF;
+}
+
+void SSPDAQ::EventFilter::SetTriggerTypes(const std::vector<unsigned int>& types){
+  unsigned long selected[4]={0,0,0,0};
+  for(auto type=types.begin();type!=types.end();++type){
+    if(*type>0xFF){
+      SSPDAQ::Log::Error()<<"Trigger type "<<*type<<" out of range"<<std::endl;
+      throw(std::invalid_argument(""));
+    }
+    selected[*type>>6]|=1UL<<(*type&63);
+  }
+  for(unsigned int i=0;i<4;++i){
+    fTriggerTypes[i]=types.empty()?~0UL:selected[i];
+  }
+}
+
+bool SSPDAQ::EventFilter::AcceptsAll() const{
+  bool allTypes=true;
+  for(unsigned int i=0;i<4;++i){
+    allTypes=allTypes&&fTriggerTypes[i]==~0UL;
+  }
+  return allTypes&&fChannelMask==0xFFFF&&fRejectedFlags==0&&fPeakSumLow==INT_MIN&&fPeakSumHigh==INT_MAX&&
+    fPreriseLow==0&&fPreriseHigh==UINT_MAX;
+}
+
+size_t SSPDAQ::EventFilter::AcceptBatch(const DecodedEvents& events, std::vector<unsigned char>& accept) const{
+
+  size_t n=events.size();
+  if(accept.size()<n){
+    accept.resize(n);
+  }
+
+  //Plain loops over the arrays with no branches, so that the compiler can vectorise them
+  const unsigned char* channel=events.channel.data();
+  const unsigned char* trigger=events.triggerType.data();
+  const unsigned char* flags=events.statusFlags.data();
+  const int* peakSum=events.peakSum.data();
+  const unsigned int* prerise=events.prerise.data();
+  unsigned char* out=accept.data();
+
+  for(size_t i=0;i<n;++i){
+    out[i]=((fChannelMask>>channel[i])&1)&((flags[i]&fRejectedFlags)==0)&
+      (peakSum[i]>=fPeakSumLow)&(peakSum[i]<=fPeakSumHigh)&
+      (prerise[i]>=fPreriseLow)&(prerise[i]<=fPreriseHigh);
+  }
+  //The trigger type lookup is a gather, so is kept out of the loop above
+  for(size_t i=0;i<n;++i){
+    out[i]&=(fTriggerTypes[trigger[i]>>6]>>(trigger[i]&63))&1;
+  }
+
+  size_t accepted=0;
+  for(size_t i=0;i<n;++i){
+    accepted+=out[i];
+  }
+  return accepted;
+}
@@ -0,0 +1,72 @@
+#ifndef EVENTFILTER_H__
+#define EVENTFILTER_H__
+
+#include "anlTypes.h"
+#include "EventDecoder.h"
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Selects events on their header alone: channel, trigger type, status flags
+  //(e.g. pileup) and windows on peak sum and prerise.
+  //
+  //The setters compile the selection into masks and bounds, so that deciding
+  //on an event is a handful of loads, compares and ands with no branches, and
+  //costs the same whatever is selected. A default filter accepts everything.
+  class EventFilter{
+
+  public:
+
+    EventFilter();
+
+    //Accept events on channels whose bit is set in mask
+    void SetChannelMask(unsigned int mask);
+
+    //Accept events with low<=peak sum<=high
+    void SetPeakSumWindow(int low, int high);
+
+    //Accept events with low<=prerise<=high
+    void SetPreriseWindow(unsigned int low, unsigned int high);
+
+    //Reject events with any of these status flags set (four bits, from group1)
+    void SetRejectedStatusFlags(unsigned int flags);
+
+    //Accept only these trigger types, or any if types is empty
+    void SetTriggerTypes(const std::vector<unsigned int>& types);
+
+    //Whether the filter would accept every event
+    bool AcceptsAll() const;
+
+    inline bool Accept(const EventHeader& h) const{
+      unsigned int trigger=Decode::TriggerType(h);
+      int peakSum=Decode::PeakSum(h);
+      unsigned int prerise=Decode::Prerise(h);
+      return ((fChannelMask>>Decode::ChannelID(h))&1)&
+	((fTriggerTypes[trigger>>6]>>(trigger&63))&1)&
+	((Decode::StatusFlags(h)&fRejectedFlags)==0)&
+	(peakSum>=fPeakSumLow)&(peakSum<=fPeakSumHigh)&
+	(prerise>=fPreriseLow)&(prerise<=fPreriseHigh);
+    }
+
+    //Decide on the first events.size() events at once, setting accept[i] to 1 or 0.
+    //events must have been decoded with all fields. Returns the number accepted.
+    size_t AcceptBatch(const DecodedEvents& events, std::vector<unsigned char>& accept) const;
+
+  private:
+
+    unsigned int fChannelMask;
+
+    //One bit per trigger type
+    unsigned long fTriggerTypes[4];
+
+    unsigned int fRejectedFlags;
+
+    int fPeakSumLow;
+    int fPeakSumHigh;
+
+    unsigned int fPreriseLow;
+    unsigned int fPreriseHigh;
+  };
+
+}//namespace
+#endif
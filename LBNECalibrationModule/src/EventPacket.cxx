@@ -1,6 +1,59 @@
 #include "EventPacket.h"
+#include <algorithm>
 
 void SSPDAQ::EventPacket::SetEmpty(){
   data.clear();
   header.header=0xDEADBEEF;
 }
+
+SSPDAQ::EventPacketPool::EventPacketPool():
+  fBufferWords(0),
+  fAllocations(0){}
+
+void SSPDAQ::EventPacketPool::Prepare(unsigned int bufferWords, unsigned int nBuffers){
+  fFree.clear();
+  //Reserve the list itself too, so that Release never has to grow it
+  fFree.reserve(nBuffers);
+  fFree.resize(nBuffers);
+  for(auto buf=fFree.begin();buf!=fFree.end();++buf){
+    buf->reserve(bufferWords);
+  }
+  fBufferWords=bufferWords;
+  fAllocations=0;
+}
+
+void SSPDAQ::EventPacketPool::Acquire(SSPDAQ::EventPacket& event, unsigned int words){
+  if(event.data.capacity()>=words){
+    return;
+  }
+  if(!fFree.empty()){
+    //Event's own (too small) buffer is dropped with the emptied slot
+    event.data.swap(fFree.back());
+    fFree.pop_back();
+    if(event.data.capacity()>=words){
+      return;
+    }
+  }
+  //Event is bigger than buffers were sized for (or pool is exhausted).
+  //Buffer grows to fit, and will be bigger when it comes back to the pool.
+  event.data.reserve(std::max(words,fBufferWords));
+  ++fAllocations;
+}
+
+void SSPDAQ::EventPacketPool::Release(SSPDAQ::EventPacket& event){
+  if(!event.data.capacity()){
+    return;
+  }
+  if(fFree.size()<fFree.capacity()){
+    event.data.clear();
+    fFree.push_back(std::move(event.data));
+  }
+  event.data=std::vector<unsigned int>();
+}
+
+void SSPDAQ::EventPacketPool::Release(std::vector<SSPDAQ::EventPacket>& events){
+  for(auto ev=events.begin();ev!=events.end();++ev){
+    this->Release(*ev);
+  }
+  events.clear();
+}
@@ -3,6 +3,7 @@
 
 #include "anlTypes.h"
 #include <vector>
+#include <atomic>
 
 namespace SSPDAQ{
 
@@ -13,13 +14,14 @@ namespace SSPDAQ{
   public:
 
     //Move constructor 
-    EventPacket(EventPacket&& rhs){
+    //(noexcept so that vectors of events move rather than copy when they grow)
+    EventPacket(EventPacket&& rhs) noexcept{
       data=std::move(rhs.data);
       header=rhs.header;
     }
 
     //Move assignment operator
-    EventPacket& operator=(EventPacket&& rhs){
+    EventPacket& operator=(EventPacket&& rhs) noexcept{
       data=std::move(rhs.data);
       header=rhs.header;
       return *this;
@@ -47,6 +49,44 @@ namespace SSPDAQ{
 
     std::vector<unsigned int> data;
   };
+
+  //Fixed set of preallocated payload buffers for EventPackets, so that
+  //steady-state readout doesn't touch the heap. Buffers are lent out by
+  //Acquire and come back via Release once an event has been copied into a
+  //millislice. Not thread safe; owned and used by the readout thread.
+  class EventPacketPool{
+  public:
+
+    EventPacketPool();
+
+    //Allocate nBuffers buffers of bufferWords words each, replacing any already held
+    void Prepare(unsigned int bufferWords, unsigned int nBuffers);
+
+    //Make sure event.data has room for words words without reallocating.
+    //Keeps the event's own buffer if it is big enough, otherwise takes one
+    //from the pool; allocates (and counts it) only if neither will do.
+    void Acquire(EventPacket& event, unsigned int words);
+
+    //Return event's buffer to the pool. The event is left with no data.
+    //If the pool is already full the buffer is freed.
+    void Release(EventPacket& event);
+
+    //Release every event in the list, then clear it
+    void Release(std::vector<EventPacket>& events);
+
+    //Heap allocations made by Acquire since Prepare
+    inline unsigned long Allocations() const{return fAllocations;}
+
+    inline unsigned int Available() const{return fFree.size();}
+
+  private:
+
+    std::vector<std::vector<unsigned int> > fFree;
+
+    unsigned int fBufferWords;
+
+    std::atomic<unsigned long> fAllocations;
+  };
   
 }//namespace
 #endif
@@ -0,0 +1,222 @@
+#include "LBNEWareCsv.h"
+#include "anlExceptions.h"
+#include "Log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Column names as LBNEWare writes them (including its spelling of SynceCount)
+const char* SSPDAQ::LBNEWareCsv::fieldNames[kNFields]={
+  "PacketLength","TriggerType","StatusFlags","HeaderType","TriggerID",
+  "ModuleID","ChannelID","SyncDelay","SynceCount","PeakSum","PeakTime",
+  "Prerise","IntegratedSum","Baseline","CFDPoint0","CFDPoint1","CFDPoint2",
+  "CFDPoint3","IntTimestamp0","IntTimestamp1","IntTimestamp2","IntTimestamp3"};
+
+namespace{
+
+  //Decimal integer filling all of [p,end). Faster than strtol, which has to
+  //handle locales, bases and whitespace.
+  inline bool ParseInteger(const char* p, const char* end, long& value){
+    bool negative=(p<end&&*p=='-');
+    p+=negative;
+    if(p==end){
+      return false;
+    }
+    long result=0;
+    for(;p<end;++p){
+      unsigned int digit=(unsigned char)*p-'0';
+      if(digit>9){
+	return false;
+      }
+      result=result*10+digit;
+    }
+    value=negative?-result:result;
+    return true;
+  }
+
+  //End of the row starting at p, not counting any carriage return
+  inline const char* RowEnd(const char* p, const char* end, const char*& next){
+    const char* newline=(const char*)memchr(p,'\n',end-p);
+    next=newline?newline+1:end;
+    const char* rowEnd=newline?newline:end;
+    if(rowEnd>p&&rowEnd[-1]=='\r'){
+      --rowEnd;
+    }
+    return rowEnd;
+  }
+
+}
+
+SSPDAQ::LBNEWareCsv::LBNEWareCsv(std::string path):
+  fPath(path),
+  fData(0),
+  fSize(0),
+  fRows(0),
+  fSkippedRows(0)
+{
+  int fd=open(path.c_str(),O_RDONLY);
+  struct stat info;
+  if(fd<0||fstat(fd,&info)){
+    SSPDAQ::Log::Error()<<"Couldn't open CSV file "<<path<<": "<<std::strerror(errno)<<std::endl;
+    if(fd>=0){
+      close(fd);
+    }
+    throw(EFileError(""));
+  }
+  fSize=info.st_size;
+
+  void* map=fSize?mmap(0,fSize,PROT_READ,MAP_SHARED,fd,0):MAP_FAILED;
+  close(fd);
+  if(map==MAP_FAILED){
+    SSPDAQ::Log::Error()<<"Couldn't map CSV file "<<path<<std::endl;
+    throw(EFileError(""));
+  }
+  fData=(const char*)map;
+  madvise(map,fSize,MADV_WILLNEED);
+
+  //Match header line to fields
+  const char* end=fData+fSize;
+  const char* headerEnd=RowEnd(fData,end,fRows);
+  const char* p=fData;
+  while(true){
+    const char* comma=(const char*)memchr(p,',',headerEnd-p);
+    const char* nameEnd=comma?comma:headerEnd;
+    std::string name(p,nameEnd);
+    const char** field=std::find(fieldNames,fieldNames+kNFields,name);
+    fColumnField.push_back(field==fieldNames+kNFields?-1:field-fieldNames);
+    if(!comma){
+      break;
+    }
+    p=comma+1;
+  }
+
+  for(int field=0;field<kNFields;++field){
+    if(std::find(fColumnField.begin(),fColumnField.end(),field)==fColumnField.end()){
+      SSPDAQ::Log::Error()<<"CSV file "<<path<<" has no "<<fieldNames[field]<<" column"<<std::endl;
+      munmap(map,fSize);
+      throw(EFileError(""));
+    }
+  }
+}
+
+SSPDAQ::LBNEWareCsv::~LBNEWareCsv(){
+  munmap((void*)fData,fSize);
+}
+
+void SSPDAQ::LBNEWareCsv::Parse(std::vector<EventHeader>& events, unsigned int nThreads){
+
+  const char* end=fData+fSize;
+  if(nThreads==0){
+    nThreads=std::max(std::thread::hardware_concurrency(),1u);
+  }
+  //Not worth a thread for less than a few MB
+  nThreads=std::max(std::min((size_t)nThreads,(size_t)(end-fRows)/(4*1024*1024)),(size_t)1);
+
+  //Split into ranges of whole rows
+  std::vector<const char*> bounds(1,fRows);
+  for(unsigned int i=1;i<nThreads;++i){
+    const char* p=fRows+(end-fRows)*i/nThreads;
+    p=std::max(p,bounds.back());
+    const char* newline=(const char*)memchr(p,'\n',end-p);
+    bounds.push_back(newline?newline+1:end);
+  }
+  bounds.push_back(end);
+
+  std::vector<std::vector<EventHeader> > parts(nThreads);
+  std::vector<unsigned long> skipped(nThreads,0);
+  std::vector<std::thread> threads;
+  for(unsigned int i=1;i<nThreads;++i){
+    threads.push_back(std::thread([this,&bounds,&parts,&skipped,i](){
+	  skipped[i]=this->ParseRange(bounds[i],bounds[i+1],parts[i]);
+	}));
+  }
+  skipped[0]=this->ParseRange(bounds[0],bounds[1],parts[0]);
+  for(unsigned int i=0;i<threads.size();++i){
+    threads[i].join();
+  }
+
+  size_t total=events.size();
+  for(unsigned int i=0;i<nThreads;++i){
+    total+=parts[i].size();
+    fSkippedRows+=skipped[i];
+  }
+  events.reserve(total);
+  for(unsigned int i=0;i<nThreads;++i){
+    events.insert(events.end(),parts[i].begin(),parts[i].end());
+  }
+}
+
+unsigned long SSPDAQ::LBNEWareCsv::ParseRange(const char* begin, const char* end, std::vector<EventHeader>& events) const{
+
+  //Rows are about 200 bytes
+  events.reserve((end-begin)/200);
+
+  const unsigned int nColumns=fColumnField.size();
+  unsigned long skipped=0;
+  long values[kNFields];
+  EventHeader header;
+
+  const char* next=begin;
+  while(next<end){
+    const char* p=next;
+    const char* rowEnd=RowEnd(p,end,next);
+    //LBNEWare ends files with a FILE END line
+    if(rowEnd==p||(rowEnd-p==8&&memcmp(p,"FILE END",8)==0)){
+      continue;
+    }
+
+    unsigned int column=0;
+    bool good=true;
+    while(true){
+      const char* comma=(const char*)memchr(p,',',rowEnd-p);
+      const char* fieldEnd=comma?comma:rowEnd;
+      if(column<nColumns&&fColumnField[column]>=0){
+	good&=ParseInteger(p,fieldEnd,values[fColumnField[column]]);
+      }
+      ++column;
+      if(!comma){
+	break;
+      }
+      p=comma+1;
+    }
+
+    if(!good||column!=nColumns){
+      ++skipped;
+      continue;
+    }
+    Pack(values,header);
+    events.push_back(header);
+  }
+  return skipped;
+}
+
+void SSPDAQ::LBNEWareCsv::Pack(const long* values, EventHeader& header){
+  header.header=0xAAAAAAAA;
+  header.length=values[kPacketLength];
+  header.group1=((values[kTriggerType]&0xFF)<<8)|((values[kStatusFlags]&0xF)<<4)|(values[kHeaderType]&0xF);
+  header.triggerID=values[kTriggerID];
+  header.group2=((values[kModuleID]&0xFFF)<<4)|(values[kChannelID]&0xF);
+  header.timestamp[0]=values[kSyncDelay]&0xFFFF;
+  header.timestamp[1]=(values[kSyncDelay]>>16)&0xFFFF;
+  header.timestamp[2]=values[kSyncCount]&0xFFFF;
+  header.timestamp[3]=(values[kSyncCount]>>16)&0xFFFF;
+  header.peakSumLow=values[kPeakSum]&0xFFFF;
+  header.group3=((values[kPeakTime]&0xFF)<<8)|((values[kPeakSum]>>16)&0xFF);
+  header.preriseLow=values[kPrerise]&0xFFFF;
+  header.group4=((values[kIntegratedSum]&0xFF)<<8)|((values[kPrerise]>>16)&0xFF);
+  header.intSumHigh=(values[kIntegratedSum]>>8)&0xFFFF;
+  header.baseline=values[kBaseline];
+  header.cfdPoint[0]=values[kCFDPoint0];
+  header.cfdPoint[1]=values[kCFDPoint1];
+  header.cfdPoint[2]=values[kCFDPoint2];
+  header.cfdPoint[3]=values[kCFDPoint3];
+  header.intTimestamp[0]=values[kIntTimestamp0];
+  header.intTimestamp[1]=values[kIntTimestamp1];
+  header.intTimestamp[2]=values[kIntTimestamp2];
+  header.intTimestamp[3]=values[kIntTimestamp3];
+}
@@ -0,0 +1,72 @@
+#ifndef LBNEWARECSV_H__
+#define LBNEWARECSV_H__
+
+#include "anlTypes.h"
+#include <string>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Reads the event CSV files exported by LBNEWare (Event,Header,PacketLength,
+  //...,IntTimestamp3,WaveformWords,Info.*). Each row is packed back into the
+  //hardware EventHeader, so it can go anywhere a read-out event can. The
+  //Info.* fields are derived by LBNEWare and are not kept.
+  //
+  //The file is mapped rather than read, and split into ranges of whole rows
+  //which are parsed on separate threads.
+  class LBNEWareCsv{
+
+  public:
+
+    //Maps the file and finds the columns from the header line. Throws
+    //EFileError if the file can't be read or a needed column is missing.
+    explicit LBNEWareCsv(std::string path);
+
+    ~LBNEWareCsv();
+
+    //Parse every row into events, in file order. nThreads 0 uses one thread
+    //per core. Rows with the wrong number of fields or a non-numeric value
+    //are skipped and counted.
+    void Parse(std::vector<EventHeader>& events, unsigned int nThreads=0);
+
+    inline unsigned long SkippedRows() const{return fSkippedRows;}
+
+    inline size_t Bytes() const{return fSize;}
+
+  private:
+
+    LBNEWareCsv(const LBNEWareCsv&);
+    LBNEWareCsv& operator=(const LBNEWareCsv&);
+
+    //Header fields taken from the file
+    enum Field_t{kPacketLength,kTriggerType,kStatusFlags,kHeaderType,kTriggerID,
+		 kModuleID,kChannelID,kSyncDelay,kSyncCount,kPeakSum,kPeakTime,
+		 kPrerise,kIntegratedSum,kBaseline,kCFDPoint0,kCFDPoint1,kCFDPoint2,
+		 kCFDPoint3,kIntTimestamp0,kIntTimestamp1,kIntTimestamp2,kIntTimestamp3,
+		 kNFields};
+
+    static const char* fieldNames[kNFields];
+
+    //Parse the rows in [begin,end), which must start on a row boundary.
+    //Returns number of rows skipped.
+    unsigned long ParseRange(const char* begin, const char* end, std::vector<EventHeader>& events) const;
+
+    static void Pack(const long* values, EventHeader& header);
+
+    std::string fPath;
+
+    const char* fData;
+
+    size_t fSize;
+
+    //Start of first row after the header line
+    const char* fRows;
+
+    //Field filled by each column (-1 for columns not used)
+    std::vector<int> fColumnField;
+
+    unsigned long fSkippedRows;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,113 @@
+#ifndef LOCKFREEQUEUE_H__
+#define LOCKFREEQUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+//Bounded multi-producer, multi-consumer queue after Dmitry Vyukov's design.
+//Each slot carries a sequence number saying whether it is ready to be written
+//or read on the current lap, so push and pop need only one compare-and-swap
+//each and never wait on another thread. Capacity must be a power of two.
+//Unlike SafeQueue, nothing here blocks: try_push fails when full and try_pop
+//fails when empty.
+template <typename T>
+class LockFreeQueue
+{
+ public:
+
+  explicit LockFreeQueue(size_t capacity)
+    : buffer_(new Cell[capacity]),
+      mask_(capacity-1)
+  {
+    if(capacity<2||(capacity&(capacity-1))){
+      throw(std::invalid_argument("LockFreeQueue capacity must be a power of two"));
+    }
+    for(size_t i=0;i<capacity;++i){
+      buffer_[i].sequence.store(i,std::memory_order_relaxed);
+    }
+    enqueuePos_.store(0,std::memory_order_relaxed);
+    dequeuePos_.store(0,std::memory_order_relaxed);
+  }
+
+  bool try_push(const T& item)
+  {
+    Cell* cell;
+    size_t pos=enqueuePos_.load(std::memory_order_relaxed);
+    while(true){
+      cell=&buffer_[pos&mask_];
+      size_t seq=cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t dif=(std::ptrdiff_t)seq-(std::ptrdiff_t)pos;
+      if(dif==0){
+	if(enqueuePos_.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)){
+	  break;
+	}
+      }
+      else if(dif<0){
+	return false; //full
+      }
+      else{
+	pos=enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data=item;
+    cell->sequence.store(pos+1,std::memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T& item)
+  {
+    Cell* cell;
+    size_t pos=dequeuePos_.load(std::memory_order_relaxed);
+    while(true){
+      cell=&buffer_[pos&mask_];
+      size_t seq=cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t dif=(std::ptrdiff_t)seq-(std::ptrdiff_t)(pos+1);
+      if(dif==0){
+	if(dequeuePos_.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)){
+	  break;
+	}
+      }
+      else if(dif<0){
+	return false; //empty
+      }
+      else{
+	pos=dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    item=std::move(cell->data);
+    cell->sequence.store(pos+mask_+1,std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const
+  {
+    return mask_+1;
+  }
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+ private:
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  static const size_t cacheLineSize=64;
+
+  //Keep producer and consumer positions on separate cache lines
+  char pad0_[cacheLineSize];
+  std::unique_ptr<Cell[]> buffer_;
+  const size_t mask_;
+  char pad1_[cacheLineSize];
+  std::atomic<size_t> enqueuePos_;
+  char pad2_[cacheLineSize];
+  std::atomic<size_t> dequeuePos_;
+  char pad3_[cacheLineSize];
+};
+
+#endif
@@ -1,4 +1,13 @@
 #include "Log.h"
+#include "LockFreeQueue.h"
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 //Setup default streams for different log levels
 std::ostream* SSPDAQ::Log::fErrorStream=&std::cerr;
@@ -8,3 +17,191 @@ std::ostream* SSPDAQ::Log::fDebugStream=&std::cout;
 std::ostream* SSPDAQ::Log::fTraceStream=&std::cout;
 
 std::ostream* SSPDAQ::Log::junk=new std::ostream(0);
+
+std::atomic<int> SSPDAQ::Log::fLevel(SSPDAQ::Log::kInfo);
+
+const unsigned int SSPDAQ::LogEntry::maxLength;
+
+namespace{
+
+  //Queue of formatted records, and the thread which writes them to the log streams
+  class LogWriter{
+
+  public:
+
+    static LogWriter& Get(){
+      static LogWriter instance;
+      return instance;
+    }
+
+    void Submit(const SSPDAQ::LogEntry& entry){
+      if(fQueue.try_push(entry)){
+	fSubmitted.fetch_add(1,std::memory_order_release);
+      }
+      else{
+	fDropped.fetch_add(1,std::memory_order_relaxed);
+      }
+    }
+
+    void Flush(){
+      unsigned long target=fSubmitted.load(std::memory_order_acquire);
+      while(fWritten.load(std::memory_order_acquire)<target){
+	fWakeup.notify_one();
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    unsigned long Dropped(){
+      return fDropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+
+    static const size_t queueSize=4096; // records
+
+    LogWriter():
+      fQueue(queueSize),
+      fSubmitted(0),fWritten(0),fDropped(0),
+      fShouldStop(false),
+      fThread(&LogWriter::Run,this)
+    {}
+
+    //Drain whatever is left on exit
+    ~LogWriter(){
+      {
+	std::lock_guard<std::mutex> lock(fWakeupMutex);
+	fShouldStop=true;
+      }
+      fWakeup.notify_one();
+      fThread.join();
+    }
+
+    void Run(){
+      SSPDAQ::LogEntry entry;
+      unsigned long droppedReported=0;
+      std::chrono::steady_clock::time_point lastDropReport;
+
+      while(true){
+	bool wroteAny=false;
+	std::ostream* lastStream=0;
+	while(fQueue.try_pop(entry)){
+	  std::ostream& stream=SSPDAQ::Log::Stream(entry.level);
+	  stream.write(entry.text,entry.length);
+	  if(lastStream&&lastStream!=&stream){
+	    lastStream->flush();
+	  }
+	  lastStream=&stream;
+	  fWritten.fetch_add(1,std::memory_order_release);
+	  wroteAny=true;
+	}
+	if(lastStream){
+	  lastStream->flush();
+	}
+
+	//Report losses at most once a second, so the report doesn't add to the flood
+	unsigned long dropped=fDropped.load(std::memory_order_relaxed);
+	std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+	if(dropped!=droppedReported&&(now-lastDropReport>std::chrono::seconds(1)||fShouldStop)){
+	  SSPDAQ::Log::Stream(SSPDAQ::Log::kWarning)<<"Warning: log queue full, dropped "
+						    <<dropped-droppedReported<<" messages"<<std::endl;
+	  droppedReported=dropped;
+	  lastDropReport=now;
+	}
+
+	if(wroteAny){
+	  continue;
+	}
+
+	//Producers don't signal us (that would cost them a system call), so just
+	//look again shortly
+	std::unique_lock<std::mutex> lock(fWakeupMutex);
+	if(fShouldStop){
+	  break;
+	}
+	fWakeup.wait_for(lock,std::chrono::milliseconds(5));
+      }
+    }
+
+    LockFreeQueue<SSPDAQ::LogEntry> fQueue;
+
+    std::atomic<unsigned long> fSubmitted;
+    std::atomic<unsigned long> fWritten;
+    std::atomic<unsigned long> fDropped;
+
+    std::mutex fWakeupMutex;
+    std::condition_variable fWakeup;
+    bool fShouldStop;
+
+    std::thread fThread;
+  };
+
+  thread_local unsigned long lastSuppressed=0;
+
+}
+
+std::ostream& SSPDAQ::Log::Stream(int level){
+  switch(level){
+  case kError: return *fErrorStream;
+  case kWarning: return *fWarningStream;
+  case kInfo: return *fInfoStream;
+  case kDebug: return *fDebugStream;
+  default: return *fTraceStream;
+  }
+}
+
+void SSPDAQ::Log::Flush(){
+  LogWriter::Get().Flush();
+}
+
+unsigned long SSPDAQ::Log::Dropped(){
+  return LogWriter::Get().Dropped();
+}
+
+SSPDAQ::LogRecord::LogRecord(int level, unsigned long suppressed):
+  fSuppressed(suppressed),
+  fBuffer(fEntry.text,fEntry.text+LogEntry::maxLength),
+  fStream(&fBuffer)
+{
+  fEntry.level=level;
+}
+
+SSPDAQ::LogRecord::~LogRecord(){
+  fEntry.length=fBuffer.Length();
+
+  //Note suppressed messages on the end of the line
+  if(fSuppressed){
+    bool newline=fEntry.length&&fEntry.text[fEntry.length-1]=='\n';
+    if(newline){
+      --fEntry.length;
+    }
+    char note[48];
+    int noteLength=snprintf(note,sizeof(note)," (%lu similar messages suppressed)%s",fSuppressed,newline?"\n":"");
+    noteLength=std::min((unsigned int)noteLength,LogEntry::maxLength-fEntry.length);
+    std::memcpy(fEntry.text+fEntry.length,note,noteLength);
+    fEntry.length+=noteLength;
+  }
+
+  LogWriter::Get().Submit(fEntry);
+}
+
+SSPDAQ::LogRateLimiter::LogRateLimiter():
+  fLastInms(std::numeric_limits<long long>::min()/2),
+  fSuppressed(0)
+{}
+
+bool SSPDAQ::LogRateLimiter::Allow(unsigned int intervalInms){
+  long long now=std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  long long last=fLastInms.load(std::memory_order_relaxed);
+
+  //If two threads race here, only one gets to log
+  if(now-last<intervalInms||!fLastInms.compare_exchange_strong(last,now)){
+    fSuppressed.fetch_add(1,std::memory_order_relaxed);
+    return false;
+  }
+  lastSuppressed=fSuppressed.exchange(0);
+  return true;
+}
+
+unsigned long SSPDAQ::LogRateLimiter::LastSuppressed(){
+  return lastSuppressed;
+}
@@ -1,7 +1,31 @@
 #ifndef LOG_H__
 #define LOG_H__
 
+#include <atomic>
 #include <iostream>
+#include <streambuf>
+
+//Messages above this level are compiled out of SSPDAQ_LOG statements altogether.
+//0=Error, 1=Warning, 2=Info, 3=Debug, 4=Trace
+#ifndef SSPDAQ_LOG_MAX_LEVEL
+#define SSPDAQ_LOG_MAX_LEVEL 4
+#endif
+
+//Log a message without blocking, for use on readout threads:
+//  SSPDAQ_LOG(SSPDAQ::Log::kDebug)<<"Got event "<<n<<std::endl;
+//If the level is disabled, the rest of the statement is not evaluated.
+//Otherwise the text is formatted into a fixed-size record and written out
+//by a background thread.
+#define SSPDAQ_LOG(level)						\
+  if((level)>SSPDAQ_LOG_MAX_LEVEL||!SSPDAQ::Log::Enabled(level)){}	\
+  else SSPDAQ::LogRecord(level).Stream()
+
+//As SSPDAQ_LOG, but each call site logs at most once per interval. The next
+//message to get through reports how many were suppressed in between.
+#define SSPDAQ_LOG_RATE_LIMITED(level,intervalInms)			\
+  if((level)>SSPDAQ_LOG_MAX_LEVEL||!SSPDAQ::Log::Enabled(level)		\
+     ||!([]()->SSPDAQ::LogRateLimiter& {static SSPDAQ::LogRateLimiter limiter; return limiter;}()).Allow(intervalInms)){} \
+  else SSPDAQ::LogRecord(level,SSPDAQ::LogRateLimiter::LastSuppressed()).Stream()
 
 namespace SSPDAQ{
 
@@ -10,13 +34,18 @@ namespace SSPDAQ{
   class Log{
 
   public:
+
+    enum Level_t{kError=0,kWarning=1,kInfo=2,kDebug=3,kTrace=4};
+
     //Various levels of log importance. By default Error and Warning
-    //go to cerr, others to cout
+    //go to cerr, others to cout.
+    //These write synchronously on the calling thread. Levels above the
+    //runtime level go to junk.
     inline static std::ostream& Error(){return *fErrorStream;}
-    inline static std::ostream& Warning(){return *fWarningStream;}
-    inline static std::ostream& Info(){return *fInfoStream;}
-    inline static std::ostream& Debug(){return *fDebugStream;}
-    inline static std::ostream& Trace(){return *fTraceStream;}
+    inline static std::ostream& Warning(){return Enabled(kWarning)?*fWarningStream:*junk;}
+    inline static std::ostream& Info(){return Enabled(kInfo)?*fInfoStream:*junk;}
+    inline static std::ostream& Debug(){return Enabled(kDebug)?*fDebugStream:*junk;}
+    inline static std::ostream& Trace(){return Enabled(kTrace)?*fTraceStream:*junk;}
 
     //Use these to direct SSPDAQ log output to externally defined streams
     inline static void SetErrorStream(std::ostream& str){fErrorStream=&str;}
@@ -25,9 +54,23 @@ namespace SSPDAQ{
     inline static void SetDebugStream(std::ostream& str){fDebugStream=&str;}
     inline static void SetTraceStream(std::ostream& str){fTraceStream=&str;}
 
+    //Runtime level; messages above it are discarded. Default is kInfo.
+    inline static void SetLevel(Level_t level){fLevel.store(level,std::memory_order_relaxed);}
+    inline static Level_t GetLevel(){return (Level_t)fLevel.load(std::memory_order_relaxed);}
+    inline static bool Enabled(int level){return level<=fLevel.load(std::memory_order_relaxed);}
+
+    //Stream for given level, as used by the background writer
+    static std::ostream& Stream(int level);
+
+    //Wait until all queued SSPDAQ_LOG records have been written
+    static void Flush();
+
+    //Number of SSPDAQ_LOG records thrown away because the queue was full
+    static unsigned long Dropped();
+
     //Point a stream here to throw the output away
     static std::ostream* junk;
-    
+
   private:
     static std::ostream* fErrorStream;
     static std::ostream* fWarningStream;
@@ -35,6 +78,70 @@ namespace SSPDAQ{
     static std::ostream* fDebugStream;
     static std::ostream* fTraceStream;
 
+    static std::atomic<int> fLevel;
+
+  };
+
+  //Fixed-size text of one log message, as queued for the writer thread
+  struct LogEntry{
+    static const unsigned int maxLength=240;
+    int level;
+    unsigned int length;
+    char text[maxLength];
+  };
+
+  //One message under construction by SSPDAQ_LOG. Formats into a LogEntry on
+  //the stack (text beyond LogEntry::maxLength is cut off), and queues it when
+  //destroyed at the end of the statement. Never blocks: if the queue is full
+  //the message is dropped and counted.
+  class LogRecord{
+
+  public:
+
+    explicit LogRecord(int level, unsigned long suppressed=0);
+
+    ~LogRecord();
+
+    inline std::ostream& Stream(){return fStream;}
+
+  private:
+
+    //Writes into a fixed array, discarding anything that doesn't fit
+    class FixedBuffer : public std::streambuf{
+    public:
+      FixedBuffer(char* begin, char* end){setp(begin,end);}
+      inline unsigned int Length() const{return pptr()-pbase();}
+    protected:
+      virtual int_type overflow(int_type c){return traits_type::not_eof(c);}
+    };
+
+    LogEntry fEntry;
+
+    unsigned long fSuppressed;
+
+    FixedBuffer fBuffer;
+
+    std::ostream fStream;
+  };
+
+  //Per call site state for SSPDAQ_LOG_RATE_LIMITED
+  class LogRateLimiter{
+
+  public:
+
+    LogRateLimiter();
+
+    //True if at least intervalInms has passed since the last message allowed
+    bool Allow(unsigned int intervalInms);
+
+    //Messages suppressed before the one most recently allowed on this thread
+    static unsigned long LastSuppressed();
+
+  private:
+
+    std::atomic<long long> fLastInms;
+
+    std::atomic<unsigned long> fSuppressed;
   };
 
 }//namespace
@@ -0,0 +1,175 @@
+#include "MillisliceQueue.h"
+#include "anlTypes.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstring>
+
+SSPDAQ::MillisliceQueue::MillisliceQueue(size_t maxSlices, size_t maxBytes, Policy_t policy):
+  fMaxSlices(maxSlices),
+  fMaxBytes(maxBytes),
+  fPolicy(policy),
+  fInterrupted(false),
+  fBytes(0),
+  fPendingDrops(0)
+{
+  std::memset(&fStats,0,sizeof(fStats));
+}
+
+void SSPDAQ::MillisliceQueue::SetLimits(size_t maxSlices, size_t maxBytes){
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fMaxSlices=maxSlices;
+    fMaxBytes=maxBytes;
+  }
+  //Limits may have gone up
+  fNotFull.notify_all();
+}
+
+void SSPDAQ::MillisliceQueue::SetPolicy(Policy_t policy){
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPolicy=policy;
+  }
+  fNotFull.notify_all();
+}
+
+bool SSPDAQ::MillisliceQueue::Push(std::vector<unsigned int>& slice){
+
+  size_t bytes=Bytes(slice);
+  std::unique_lock<std::mutex> lock(fMutex);
+
+  if(fPolicy==kBlock&&!fInterrupted&&this->Full(bytes)){
+    std::chrono::steady_clock::time_point waitStart=std::chrono::steady_clock::now();
+    fNotFull.wait(lock,[this,bytes]{return !this->Full(bytes)||fInterrupted||fPolicy!=kBlock;});
+    fStats.blockedInus+=std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-waitStart).count();
+  }
+
+  std::vector<unsigned int> recycled;
+  unsigned int droppedNow=0;
+
+  if(this->Full(bytes)){
+    if(fPolicy==kDropOldest){
+      //Throw away from the head until there is room; whatever follows the
+      //dropped slices inherits their gap count as well as its own
+      while(this->Full(bytes)){
+	recycled=std::move(fQueue.front());
+	fQueue.pop_front();
+	fBytes-=Bytes(recycled);
+	unsigned int gap=1;
+	if(recycled.size()>=MillisliceHeader::sizeInUInts){
+	  gap+=reinterpret_cast<const MillisliceHeader*>(&recycled[0])->nDroppedSlices;
+	}
+	MarkGap(fQueue.empty()?slice:fQueue.front(),gap);
+	++droppedNow;
+      }
+    }
+    else{
+      //kDropNewest, or kBlock while interrupted. Slice stays with the caller.
+      ++fPendingDrops;
+      ++fStats.dropped;
+      unsigned long totalDropped=fStats.dropped;
+      lock.unlock();
+      SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: millislice queue full, dropped newest slice ("
+							 <<totalDropped<<" dropped in total)"<<std::endl;
+      return false;
+    }
+  }
+
+  if(fPendingDrops){
+    MarkGap(slice,fPendingDrops);
+    fPendingDrops=0;
+  }
+
+  fQueue.push_back(std::move(slice));
+  fBytes+=bytes;
+  ++fStats.pushed;
+  fStats.dropped+=droppedNow;
+  fStats.highWaterSlices=std::max(fStats.highWaterSlices,fQueue.size());
+  fStats.highWaterBytes=std::max(fStats.highWaterBytes,fBytes);
+  unsigned long totalDropped=fStats.dropped;
+  lock.unlock();
+  fNotEmpty.notify_one();
+
+  slice=std::move(recycled);
+
+  if(droppedNow){
+    SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: millislice queue full, dropped "<<droppedNow
+						       <<" oldest slices ("<<totalDropped<<" dropped in total)"<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool SSPDAQ::MillisliceQueue::TryPop(std::vector<unsigned int>& slice, std::chrono::microseconds timeout){
+
+  std::unique_lock<std::mutex> lock(fMutex);
+
+  if(!fNotEmpty.wait_for(lock,timeout,[this]{return !fQueue.empty();})){
+    return false;
+  }
+
+  slice=std::move(fQueue.front());
+  fQueue.pop_front();
+  fBytes-=Bytes(slice);
+  ++fStats.popped;
+  fStats.lowWaterSlices=std::min(fStats.lowWaterSlices,fQueue.size());
+  fStats.lowWaterBytes=std::min(fStats.lowWaterBytes,fBytes);
+  lock.unlock();
+  fNotFull.notify_one();
+
+  return true;
+}
+
+void SSPDAQ::MillisliceQueue::Interrupt(){
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fInterrupted=true;
+  }
+  fNotFull.notify_all();
+}
+
+void SSPDAQ::MillisliceQueue::Resume(){
+  std::lock_guard<std::mutex> lock(fMutex);
+  fInterrupted=false;
+}
+
+void SSPDAQ::MillisliceQueue::Clear(){
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fQueue.clear();
+    fBytes=0;
+    fPendingDrops=0;
+  }
+  fNotFull.notify_all();
+}
+
+SSPDAQ::MillisliceQueue::Stats SSPDAQ::MillisliceQueue::GetStats() const{
+  std::lock_guard<std::mutex> lock(fMutex);
+  Stats stats=fStats;
+  stats.slices=fQueue.size();
+  stats.bytes=fBytes;
+  return stats;
+}
+
+void SSPDAQ::MillisliceQueue::ResetWaterMarks(){
+  std::lock_guard<std::mutex> lock(fMutex);
+  fStats.highWaterSlices=fStats.lowWaterSlices=fQueue.size();
+  fStats.highWaterBytes=fStats.lowWaterBytes=fBytes;
+}
+
+bool SSPDAQ::MillisliceQueue::Full(size_t incomingBytes) const{
+  //Always take a slice into an empty queue, however big it is
+  if(fQueue.empty()){
+    return false;
+  }
+  return fQueue.size()>=fMaxSlices||fBytes+incomingBytes>fMaxBytes;
+}
+
+void SSPDAQ::MillisliceQueue::MarkGap(std::vector<unsigned int>& slice, unsigned int dropped){
+  if(slice.size()<MillisliceHeader::sizeInUInts){
+    return;
+  }
+  MillisliceHeader* header=reinterpret_cast<MillisliceHeader*>(&slice[0]);
+  header->flags|=MillisliceHeader::kAfterDroppedSlices;
+  header->nDroppedSlices+=dropped;
+}
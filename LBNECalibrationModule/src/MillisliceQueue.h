@@ -0,0 +1,106 @@
+#ifndef MILLISLICEQUEUE_H__
+#define MILLISLICEQUEUE_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Queue of built millislices between the read thread and the consumer, bounded
+  //both in number of slices and in bytes held. When full, the overflow policy
+  //decides what gives:
+  //  kBlock      - the read thread waits for room (the hardware FIFO then fills instead)
+  //  kDropOldest - the slice at the head of the queue is thrown away
+  //  kDropNewest - the incoming slice is thrown away
+  //Whenever slices are dropped, the next slice after the gap gets the
+  //kAfterDroppedSlices flag and a count of the missing slices in its
+  //MillisliceHeader, so downstream code can see the loss.
+  //A single slice bigger than the byte limit is still accepted into an empty queue.
+  //By default the queue is unbounded and never drops; limits and a dropping
+  //policy have to be asked for.
+  class MillisliceQueue{
+
+  public:
+
+    enum Policy_t{kBlock,kDropOldest,kDropNewest};
+
+    //Occupancy is counted after each push (for high water) and after each pop
+    //(for low water) since the water marks were last reset
+    struct Stats{
+      size_t slices;
+      size_t bytes;
+      size_t highWaterSlices;
+      size_t highWaterBytes;
+      size_t lowWaterSlices;
+      size_t lowWaterBytes;
+      unsigned long pushed;
+      unsigned long popped;
+      unsigned long dropped;
+      unsigned long blockedInus; // total time read thread spent waiting for room
+    };
+
+    MillisliceQueue(size_t maxSlices=SIZE_MAX, size_t maxBytes=SIZE_MAX, Policy_t policy=kBlock);
+
+    void SetLimits(size_t maxSlices, size_t maxBytes);
+
+    void SetPolicy(Policy_t policy);
+
+    //Queue a slice. Returns true if it was queued with nothing dropped.
+    //Afterwards slice holds a vector the caller may reuse: empty if the slice was
+    //queued, the slice itself if it was dropped (kDropNewest), or the oldest slice
+    //if that was dropped to make room (kDropOldest).
+    bool Push(std::vector<unsigned int>& slice);
+
+    //Pop a slice, waiting up to timeout for one. Returns false on timeout.
+    bool TryPop(std::vector<unsigned int>& slice, std::chrono::microseconds timeout);
+
+    //Release a Push blocked under kBlock, and drop rather than block from now on
+    //(until Resume). Used to stop the read thread.
+    void Interrupt();
+
+    void Resume();
+
+    //Throw away all queued slices
+    void Clear();
+
+    Stats GetStats() const;
+
+    //Restart high and low water marks from the current occupancy
+    void ResetWaterMarks();
+
+  private:
+
+    //Whether incomingBytes more would go over a limit. Must hold fMutex.
+    bool Full(size_t incomingBytes) const;
+
+    static size_t Bytes(const std::vector<unsigned int>& slice){return slice.capacity()*sizeof(unsigned int);}
+
+    //Add dropped to the gap count in the header of slice
+    static void MarkGap(std::vector<unsigned int>& slice, unsigned int dropped);
+
+    std::deque<std::vector<unsigned int> > fQueue;
+
+    mutable std::mutex fMutex;
+    std::condition_variable fNotEmpty;
+    std::condition_variable fNotFull;
+
+    size_t fMaxSlices;
+    size_t fMaxBytes;
+    Policy_t fPolicy;
+    bool fInterrupted;
+
+    size_t fBytes;
+
+    //Slices dropped under kDropNewest, to be marked on the next slice queued
+    unsigned int fPendingDrops;
+
+    Stats fStats;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,178 @@
+#include "MillisliceRing.h"
+#include "Log.h"
+#include <algorithm>
+#include <stdexcept>
+
+SSPDAQ::MillisliceRing::Consumer::Consumer(MillisliceRing* ring, bool mandatory, long long next):
+  fRing(ring),
+  fMandatory(mandatory),
+  fNext(next),
+  fReceived(0),
+  fSkipped(0)
+{}
+
+bool SSPDAQ::MillisliceRing::Consumer::Next(Slice_t& slice, std::chrono::microseconds timeout){
+
+  std::chrono::steady_clock::time_point deadline=std::chrono::steady_clock::now()+timeout;
+  long long next=fNext.load(std::memory_order_relaxed);
+
+  while(true){
+    long long published=fRing->fPublished.load(std::memory_order_acquire);
+
+    //Nothing new yet
+    if(next>published){
+      std::unique_lock<std::mutex> lock(fRing->fWaitMutex);
+      if(!fRing->fDataAvailable.wait_until(lock,deadline,[this,next]{return fRing->fPublished.load()>=next;})){
+	return false;
+      }
+      continue;
+    }
+
+    //Producer has lapped us (only possible for optional consumers), so the slices
+    //in between are gone. Carry on from the newest.
+    if(published-next>fRing->fMask){
+      fSkipped+=published-next;
+      next=published;
+    }
+
+    //Can only fail if the slot was overwritten while we read it; go round again
+    if(fRing->Read(next,slice)){
+      break;
+    }
+  }
+
+  fNext.store(next+1,std::memory_order_release);
+  ++fReceived;
+
+  if(fMandatory&&fRing->fProducerWaiting.load()){
+    std::lock_guard<std::mutex> lock(fRing->fWaitMutex);
+    fRing->fSpaceAvailable.notify_one();
+  }
+  return true;
+}
+
+SSPDAQ::MillisliceRing::MillisliceRing(size_t capacity):
+  fSlots(new Slot[capacity]),
+  fMask(capacity-1),
+  fPublished(-1),
+  fDropped(0),
+  fGate(0),
+  fProducerWaiting(false),
+  fInterrupted(false)
+{
+  if(capacity<2||(capacity&(capacity-1))){
+    SSPDAQ::Log::Error()<<"MillisliceRing capacity must be a power of two, not "<<capacity<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  for(size_t i=0;i<capacity;++i){
+    fSlots[i].sequence.store(-1);
+  }
+}
+
+std::shared_ptr<SSPDAQ::MillisliceRing::Consumer> SSPDAQ::MillisliceRing::AddConsumer(bool mandatory){
+  std::lock_guard<std::mutex> lock(fConsumersMutex);
+  std::shared_ptr<Consumer> consumer(new Consumer(this,mandatory,fPublished.load()+1));
+  fConsumers.push_back(consumer);
+  return consumer;
+}
+
+void SSPDAQ::MillisliceRing::RemoveConsumer(const std::shared_ptr<Consumer>& consumer){
+  {
+    std::lock_guard<std::mutex> lock(fConsumersMutex);
+    fConsumers.erase(std::remove(fConsumers.begin(),fConsumers.end(),consumer),fConsumers.end());
+  }
+  //Producer may have been waiting on this one
+  std::lock_guard<std::mutex> lock(fWaitMutex);
+  fSpaceAvailable.notify_one();
+}
+
+bool SSPDAQ::MillisliceRing::HasConsumers() const{
+  std::lock_guard<std::mutex> lock(fConsumersMutex);
+  return !fConsumers.empty();
+}
+
+bool SSPDAQ::MillisliceRing::Publish(std::vector<unsigned int>& slice){
+
+  long long sequence=fPublished.load(std::memory_order_relaxed)+1;
+
+  //Slot can be reused once every mandatory consumer has read the slice a whole
+  //ring ago. Only look at the consumers' cursors when the cached gate says we
+  //might have caught up with them.
+  if(sequence-fMask>fGate){
+    fGate=this->MandatoryNext();
+    if(sequence-fMask>fGate){
+      std::unique_lock<std::mutex> lock(fWaitMutex);
+      fProducerWaiting=true;
+      while(!fInterrupted&&sequence-fMask>(fGate=this->MandatoryNext())){
+	fSpaceAvailable.wait_for(lock,std::chrono::milliseconds(100));
+      }
+      fProducerWaiting=false;
+      if(sequence-fMask>fGate){
+	++fDropped;
+	return false;
+      }
+    }
+  }
+
+  Slot& slot=fSlots[sequence&fMask];
+
+  //Take the old slice out of the slot first, so nobody else can pick it up
+  slot.sequence.store(-1);
+  Slice_t old=std::atomic_exchange(&slot.data,Slice_t());
+  Slice_t fresh;
+
+  if(old&&old.use_count()==1){
+    //Nobody is still looking at the old slice, so reuse it: the new data goes
+    //into it and its storage goes back to the caller. (It was created non-const
+    //below, so this is allowed.)
+    std::vector<unsigned int>& storage=const_cast<std::vector<unsigned int>&>(*old);
+    storage.swap(slice);
+    fresh=std::move(old);
+  }
+  else{
+    fresh=std::make_shared<std::vector<unsigned int> >(std::move(slice));
+    slice.clear();
+  }
+
+  std::atomic_store(&slot.data,fresh);
+  slot.sequence.store(sequence);
+  fPublished.store(sequence,std::memory_order_release);
+
+  std::lock_guard<std::mutex> lock(fWaitMutex);
+  fDataAvailable.notify_all();
+  return true;
+}
+
+void SSPDAQ::MillisliceRing::Interrupt(){
+  std::lock_guard<std::mutex> lock(fWaitMutex);
+  fInterrupted=true;
+  fSpaceAvailable.notify_all();
+}
+
+void SSPDAQ::MillisliceRing::Resume(){
+  std::lock_guard<std::mutex> lock(fWaitMutex);
+  fInterrupted=false;
+}
+
+long long SSPDAQ::MillisliceRing::MandatoryNext(){
+  std::lock_guard<std::mutex> lock(fConsumersMutex);
+  //Never more than the next slice to be published, even with no mandatory
+  //consumers: one added later starts there, and the producer must still wait
+  //for it once the cached value is passed
+  long long next=fPublished.load()+1;
+  for(auto consumer=fConsumers.begin();consumer!=fConsumers.end();++consumer){
+    if((*consumer)->fMandatory){
+      next=std::min(next,(*consumer)->fNext.load(std::memory_order_acquire));
+    }
+  }
+  return next;
+}
+
+bool SSPDAQ::MillisliceRing::Read(long long sequence, Slice_t& slice){
+  Slot& slot=fSlots[sequence&fMask];
+  if(slot.sequence.load()!=sequence){
+    return false;
+  }
+  slice=std::atomic_load(&slot.data);
+  return slice&&slot.sequence.load()==sequence;
+}
@@ -0,0 +1,128 @@
+#ifndef MILLISLICERING_H__
+#define MILLISLICERING_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Broadcast ring delivering every millislice to several consumers without
+  //copying. Slices are published once as immutable shared vectors, and each
+  //consumer keeps its own cursor (sequence number) into the ring.
+  //
+  //Mandatory consumers see every slice: the producer waits before overwriting
+  //a slot that any of them has yet to read. Optional consumers never hold up
+  //the producer; one that falls a whole ring behind skips ahead to the newest
+  //slice, and the slices it missed are counted.
+  //
+  //There must be only one producer. Each consumer handle should be used from
+  //one thread at a time.
+  class MillisliceRing{
+
+  public:
+
+    typedef std::shared_ptr<const std::vector<unsigned int> > Slice_t;
+
+    class Consumer{
+
+    public:
+
+      //Wait up to timeout for the next slice. Returns false on timeout.
+      bool Next(Slice_t& slice, std::chrono::microseconds timeout);
+
+      inline bool Mandatory() const{return fMandatory;}
+
+      inline unsigned long Received() const{return fReceived;}
+
+      //Slices missed by skipping ahead (optional consumers only)
+      inline unsigned long Skipped() const{return fSkipped;}
+
+    private:
+
+      friend class MillisliceRing;
+
+      Consumer(MillisliceRing* ring, bool mandatory, long long next);
+
+      MillisliceRing* fRing;
+
+      bool fMandatory;
+
+      //Sequence number of the next slice to read
+      std::atomic<long long> fNext;
+
+      std::atomic<unsigned long> fReceived;
+
+      std::atomic<unsigned long> fSkipped;
+    };
+
+    //Capacity must be a power of two
+    explicit MillisliceRing(size_t capacity=64);
+
+    //New consumers start with the next slice published
+    std::shared_ptr<Consumer> AddConsumer(bool mandatory);
+
+    //Stop delivering to a consumer, so that it no longer holds up the producer.
+    //Don't call Next on it afterwards.
+    void RemoveConsumer(const std::shared_ptr<Consumer>& consumer);
+
+    bool HasConsumers() const;
+
+    //Publish a slice to all consumers, waiting for mandatory consumers if the ring
+    //is full. Returns false if the slice was dropped because the ring was interrupted.
+    //Afterwards slice holds storage the caller may reuse: that of the slice pushed
+    //out of the ring, if nobody else still holds it.
+    bool Publish(std::vector<unsigned int>& slice);
+
+    //Stop Publish waiting for mandatory consumers (it drops instead), until Resume
+    void Interrupt();
+
+    void Resume();
+
+    inline unsigned long Published() const{return fPublished+1;}
+
+    inline unsigned long Dropped() const{return fDropped;}
+
+  private:
+
+    struct Slot{
+      //Sequence number of the slice in the slot, or -1 while it is being replaced
+      std::atomic<long long> sequence;
+      Slice_t data;
+    };
+
+    //Lowest sequence number not yet read by every mandatory consumer, and no
+    //more than that of the next slice to be published
+    long long MandatoryNext();
+
+    //Read slot for sequence into slice. Fails if the slot has moved on.
+    bool Read(long long sequence, Slice_t& slice);
+
+    std::unique_ptr<Slot[]> fSlots;
+
+    const long long fMask;
+
+    //Sequence number of the last slice published, -1 before the first
+    std::atomic<long long> fPublished;
+
+    std::atomic<unsigned long> fDropped;
+
+    //Producer's cached value of MandatoryNext
+    long long fGate;
+
+    mutable std::mutex fConsumersMutex;
+    std::vector<std::shared_ptr<Consumer> > fConsumers;
+
+    //Only for sleeping; the ring itself is managed through the sequence numbers
+    std::mutex fWaitMutex;
+    std::condition_variable fDataAvailable;
+    std::condition_variable fSpaceAvailable;
+    std::atomic<bool> fProducerWaiting;
+    bool fInterrupted;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,49 @@
+#include "NumberedFiles.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+
+unsigned int SSPDAQ::NextFileIndex(const std::string& base, const char* extension){
+
+  size_t slash=base.rfind('/');
+  std::string directory=slash==std::string::npos?".":base.substr(0,slash+1);
+  std::string prefix=(slash==std::string::npos?base:base.substr(slash+1))+"_";
+  size_t extensionLength=std::strlen(extension);
+
+  DIR* dir=opendir(directory.c_str());
+  if(!dir){
+    return 0;
+  }
+  unsigned int next=0;
+  while(struct dirent* entry=readdir(dir)){
+    std::string name=entry->d_name;
+    if(name.size()<=prefix.size()+extensionLength||name.compare(0,prefix.size(),prefix)||
+       name.compare(name.size()-extensionLength,extensionLength,extension)){
+      continue;
+    }
+    std::string digits=name.substr(prefix.size(),name.size()-prefix.size()-extensionLength);
+    if(digits.find_first_not_of("0123456789")!=std::string::npos){
+      continue;
+    }
+    next=std::max(next,(unsigned int)std::strtoul(digits.c_str(),0,10)+1);
+  }
+  closedir(dir);
+  return next;
+}
+
+int SSPDAQ::CreateNumberedFile(const std::string& base, const char* extension, unsigned int& index, std::string& name){
+  while(true){
+    char suffix[32];
+    snprintf(suffix,sizeof(suffix),"_%04u%s",index,extension);
+    name=base+suffix;
+    int fd=open(name.c_str(),O_WRONLY|O_CREAT|O_EXCL,0644);
+    if(fd>=0||errno!=EEXIST){
+      return fd;
+    }
+    ++index;
+  }
+}
@@ -0,0 +1,21 @@
+#ifndef NUMBEREDFILES_H__
+#define NUMBEREDFILES_H__
+
+#include <string>
+
+namespace SSPDAQ{
+
+  //Helpers for series of output files named <base>_NNNN<extension>, as written
+  //by SliceWriter and RawCapture. Files already on disk are never overwritten.
+
+  //One past the highest index of any file in the series already on disk, or 0
+  //if there are none, so that a new run carries on after the previous one
+  unsigned int NextFileIndex(const std::string& base, const char* extension);
+
+  //Create file index of the series for writing, advancing index past any file
+  //that already exists. Returns the file descriptor and sets name, or returns
+  //-1 with errno set on failure.
+  int CreateNumberedFile(const std::string& base, const char* extension, unsigned int& index, std::string& name);
+
+}//namespace
+#endif
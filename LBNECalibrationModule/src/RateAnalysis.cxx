@@ -0,0 +1,159 @@
+#include "RateAnalysis.h"
+#include <algorithm>
+#include <cmath>
+
+SSPDAQ::RateAnalysis::RateAnalysis(double clockInMHz, double windowInSeconds, double stepInSeconds,
+				   unsigned int binsPerDecade):
+  fTicksPerSecond(clockInMHz*1.E6),
+  fStepTicks(std::max(stepInSeconds*clockInMHz*1.E6,1.)),
+  fWindowSteps(std::max(windowInSeconds/stepInSeconds+0.5,1.)),
+  fBinsPerDecade(std::max(binsPerDecade,1u)),
+  fChannelIndex(1<<16,-1),
+  fStarted(false),
+  fStartTime(0),
+  fLastTime(0),
+  fStep(0),
+  fEvents(0),
+  fLateEvents(0)
+{
+  //Timestamps are 48 bits, so gaps are under 15 decades
+  fNGapBins=1+15*fBinsPerDecade;
+}
+
+void SSPDAQ::RateAnalysis::Add(unsigned int module, unsigned int channel, unsigned long timestamp){
+
+  if(!fStarted){
+    fStartTime=timestamp;
+    fStarted=true;
+  }
+  fLastTime=timestamp;
+  ++fEvents;
+
+  Channel& ch=this->GetChannel(module,channel);
+
+  if(ch.events){
+    if(timestamp<ch.last){
+      ++ch.outOfOrder;
+    }
+    else{
+      unsigned long gap=timestamp-ch.last;
+      unsigned int bin=gap?1+(unsigned int)(std::log10((double)gap)*fBinsPerDecade):0;
+      ++ch.gapBins[std::min(bin,fNGapBins-1)];
+      ch.minGap=std::min(ch.minGap,gap);
+    }
+    ch.first=std::min(ch.first,timestamp);
+    ch.last=std::max(ch.last,timestamp);
+  }
+  else{
+    ch.first=timestamp;
+    ch.last=timestamp;
+  }
+  ++ch.events;
+
+  //Sliding window. Events a little out of order still go into their own step
+  //if it is inside the current window.
+  if(timestamp<fStartTime){
+    ++fLateEvents;
+    return;
+  }
+  unsigned long step=(timestamp-fStartTime)/fStepTicks;
+  if(step>fStep){
+    this->Advance(step);
+  }
+  if(step+fWindowSteps<=fStep){
+    ++fLateEvents;
+    return;
+  }
+  ++ch.window[step%fWindowSteps];
+  ++ch.windowEvents;
+}
+
+void SSPDAQ::RateAnalysis::Add(const unsigned short* module, const unsigned char* channel,
+			       const unsigned long* timestamp, size_t n){
+  for(size_t i=0;i<n;++i){
+    this->Add(module[i],channel[i],timestamp[i]);
+  }
+}
+
+void SSPDAQ::RateAnalysis::Finish(){
+  if(!fStarted){
+    return;
+  }
+  //Advance only reports full windows
+  if(fCallback&&fStep+1<fWindowSteps){
+    fCallback(0.,(fStep+1)*(double)fStepTicks/fTicksPerSecond,fChannels);
+  }
+  this->Advance(fStep+1);
+}
+
+SSPDAQ::RateAnalysis::Channel& SSPDAQ::RateAnalysis::GetChannel(unsigned int module, unsigned int channel){
+  int& index=fChannelIndex[((module&0xFFF)<<4)|(channel&0xF)];
+  if(index<0){
+    index=fChannels.size();
+    Channel ch;
+    ch.module=module;
+    ch.channel=channel;
+    ch.events=0;
+    ch.first=0;
+    ch.last=0;
+    ch.minGap=~0UL;
+    ch.outOfOrder=0;
+    ch.gapBins.assign(fNGapBins,0);
+    ch.window.assign(fWindowSteps,0);
+    ch.windowEvents=0;
+    fChannels.push_back(ch);
+  }
+  return fChannels[index];
+}
+
+void SSPDAQ::RateAnalysis::Advance(unsigned long step){
+  for(;fStep<step;++fStep){
+    //Report once the window is full
+    if(fCallback&&fStep+1>=fWindowSteps){
+      double end=(fStep+1)*(double)fStepTicks/fTicksPerSecond;
+      double start=end-fWindowSteps*(double)fStepTicks/fTicksPerSecond;
+      fCallback(start,end,fChannels);
+    }
+    //Clear the step that is about to be reused
+    unsigned int slot=(fStep+1)%fWindowSteps;
+    for(std::vector<Channel>::iterator ch=fChannels.begin();ch!=fChannels.end();++ch){
+      ch->windowEvents-=ch->window[slot];
+      ch->window[slot]=0;
+    }
+  }
+}
+
+unsigned long SSPDAQ::RateAnalysis::GapBinLow(unsigned int bin) const{
+  return bin?(unsigned long)std::ceil(std::pow(10.,(double)(bin-1)/fBinsPerDecade)):0;
+}
+
+double SSPDAQ::RateAnalysis::Span(const Channel& channel) const{
+  return (channel.last-channel.first)/fTicksPerSecond;
+}
+
+double SSPDAQ::RateAnalysis::Rate(const Channel& channel) const{
+  double span=this->Span(channel);
+  return span>0?channel.events/span:0.;
+}
+
+double SSPDAQ::RateAnalysis::Span() const{
+  return fLastTime>fStartTime?(fLastTime-fStartTime)/fTicksPerSecond:0.;
+}
+
+double SSPDAQ::RateAnalysis::Rate() const{
+  double span=this->Span();
+  return span>0?fEvents/span:0.;
+}
+
+double SSPDAQ::RateAnalysis::DeadFraction(const Channel& channel, unsigned long deadTicks) const{
+  if(deadTicks==0){
+    deadTicks=channel.events>1?channel.minGap:0;
+  }
+  double span=this->Span(channel);
+  return span>0?std::min(channel.events*deadTicks/fTicksPerSecond/span,1.):0.;
+}
+
+double SSPDAQ::RateAnalysis::TrueRate(const Channel& channel, unsigned long deadTicks) const{
+  double live=1.-this->DeadFraction(channel,deadTicks);
+  return live>0?this->Rate(channel)/live:0.;
+}
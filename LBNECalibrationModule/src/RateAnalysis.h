@@ -0,0 +1,120 @@
+#ifndef RATEANALYSIS_H__
+#define RATEANALYSIS_H__
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Trigger rate and timing analysis in a single pass over time-ordered events.
+  //Memory use depends only on the number of channels and the window settings,
+  //not on the number of events.
+  //
+  //For each channel this keeps:
+  //  - event count and first/last timestamp, giving the mean rate
+  //  - a histogram of the time between successive events, in log bins
+  //  - the shortest such gap, used as the dead time unless one is given
+  //Rates in a sliding window are handed to a callback each time the window
+  //moves on by one step.
+  class RateAnalysis{
+
+  public:
+
+    struct Channel{
+      unsigned int module;
+      unsigned int channel;
+      unsigned long events;
+      unsigned long first;      // timestamps, in clock ticks
+      unsigned long last;
+      unsigned long minGap;
+      unsigned long outOfOrder; // events earlier than the previous one on this channel
+      std::vector<unsigned long> gapBins; // bin 0 is a gap of 0 ticks, see GapBinLow
+      std::vector<unsigned int> window;   // counts in each step of the current window
+      unsigned long windowEvents;
+    };
+
+    //Called each time the sliding window closes a step: the window covers
+    //[start,end) in seconds from the first event, counts are indexed as Channels().
+    typedef std::function<void(double start, double end, const std::vector<Channel>& channels)> WindowCallback_t;
+
+    RateAnalysis(double clockInMHz=150., double windowInSeconds=1., double stepInSeconds=1.,
+		 unsigned int binsPerDecade=10);
+
+    void SetWindowCallback(WindowCallback_t callback){fCallback=callback;}
+
+    //Add events in time order
+    void Add(unsigned int module, unsigned int channel, unsigned long timestamp);
+
+    void Add(const unsigned short* module, const unsigned char* channel, const unsigned long* timestamp, size_t n);
+
+    //Report the window ending with the step holding the last event, which
+    //may be cut short. If the events don't fill one window, a single window
+    //from the first event to the end of the last step is reported.
+    void Finish();
+
+    inline const std::vector<Channel>& Channels() const{return fChannels;}
+
+    inline unsigned long Events() const{return fEvents;}
+
+    //Events too far out of time order to be counted in the sliding window
+    inline unsigned long LateEvents() const{return fLateEvents;}
+
+    //Lower edge of gap bin, in ticks
+    unsigned long GapBinLow(unsigned int bin) const;
+
+    //Seconds between first and last event on channel
+    double Span(const Channel& channel) const;
+
+    double Rate(const Channel& channel) const;
+
+    //Seconds between the first and last events added, on any channel
+    double Span() const;
+
+    //All events over Span(), as LBNEWare's trigger_rate.py gives it
+    double Rate() const;
+
+    //Fraction of time the channel was dead, taking each event to cause
+    //deadTicks of dead time (0 to use the shortest gap seen)
+    double DeadFraction(const Channel& channel, unsigned long deadTicks=0) const;
+
+    //Rate corrected for dead time (non-paralysable model)
+    double TrueRate(const Channel& channel, unsigned long deadTicks=0) const;
+
+  private:
+
+    Channel& GetChannel(unsigned int module, unsigned int channel);
+
+    //Close steps until step is current
+    void Advance(unsigned long step);
+
+    double fTicksPerSecond;
+
+    unsigned long fStepTicks;
+
+    unsigned int fWindowSteps;
+
+    unsigned int fBinsPerDecade;
+
+    unsigned int fNGapBins;
+
+    std::vector<Channel> fChannels;
+
+    //Index into fChannels for each module<<4|channel, -1 if not seen yet
+    std::vector<int> fChannelIndex;
+
+    bool fStarted;
+    unsigned long fStartTime;
+    unsigned long fLastTime;
+
+    //Step currently being filled, counted from fStartTime
+    unsigned long fStep;
+
+    unsigned long fEvents;
+    unsigned long fLateEvents;
+
+    WindowCallback_t fCallback;
+  };
+
+}//namespace
+#endif
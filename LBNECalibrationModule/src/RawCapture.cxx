@@ -0,0 +1,310 @@
+#include "RawCapture.h"
+#include "anlExceptions.h"
+#include "anlTypes.h"
+#include "Log.h"
+#include "NumberedFiles.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+SSPDAQ::RawCapture::RawCapture(std::string baseName, size_t ringBytes):
+  fBaseName(baseName),
+  fRing(std::max(ringBytes/sizeof(unsigned int),(size_t)1024)),
+  fHead(0),
+  fTail(0),
+  fShouldStop(false),
+  fOpen(false),
+  fFailed(false),
+  fMaxFileBytes(0),
+  fMaxFiles(0),
+  fFd(-1),
+  fFileIndex(0),
+  fFileBytes(0),
+  fWantRoll(false),
+  fNextEvent(0),
+  fInStep(true),
+  fWordsCaptured(0),
+  fWordsDropped(0),
+  fWritesDropped(0),
+  fMaxRingWords(0)
+{
+  std::memset(&fStats,0,sizeof(fStats));
+}
+
+SSPDAQ::RawCapture::~RawCapture(){
+  if(fOpen){
+    this->Close();
+  }
+}
+
+void SSPDAQ::RawCapture::SetRollover(unsigned long long maxBytes, unsigned int maxFiles){
+  fMaxFileBytes=maxBytes;
+  fMaxFiles=maxFiles;
+}
+
+void SSPDAQ::RawCapture::Open(){
+
+  if(fOpen){
+    SSPDAQ::Log::Warning()<<"RawCapture already open, ignoring Open"<<std::endl;
+    return;
+  }
+
+  fHead=0;
+  fTail=0;
+  fWordsCaptured=0;
+  fWordsDropped=0;
+  fWritesDropped=0;
+  fMaxRingWords=0;
+  std::memset(&fStats,0,sizeof(fStats));
+  fFileIndex=SSPDAQ::NextFileIndex(fBaseName,".raw");
+  fFileBytes=0;
+  fWantRoll=false;
+  //The data stream starts at an event header
+  fNextEvent=0;
+  fInStep=true;
+  fFiles.clear();
+  fFailed=false;
+  fShouldStop=false;
+
+  //Open the first file here so that a bad path is reported to the caller
+  if(!this->OpenFile()){
+    throw(EFileError(""));
+  }
+  fOpen=true;
+
+  fThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::RawCapture::Run,this));
+}
+
+bool SSPDAQ::RawCapture::Write(const unsigned int* data, size_t words){
+
+  if(!fOpen||fFailed){
+    return false;
+  }
+
+  size_t size=fRing.size();
+  size_t head=fHead.load(std::memory_order_relaxed);
+  size_t used=head-fTail.load(std::memory_order_acquire);
+  //Leave the word before the tail alone: the writer may still need it to read
+  //an event header split across two batches
+  if(words>=size-used){
+    fWordsDropped.store(fWordsDropped.load(std::memory_order_relaxed)+words,std::memory_order_relaxed);
+    fWritesDropped.store(fWritesDropped.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+    SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: raw capture has fallen behind, dropped "
+						       <<words<<" words ("<<fWordsDropped<<" in total)"<<std::endl;
+    return false;
+  }
+
+  //Copy in at most two pieces, either side of the end of the ring
+  size_t start=head%size;
+  size_t first=std::min(words,size-start);
+  std::memcpy(&fRing[start],data,first*sizeof(unsigned int));
+  if(words>first){
+    std::memcpy(&fRing[0],data+first,(words-first)*sizeof(unsigned int));
+  }
+  fHead.store(head+words,std::memory_order_release);
+
+  fWordsCaptured.store(fWordsCaptured.load(std::memory_order_relaxed)+words,std::memory_order_relaxed);
+  if(used+words>fMaxRingWords.load(std::memory_order_relaxed)){
+    fMaxRingWords.store(used+words,std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void SSPDAQ::RawCapture::Close(){
+
+  if(!fOpen){
+    return;
+  }
+
+  fShouldStop=true;
+  fThread->join();
+  fThread.reset();
+  fOpen=false;
+
+  Stats stats=this->GetStats();
+  SSPDAQ::Log::Info()<<"RawCapture wrote "<<stats.bytesWritten<<" bytes to "<<stats.filesOpened<<" files ("
+		     <<stats.filesDeleted<<" deleted), peak ring use "<<stats.maxRingWords*100/fRing.size()
+		     <<"%"<<std::endl;
+  if(stats.wordsDropped){
+    SSPDAQ::Log::Warning()<<"RawCapture dropped "<<stats.wordsDropped<<" words in "<<stats.writesDropped
+			  <<" writes; capture is incomplete"<<std::endl;
+  }
+}
+
+SSPDAQ::RawCapture::Stats SSPDAQ::RawCapture::GetStats() const{
+  std::lock_guard<std::mutex> lock(fStatsMutex);
+  Stats stats=fStats;
+  stats.wordsCaptured=fWordsCaptured;
+  stats.wordsDropped=fWordsDropped;
+  stats.writesDropped=fWritesDropped;
+  stats.maxRingWords=fMaxRingWords;
+  return stats;
+}
+
+void SSPDAQ::RawCapture::Run(){
+
+  while(true){
+    //Check for stop before looking at the ring, so that words written just
+    //before Close are still written out
+    bool stopping=fShouldStop;
+    size_t head=fHead.load(std::memory_order_acquire);
+    size_t tail=fTail.load(std::memory_order_relaxed);
+    if(head==tail){
+      if(stopping){
+	break;
+      }
+      usleep(1000);
+      continue;
+    }
+
+    //After a failure, just empty the ring so that Write sees the error and stops
+    if(!fFailed&&!this->WriteOut(tail,head-tail)){
+      SSPDAQ::Log::Error()<<"RawCapture failed writing file "<<fFileIndex<<": "<<std::strerror(errno)<<std::endl;
+      fFailed=true;
+    }
+    fTail.store(head,std::memory_order_release);
+  }
+
+  this->CloseFile();
+}
+
+bool SSPDAQ::RawCapture::WriteOut(size_t from, size_t words){
+
+  size_t size=fRing.size();
+  while(words){
+    const unsigned int* data=&fRing[from%size];
+    size_t chunk=std::min(words,size-from%size);
+    bool roll=false;
+
+    if(fMaxFileBytes&&!fWantRoll&&fFileBytes+chunk*sizeof(unsigned int)>=fMaxFileBytes){
+      //Fill the file up to its limit, then look for the next event to start a new one
+      chunk=fFileBytes<fMaxFileBytes?(fMaxFileBytes-fFileBytes)/sizeof(unsigned int):0;
+      fWantRoll=true;
+    }
+    else if(fWantRoll){
+      //Never roll over to leave an empty file
+      size_t header=this->NextEvent(fFileBytes?from:from+1,from+words);
+      if(header<from+chunk){
+	chunk=header-from;
+	roll=true;
+      }
+    }
+
+    if(chunk&&!this->WriteAll((const char*)data,chunk*sizeof(unsigned int))){
+      return false;
+    }
+    fFileBytes+=chunk*sizeof(unsigned int);
+    {
+      std::lock_guard<std::mutex> lock(fStatsMutex);
+      fStats.bytesWritten+=chunk*sizeof(unsigned int);
+    }
+    from+=chunk;
+    words-=chunk;
+
+    if(roll){
+      this->CloseFile();
+      ++fFileIndex;
+      if(!this->OpenFile()){
+	return false;
+      }
+      fFileBytes=0;
+      fWantRoll=false;
+    }
+  }
+
+  //Keep following events through everything written, since older words can
+  //be overwritten once the tail moves on
+  if(fMaxFileBytes){
+    this->NextEvent(from,from);
+  }
+  return true;
+}
+
+size_t SSPDAQ::RawCapture::NextEvent(size_t from, size_t end){
+
+  const size_t size=fRing.size();
+  const unsigned int headerWords=sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int);
+
+  while(true){
+    if(!fInStep){
+      //Lost our place: take the next header word as an event start, and check it below
+      while(fNextEvent<end&&fRing[fNextEvent%size]!=0xAAAAAAAA){
+	++fNextEvent;
+      }
+    }
+    //Length is the low half of the second word
+    if(fNextEvent+1>=end){
+      return end;
+    }
+    unsigned int length=fRing[(fNextEvent+1)%size]&0xFFFF;
+    if(fRing[fNextEvent%size]!=0xAAAAAAAA||length<headerWords){
+      if(fInStep){
+	SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: raw capture lost track of events at word "
+							    <<fNextEvent<<", resynchronizing"<<std::endl;
+      }
+      ++fNextEvent;
+      fInStep=false;
+      continue;
+    }
+    fInStep=true;
+    if(fNextEvent>=from){
+      return fNextEvent;
+    }
+    fNextEvent+=length;
+  }
+}
+
+bool SSPDAQ::RawCapture::OpenFile(){
+
+  std::string name;
+  int fd=SSPDAQ::CreateNumberedFile(fBaseName,".raw",fFileIndex,name);
+  if(fd<0){
+    SSPDAQ::Log::Error()<<"RawCapture couldn't create "<<name<<": "<<std::strerror(errno)<<std::endl;
+    return false;
+  }
+  fFd=fd;
+  fFiles.push_back(name);
+  SSPDAQ::Log::Info()<<"Capturing raw data to "<<name<<std::endl;
+
+  unsigned int deleted=0;
+  while(fMaxFiles&&fFiles.size()>fMaxFiles){
+    if(unlink(fFiles.front().c_str())){
+      SSPDAQ::Log::Warning()<<"RawCapture couldn't delete "<<fFiles.front()<<": "<<std::strerror(errno)<<std::endl;
+    }
+    else{
+      ++deleted;
+    }
+    fFiles.pop_front();
+  }
+
+  std::lock_guard<std::mutex> lock(fStatsMutex);
+  ++fStats.filesOpened;
+  fStats.filesDeleted+=deleted;
+  return true;
+}
+
+void SSPDAQ::RawCapture::CloseFile(){
+  if(fFd<0){
+    return;
+  }
+  close(fFd);
+  fFd=-1;
+}
+
+bool SSPDAQ::RawCapture::WriteAll(const char* data, size_t bytes){
+  while(bytes){
+    ssize_t written=write(fFd,data,bytes);
+    if(written<0){
+      if(errno==EINTR){
+	continue;
+      }
+      return false;
+    }
+    data+=written;
+    bytes-=written;
+  }
+  return true;
+}
@@ -0,0 +1,131 @@
+#ifndef RAWCAPTURE_H__
+#define RAWCAPTURE_H__
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Records the raw data channel stream of one board, exactly as received,
+  //so that a run can be played back later with a ReplayDevice.
+  //
+  //Write copies words into a preallocated ring and never blocks or allocates,
+  //so it can be called from the read thread. A writer thread drains the ring
+  //to files named <base>_NNNN.raw, numbered on from any already there. If the
+  //ring fills, whole Write calls are dropped and counted; the capture is only
+  //bit-for-bit complete if none were.
+  //
+  //Files roll over at the first event boundary after the size limit is reached,
+  //found by following event lengths from the last known header (and scanning
+  //for a header word only if the lengths stop making sense), so each file
+  //holds whole events and can be replayed on its own, and the
+  //files of a capture joined together give the original stream. To leave the
+  //capture running indefinitely, limit the number of files kept: the oldest
+  //are deleted as new ones are started.
+  class RawCapture{
+
+  public:
+
+    struct Stats{
+      unsigned long long wordsCaptured; // accepted by Write
+      unsigned long long wordsDropped;  // ring full
+      unsigned long writesDropped;
+      unsigned long long bytesWritten;  // to disk so far
+      unsigned int filesOpened;
+      unsigned int filesDeleted;
+      size_t maxRingWords;              // high water of ring occupancy
+    };
+
+    //Nothing is opened until Open
+    explicit RawCapture(std::string baseName, size_t ringBytes=64*1024*1024);
+
+    //Closes if still open
+    ~RawCapture();
+
+    //Start a new file once maxBytes have been written to the current one
+    //(0 for no limit), and keep at most maxFiles files (0 to keep them all)
+    void SetRollover(unsigned long long maxBytes, unsigned int maxFiles);
+
+    //Open the first file and start the writer thread. Throws EFileError if the
+    //file can't be created.
+    void Open();
+
+    //Queue words for writing. Returns false if they were dropped.
+    //Only one thread may call this.
+    bool Write(const unsigned int* data, size_t words);
+
+    bool Write(const std::vector<unsigned int>& data){
+      return data.empty()?true:this->Write(&data[0],data.size());
+    }
+
+    //Write out everything queued and close
+    void Close();
+
+    Stats GetStats() const;
+
+  private:
+
+    //Writer thread
+    void Run();
+
+    //Write words from the ring, starting at total position from, rolling over
+    //files as needed. Returns false on a write error.
+    bool WriteOut(size_t from, size_t words);
+
+    //Total position of the first event header at or after from, following
+    //event lengths through the words before end. Returns end if there is no
+    //complete header there yet.
+    size_t NextEvent(size_t from, size_t end);
+
+    //Open file number fFileIndex, deleting the oldest if there are too many
+    bool OpenFile();
+
+    void CloseFile();
+
+    bool WriteAll(const char* data, size_t bytes);
+
+    std::string fBaseName;
+
+    //Ring of words. Positions are totals since Open, taken modulo the size.
+    std::vector<unsigned int> fRing;
+
+    //Written only by Write and by the writer thread respectively
+    std::atomic<size_t> fHead;
+    std::atomic<size_t> fTail;
+
+    std::atomic<bool> fShouldStop;
+    bool fOpen;
+    std::atomic<bool> fFailed;
+
+    unsigned long long fMaxFileBytes;
+    unsigned int fMaxFiles;
+
+    //File state, owned by the writer thread once running
+    int fFd;
+    unsigned int fFileIndex;
+    unsigned long long fFileBytes;
+    bool fWantRoll; // waiting for the next event header to roll over
+    size_t fNextEvent; // total position of the next event header to check
+    bool fInStep; // fNextEvent reached by following lengths from a good header
+    std::deque<std::string> fFiles; // kept so far, oldest first
+
+    //Counters updated by Write, read by GetStats
+    std::atomic<unsigned long long> fWordsCaptured;
+    std::atomic<unsigned long long> fWordsDropped;
+    std::atomic<unsigned long> fWritesDropped;
+    std::atomic<size_t> fMaxRingWords;
+
+    //Protects the rest of the stats, updated by the writer thread
+    mutable std::mutex fStatsMutex;
+    Stats fStats;
+
+    std::unique_ptr<std::thread> fThread;
+  };
+
+}//namespace
+#endif
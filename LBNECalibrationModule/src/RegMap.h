@@ -4,8 +4,9 @@
 #include "anlTypes.h"
 #include <iostream>
 #include "Log.h"
-#include <map>
+#include <string>
 #include "anlExceptions.h"
+#include "RegTable.h"
 
 #define COMM_CONFIG_ROM_ADDRESS		0x20000000
 #define DSP_A_CONFIG_ROM_ADDRESS	0x20010000
@@ -15,248 +16,282 @@
 
 namespace SSPDAQ{
 
-//Singleton containing human-readable names for SSP registers.
-//Note that Zynq registers are in camelCase, and Artix registers
-//are spaced_with_underscores.  
+//FNV-1a hash of a register name, used for RegMap's name lookup
+constexpr unsigned int RegNameHash(const char* name, unsigned int hash=2166136261u){
+  return *name?RegNameHash(name+1,(hash^(unsigned char)*name)*16777619u):hash;
+}
+
+constexpr bool RegNameEqual(const char* a, const char* b){
+  return *a==*b&&(*a=='\0'||RegNameEqual(a+1,b+1));
+}
+
+//Address and masks of an SSP register or register array. Everything here is
+//constexpr, so registers named in code resolve at compile time.
+class Register{
+ public:
+  constexpr Register(unsigned int address, unsigned int readMask, unsigned int writeMask,
+		     unsigned int size=1, unsigned int offset=0, unsigned int bits=32):
+  fAddress(address),
+    fReadMask(readMask),
+    fWriteMask(writeMask),
+    fSize(size),
+    fOffset(offset),
+    fBits(bits){}
+
+  constexpr Register():
+    fAddress(0x00000000),
+    fReadMask(0xFFFFFFFF),
+    fWriteMask(0xFFFFFFFF),
+    fSize(1),
+    fOffset(0),
+    fBits(32){}
+
+  //Allow implicit conversion to unsigned int for scalar registers
+  constexpr operator unsigned int() const{
+    return fSize>1?ScalarError():fAddress;
+  }
+
+  //Indexing returns another register with correct address offset and size 1
+  constexpr Register operator[](unsigned int i) const{
+    return i<fSize?Register(fAddress+0x4*i,fReadMask,fWriteMask,1,fOffset,fBits):IndexError(i);
+  }
+
+  //Getters and setters
+
+  constexpr unsigned int Address() const{
+    return fAddress;
+  }
+
+  constexpr unsigned int ReadMask() const{
+    return fReadMask;
+  }
+
+  constexpr unsigned int WriteMask() const{
+    return fWriteMask;
+  }
+
+  constexpr unsigned int Offset() const{
+    return fOffset;
+  }
+
+  constexpr unsigned int Bits() const{
+    return fBits;
+  }
+
+  constexpr unsigned int Size() const{
+    return fSize;
+  }
+
+ private:
+
+  //Log and throw; never reached in constant expressions, where misuse fails to compile
+  unsigned int ScalarError() const;
+  Register IndexError(unsigned int i) const;
+
+  //Address of register in SSP space
+  unsigned int fAddress;
+
+  //Readable/writable bits in this register for calling code to check
+  //that read/write requests make sense
+  unsigned int fReadMask;
+  unsigned int fWriteMask;
+
+  unsigned int fSize;
+
+  //Bit offset of relevant quantity relative to start of addressed word.
+  //Not currently used but we could use this to "virtually" address logical quantities
+  //which are assigned only part of a 32-bit word
+  unsigned int fOffset;
+
+  //Number of bits assigned to relevant quantity. Not currently used (see above)
+  unsigned int fBits;
+};
+
+//Throws for a value too big for its field. Never reached in constant
+//expressions, where it fails to compile instead.
+unsigned int FieldRangeError(unsigned int value, unsigned int offset, unsigned int bits);
+
+//Group of bits within a packed register word. Tag is the struct in RegMap
+//listing that register's fields, so fields of different registers can't be
+//mixed, nor used with a register laid out differently (see TypedRegister).
+template<class Tag> class Field{
+ public:
+  constexpr Field(unsigned int offset, unsigned int bits):
+  fOffset(offset),
+    fBits(bits){}
+
+  constexpr unsigned int Offset() const{
+    return fOffset;
+  }
+
+  constexpr unsigned int Bits() const{
+    return fBits;
+  }
+
+  //Largest value the field can hold
+  constexpr unsigned int Max() const{
+    return fBits>=32?0xFFFFFFFF:(1u<<fBits)-1;
+  }
+
+  constexpr unsigned int Mask() const{
+    return Max()<<fOffset;
+  }
+
+  //Value shifted into place in the register word
+  constexpr unsigned int Encode(unsigned int value) const{
+    return value>Max()?FieldRangeError(value,fOffset,fBits):value<<fOffset;
+  }
+
+  //Value of field in register word
+  constexpr unsigned int Decode(unsigned int word) const{
+    return (word>>fOffset)&Max();
+  }
+
+ private:
+
+  unsigned int fOffset;
+  unsigned int fBits;
+};
+
+//Values for some of the fields of a packed register, collected with Set so
+//they can be written in one go (see DeviceInterface::SetRegisterFields)
+template<class Tag> class FieldValues{
+ public:
+  constexpr FieldValues():
+  fMask(0),
+    fValue(0){}
+
+  constexpr FieldValues Set(const Field<Tag>& field, unsigned int value) const{
+    return FieldValues(fMask|field.Mask(),(fValue&~field.Mask())|field.Encode(value));
+  }
+
+  //Bits covered by the fields set so far
+  constexpr unsigned int Mask() const{
+    return fMask;
+  }
+
+  //Register word with the fields set so far, zero elsewhere
+  constexpr unsigned int Value() const{
+    return fValue;
+  }
+
+ private:
+
+  constexpr FieldValues(unsigned int mask, unsigned int value):
+  fMask(mask),
+    fValue(value){}
+
+  unsigned int fMask;
+  unsigned int fValue;
+};
+
+//Register laid out with the fields listed in Tag, so that only values for
+//those fields can be written to it (see DeviceInterface::SetRegisterFields)
+template<class Tag> class TypedRegister: public Register{
+ public:
+  constexpr explicit TypedRegister(const Register& reg):
+  Register(reg){}
+
+  constexpr TypedRegister operator[](unsigned int i) const{
+    return TypedRegister(Register::operator[](i));
+  }
+};
+
+//Human-readable names for SSP registers, generated from the table in RegTable.h.
+//Each register is a constexpr static member, e.g. RegMap::bias_config[3], and
+//names given as strings are found with one probe of a perfect hash table built
+//at compile time. Nothing is set up at run time.
 class RegMap{
  public:
 
-  //Get a reference to the instance of RegMap
-  static RegMap& Get();
+  typedef SSPDAQ::Register Register;
 
-  class Register{
-  public:
-    Register(unsigned int address, unsigned int readMask, unsigned int writeMask,
-	     unsigned int size=1, unsigned int offset=0, unsigned int bits=32):
-    fAddress(address),
-      fReadMask(readMask),
-      fWriteMask(writeMask),
-      fSize(size),
-      fOffset(offset),
-      fBits(bits){}
-
-  Register():
-      fAddress(0x00000000),
-      fReadMask(0xFFFFFFFF),
-      fWriteMask(0xFFFFFFFF),
-      fSize(1),
-      fOffset(0),
-      fBits(32){}
-
-    //Allow implicit conversion to unsigned int for scalar registers
-    operator unsigned int(){
-      if(fSize>1){
-	SSPDAQ::Log::Error()<<"Attempt to access SSP register array at "
-			    <<std::hex<<fAddress<<std::dec<<" as scalar!"<<std::endl;
-	throw(std::invalid_argument(""));
-      }
-      return fAddress;
-    }
-
-    //Indexing returns another register with correct address offset and size 1
-    Register operator[](unsigned int i) const{
-      if(i>=fSize){
-	SSPDAQ::Log::Error()<<"Attempt to access SSP register at "
-			    <<std::hex<<fAddress<<std::dec<<" index "<<i
-			    <<", beyond end of array (size is "<<fSize<<")"<<std::endl;
-      }
-      return Register(fAddress+0x4*i,fReadMask,fWriteMask,fOffset,1);
-    }
-
-    //Getters and setters
-
-    inline unsigned int ReadMask() const{
-      return fReadMask;
-    }
-
-    inline unsigned int WriteMask() const{
-      return fWriteMask;
-    }
-
-    inline unsigned int Offset() const{
-      return fOffset;
-    }
-
-    inline unsigned int Bits() const{
-      return fBits;
-    }
-
-    inline unsigned int Size() const{
-      return fSize;
-    }
-
-  private:
-
-    //Address of register in SSP space
-    unsigned int fAddress;
-
-    //Readable/writable bits in this register for calling code to check
-    //that read/write requests make sense
-    unsigned int fReadMask;
-    unsigned int fWriteMask;
-
-    unsigned int fSize;
-
-    //Bit offset of relevant quantity relative to start of addressed word.
-    //Not currently used but we could use this to "virtually" address logical quantities
-    //which are assigned only part of a 32-bit word
-    unsigned int fOffset;
-
-    //Number of bits assigned to relevant quantity. Not currently used (see above)
-    unsigned int fBits;
+  struct Entry{
+    const char* name;
+    Register reg;
   };
 
+#define SSPDAQ_REGMAP_COUNT(name,address,readMask,writeMask,size) +1
+  static constexpr unsigned int kNRegisters=0 SSPDAQ_REGISTERS(SSPDAQ_REGMAP_COUNT);
+#undef SSPDAQ_REGMAP_COUNT
+
+  //Get a reference to the instance of RegMap
+  static RegMap& Get();
+
   //Get registers using variable names...
-  Register operator[](std::string name){
-    if(fNamed.find(name)==fNamed.end()){
-      SSPDAQ::Log::Error()<<"Attempt to access named SSP register "<<name
-			  <<", which does not exist!"<<std::endl;
-      throw(std::invalid_argument(""));
-    }
-    return fNamed[name];
+  Register operator[](const std::string& name) const{
+    return Find(name.c_str());
+  }
+
+  static Register Find(const char* name);
+
+  //Resolve a name at compile time, e.g. constexpr Register r=RegMap::Lookup("cal_count");
+  //A linear search, so use Find for names only known at run time.
+  static constexpr Register Lookup(const char* name, unsigned int i=0){
+    return i>=kNRegisters?NameError(name):
+      RegNameEqual(fTable[i].name,name)?fTable[i].reg:Lookup(name,i+1);
+  }
+
+  //Full list of named registers, e.g. for building an emulated register space
+  static const Entry* Table(){
+    return fTable;
   }
 
-  // Registers in the ARM Processor
-  unsigned int armStatus;
-  unsigned int armError;
-  unsigned int armCommand;
-  unsigned int armVersion;
-  unsigned int armTest[4];
-  unsigned int armRxAddress;	// 0x00000020
-  unsigned int armRxCommand;	// 0x00000024
-  unsigned int armRxSize;		// 0x00000028
-  unsigned int armRxStatus;	// 0x0000002C
-  unsigned int armTxAddress;	// 0x00000030
-  unsigned int armTxCommand;	// 0x00000034
-  unsigned int armTxSize;		// 0x00000038
-  unsigned int armTxStatus;	// 0x0000003C
-  unsigned int armPackets;	// 0x00000040
-  unsigned int armOperMode;	// 0x00000044
-  unsigned int armOptions;	// 0x00000048
-  unsigned int armModemStatus;// 0x0000004C
-  unsigned int PurgeDDR;        // 0x00000300
-
-  // Registers in the Zynq FPGA
-  unsigned int zynqTest[6];
-  unsigned int eventDataInterfaceSelect;
-  unsigned int fakeNumEvents;
-  unsigned int fakeEventSize;
-  unsigned int fakeBaseline;
-  unsigned int fakePeakSum;
-  unsigned int fakePrerise;
-  unsigned int timestamp[2];
-  unsigned int codeErrCounts[5];
-  unsigned int dispErrCounts[5];
-  unsigned int link_rx_status;
-  unsigned int eventDataControl;
-  unsigned int eventDataPhaseControl;
-  unsigned int eventDataPhaseStatus;
-  unsigned int c2c_master_status;
-  unsigned int c2c_control;
-  unsigned int c2c_master_intr_control;
-  unsigned int dspStatus;
-  unsigned int comm_clock_status;
-  unsigned int comm_clock_control;
-  unsigned int comm_led_config;
-  unsigned int comm_led_input;
-  unsigned int eventDataStatus;
-  unsigned int qi_dac_control;			
-  unsigned int qi_dac_config;			
-  
-  unsigned int bias_control;			
-  unsigned int bias_status;			
-  unsigned int bias_config[12];	
-  unsigned int bias_readback[12];	
-  
-  unsigned int mon_config;			
-  unsigned int mon_select;			
-  unsigned int mon_gpio;			
-  unsigned int mon_config_readback;		
-  unsigned int mon_select_readback;		
-  unsigned int mon_gpio_readback;		
-  unsigned int mon_id_readback;			
-  unsigned int mon_control;			
-  unsigned int mon_status;			
-  unsigned int mon_bias[12];		
-  unsigned int mon_value[9];			
-
-  // Registers in the Artix FPGA
-  unsigned int board_id;
-  unsigned int fifo_control;
-  unsigned int dsp_clock_status;
-  unsigned int module_id;
-  unsigned int c2c_slave_status;
-  unsigned int c2c_slave_intr_control;
-
-  unsigned int channel_control[12];
-  unsigned int led_threshold[12];
-  unsigned int cfd_parameters[12];
-  unsigned int readout_pretrigger[12];
-  unsigned int readout_window[12];
-
-  unsigned int p_window[12];
-  unsigned int i2_window[12];
-  unsigned int m1_window[12];
-  unsigned int m2_window[12];
-  unsigned int d_window[12];
-  unsigned int i1_window[12];
-  unsigned int disc_width[12];
-  unsigned int baseline_start[12];
-
-  unsigned int trigger_input_delay;
-  unsigned int gpio_output_width;
-  unsigned int front_panel_config;
-  unsigned int channel_pulsed_control;
-  unsigned int dsp_led_config;
-  unsigned int dsp_led_input;
-  unsigned int baseline_delay;
-  unsigned int diag_channel_input;
-  unsigned int event_data_control;
-  unsigned int adc_config;
-  unsigned int adc_config_load;
-  unsigned int qi_config;
-  unsigned int qi_delay;
-  unsigned int qi_pulse_width;
-  unsigned int qi_pulsed;
-  unsigned int external_gate_width;
-  unsigned int lat_timestamp_lsb;
-  unsigned int lat_timestamp_msb;
-  unsigned int live_timestamp_lsb;
-  unsigned int live_timestamp_msb;
-  unsigned int sync_period;
-  unsigned int sync_delay;
-  unsigned int sync_count;
-	
-  unsigned int master_logic_control;
-  unsigned int trigger_config;
-  unsigned int overflow_status;
-  unsigned int phase_value;
-  unsigned int link_tx_status;
-  unsigned int dsp_clock_control;
-  unsigned int dsp_clock_phase_control;
-	
-  unsigned int code_revision;
-  unsigned int code_date;
-
-  unsigned int dropped_event_count[12];
-  unsigned int accepted_event_count[12];
-  unsigned int ahit_count[12];
-  unsigned int disc_count[12];
-  unsigned int idelay_count[12];
-  unsigned int adc_data_monitor[12];
-  unsigned int adc_status[12];
-  
-  // Registers specific to the LBNE Calibration Module
-  unsigned int cal_config[12];
-  unsigned int cal_count;
-  unsigned int cal_status;
-  unsigned int cal_trigger;
+#define SSPDAQ_REGMAP_MEMBER(name,address,readMask,writeMask,size) \
+  static constexpr Register name=Register(address,readMask,writeMask,size);
+  SSPDAQ_REGISTERS(SSPDAQ_REGMAP_MEMBER)
+#undef SSPDAQ_REGMAP_MEMBER
+
+  //Fields of packed registers, and the registers laid out with them. Values
+  //are collected and written like
+  //  dev.SetRegisterFields(RegMap::CalConfig::iu_cal_config,
+  //    RegMap::CalConfig::Values().Set(RegMap::CalConfig::trigger_source,4).Set(RegMap::CalConfig::pulse_width_1,0x3F))
+#define SSPDAQ_REGMAP_FIELD(name,offset,bits) \
+  static constexpr Field<Tag> name=Field<Tag>(offset,bits);
+#define SSPDAQ_REGMAP_TYPED(name) \
+  static constexpr TypedRegister<Tag> name=TypedRegister<Tag>(RegMap::name);
+
+  struct ChannelControl{
+    typedef ChannelControl Tag;
+    typedef FieldValues<Tag> Values;
+    SSPDAQ_CHANNEL_CONTROL_FIELDS(SSPDAQ_REGMAP_FIELD)
+    SSPDAQ_CHANNEL_CONTROL_REGISTERS(SSPDAQ_REGMAP_TYPED)
+  };
+
+  struct CalConfig{
+    typedef CalConfig Tag;
+    typedef FieldValues<Tag> Values;
+    SSPDAQ_CAL_CONFIG_FIELDS(SSPDAQ_REGMAP_FIELD)
+    SSPDAQ_CAL_CONFIG_REGISTERS(SSPDAQ_REGMAP_TYPED)
+  };
+
+  struct BiasConfig{
+    typedef BiasConfig Tag;
+    typedef FieldValues<Tag> Values;
+    SSPDAQ_BIAS_CONFIG_FIELDS(SSPDAQ_REGMAP_FIELD)
+    SSPDAQ_BIAS_CONFIG_REGISTERS(SSPDAQ_REGMAP_TYPED)
+  };
+
+  struct DspClockControl{
+    typedef DspClockControl Tag;
+    typedef FieldValues<Tag> Values;
+    SSPDAQ_DSP_CLOCK_CONTROL_FIELDS(SSPDAQ_REGMAP_FIELD)
+    SSPDAQ_DSP_CLOCK_CONTROL_REGISTERS(SSPDAQ_REGMAP_TYPED)
+  };
+#undef SSPDAQ_REGMAP_TYPED
+#undef SSPDAQ_REGMAP_FIELD
 
  private:
   RegMap(){};
   RegMap(RegMap const&); //Don't implement
   void operator=(RegMap const&); //Don't implement
-  std::map<std::string, Register> fNamed;
+
+  static Register NameError(const char* name);
+
+#define SSPDAQ_REGMAP_ENTRY(name,address,readMask,writeMask,size) \
+  {#name,Register(address,readMask,writeMask,size)},
+  static constexpr Entry fTable[kNRegisters]={SSPDAQ_REGISTERS(SSPDAQ_REGMAP_ENTRY)};
+#undef SSPDAQ_REGMAP_ENTRY
 };
 
 }//namespace
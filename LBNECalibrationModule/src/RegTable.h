@@ -0,0 +1,210 @@
+#ifndef REGTABLE_H__
+#define REGTABLE_H__
+
+//Table of named SSP registers, expanded by RegMap into constexpr handles and
+//its name lookup table. Each entry is
+//  X(name, address, read mask, write mask, size)
+//with size the number of consecutive words for register arrays.
+//Zynq registers are in camelCase, and Artix registers are spaced_with_underscores.
+//NOTE: All comments about default values, read masks, and write masks are current as of 2/11/2014
+#define SSPDAQ_REGISTERS(X) \
+  /* Registers in the ARM Processor */ \
+  X(armStatus,                 0x00000000, 0xFFFFFFFF, 0x00000000,  1) /* rregStatus, default 0xABCDEF01 */ \
+  X(armError,                  0x00000004, 0xFFFFFFFF, 0x00000000,  1) /* regError, default 0xEF012345 */ \
+  X(armCommand,                0x00000008, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* regCommand, default 0x00000000 */ \
+  X(armVersion,                0x0000000C, 0xFFFFFFFF, 0x00000000,  1) /* regVersion, default 0x00000001 */ \
+  X(armTest,                   0x00000010, 0xFFFFFFFF, 0xFFFFFFFF,  4) /* regTest0, default 0x12345678 */ \
+  X(armRxAddress,              0x00000020, 0xFFFFFFFF, 0x00000000,  1) /* regRxAddress, default 0xFFFFFFF0 */ \
+  X(armRxCommand,              0x00000024, 0xFFFFFFFF, 0x00000000,  1) /* regRxCommand, default 0xFFFFFFF1 */ \
+  X(armRxSize,                 0x00000028, 0xFFFFFFFF, 0x00000000,  1) /* regRxSize, default 0xFFFFFFF2 */ \
+  X(armRxStatus,               0x0000002C, 0xFFFFFFFF, 0x00000000,  1) /* regRxStatus, default 0xFFFFFFF3 */ \
+  X(armTxAddress,              0x00000030, 0xFFFFFFFF, 0x00000000,  1) /* regTxAddress, default 0xFFFFFFF4 */ \
+  X(armTxCommand,              0x00000034, 0xFFFFFFFF, 0x00000000,  1) /* regTxCommand, default 0xFFFFFFF5 */ \
+  X(armTxSize,                 0x00000038, 0xFFFFFFFF, 0x00000000,  1) /* regTxSize, default 0xFFFFFFF6 */ \
+  X(armTxStatus,               0x0000003C, 0xFFFFFFFF, 0x00000000,  1) /* regTxStatus, default 0xFFFFFFF7 */ \
+  X(armPackets,                0x00000040, 0xFFFFFFFF, 0x00000000,  1) /* regPackets, default 0x00000000 */ \
+  X(armOperMode,               0x00000044, 0xFFFFFFFF, 0x00000000,  1) /* regOperMode, default 0x00000000 */ \
+  X(armOptions,                0x00000048, 0xFFFFFFFF, 0x00000000,  1) /* regOptions, default 0x00000000 */ \
+  X(armModemStatus,            0x0000004C, 0xFFFFFFFF, 0x00000000,  1) /* regModemStatus, default 0x00000000 */ \
+  X(PurgeDDR,                  0x00000300, 0x00000001, 0x00000001,  1) /* default 0x00000000 */ \
+  /* Registers in the Zynq FPGA */ \
+  X(zynqTest,                  0x40000000, 0xFFFFFFFF, 0x00000000,  6) /* regin_test_0, default 0x33333333 */ \
+  X(eventDataInterfaceSelect,  0x40000020, 0xFFFFFFFF, 0x00000001,  1) /* reg_fake_control, default 0x00000000 */ \
+  X(fakeNumEvents,             0x40000024, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_fake_num_events, default 0x00000000 */ \
+  X(fakeEventSize,             0x40000028, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_fake_event_size, default 0x00000000 */ \
+  X(fakeBaseline,              0x4000002C, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_fake_baseline, default 0x00000000 */ \
+  X(fakePeakSum,               0x40000030, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_fake_peak_sum, default 0x00000000 */ \
+  X(fakePrerise,               0x40000034, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_fake_prerise, default 0x00000000 */ \
+  X(timestamp,                 0x40000038, 0xFFFFFFFF, 0x00000000,  2) /* regin_timestamp (low bits), default 0x00000000 */ \
+  X(codeErrCounts,             0x40000100, 0xFFFFFFFF, 0x00000000,  5) /* regin_code_err_counts, default 0x00000000 */ \
+  X(dispErrCounts,             0x40000120, 0xFFFFFFFF, 0x00000000,  5) /* regin_disp_err_counts, default 0x00000000 */ \
+  X(link_rx_status,            0x40000140, 0xFFFFFFFF, 0x00000000,  1) /* regin_link_status, default 0x00000000 */ \
+  X(eventDataControl,          0x40000144, 0xFFFFFFFF, 0x0033001F,  1) /* reg_event_data_control, default 0x0020001F */ \
+  X(eventDataPhaseControl,     0x40000148, 0x00000000, 0x00000003,  1) /* reg_event_data_phase_control, default 0x00000000 */ \
+  X(eventDataPhaseStatus,      0x4000014C, 0xFFFFFFFF, 0x00000000,  1) /* reg_event_data_phase_status, default 0x00000000 */ \
+  X(c2c_master_status,         0x40000150, 0xFFFFFFFF, 0x00000000,  1) /* regin_c2c_status, default 0x00000000 */ \
+  X(c2c_control,               0x40000154, 0xFFFFFFFF, 0x00000007,  1) /* reg_c2c_control, default 0x00000007 */ \
+  X(c2c_master_intr_control,   0x40000158, 0xFFFFFFFF, 0x0000000F,  1) /* reg_c2c_intr_control, default 0x00000000 */ \
+  X(dspStatus,                 0x40000160, 0xFFFFFFFF, 0x00000000,  1) /* regin_dsp_status, default 0x00000000 */ \
+  X(comm_clock_status,         0x40000170, 0xFFFFFFFF, 0x00000000,  1) /* regin_clock_status, default 0x00000000 */ \
+  X(comm_clock_control,        0x40000174, 0xFFFFFFFF, 0x00000001,  1) /* reg_clock_control, default 0x00000001 */ \
+  X(comm_led_config,           0x40000180, 0xFFFFFFFF, 0x00000003,  1) /* reg_led_config, default 0x00000000 */ \
+  X(comm_led_input,            0x40000184, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_led_input, default 0x00000000 */ \
+  X(eventDataStatus,           0x40000190, 0xFFFFFFFF, 0x00000000,  1) /* regin_event_data_status, default 0x00000000 */ \
+  X(qi_dac_control,            0x40000200, 0x00000000, 0x00000001,  1) /* reg_qi_dac_control, default 0x00000000 */ \
+  X(qi_dac_config,             0x40000204, 0x0003FFFF, 0x0003FFFF,  1) /* reg_qi_dac_config, default 0x00008000 */ \
+  X(bias_control,              0x40000300, 0x00000000, 0x00000001,  1) /* reg_bias_control, default 0x00000000 */ \
+  X(bias_status,               0x40000304, 0x00000FFF, 0x00000000,  1) /* regin_bias_status, default 0x00000000 */ \
+  X(bias_config,               0x40000340, 0xFFFFFFFF, 0x00440FFF, 12) /* reg_bias_dac_config, default 0x00000000 */ \
+  X(bias_readback,             0x40000380, 0xFFFFFFFF, 0x00000000, 12) /* regin_bias_dac_readback, default 0x00000000 */ \
+  X(mon_config,                0x40000400, 0x00FFFFFF, 0x00FFFFFF,  1) /* reg_mon_config, default 0x0012F000 */ \
+  X(mon_select,                0x40000404, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_mon_select, default 0x00FFFF00 */ \
+  X(mon_gpio,                  0x40000408, 0x0000FFFF, 0x0000FFFF,  1) /* reg_mon_gpio, default 0x00000000 */ \
+  X(mon_config_readback,       0x40000410, 0x00FFFFFF, 0x00000000,  1) /* regin_mon_config_readback, default 0x00000000 */ \
+  X(mon_select_readback,       0x40000414, 0xFFFFFFFF, 0x00000000,  1) /* regin_mon_select_readback, default 0x00000000 */ \
+  X(mon_gpio_readback,         0x40000418, 0x0000FFFF, 0x00000000,  1) /* regin_mon_gpio_readback, default 0x00000000 */ \
+  X(mon_id_readback,           0x4000041C, 0x000000FF, 0x00000000,  1) /* regin_mon_id_readback, default 0x00000000 */ \
+  X(mon_control,               0x40000420, 0x00010100, 0x00010001,  1) /* reg_mon_control & regin_mon_control, default 0x00000000 */ \
+  X(mon_status,                0x40000424, 0xFFFFFFFF, 0x00000000,  1) /* regin_mon_status, default 0x00000000 */ \
+  X(mon_bias,                  0x40000440, 0xFFFFFFFF, 0x00000000, 12) /* regin_mon_bias, default 0x00000000 */ \
+  X(mon_value,                 0x40000480, 0xFFFFFFFF, 0x00000000,  9) /* regin_mon_value, default 0x00000000 */ \
+  /* Registers in the Artix FPGA */ \
+  X(board_id,                  0x80000000, 0xFFFFFFFF, 0x00000000,  1) /* reg_board_id, default 0x00000000 */ \
+  X(fifo_control,              0x80000004, 0x0FFFFFFF, 0x08000000,  1) /* reg_fifo_control, default 0x00000000 */ \
+  X(dsp_clock_status,          0x80000020, 0xFFFFFFFF, 0x00000000,  1) /* reg_mmcm_status, default 0x00000000 */ \
+  X(module_id,                 0x80000024, 0x00000FFF, 0x00000FFF,  1) /* reg_module_id, default 0x00000000 */ \
+  X(c2c_slave_status,          0x80000030, 0xFFFFFFFF, 0x00000000,  1) /* reg_c2c_status, default 0x00000000 */ \
+  X(c2c_slave_intr_control,    0x80000034, 0xFFFFFFFF, 0x0000000F,  1) /* reg_c2c_intr_control, default 0x00000000 */ \
+  X(channel_control,           0x80000040, 0xFFFFFFFF, 0xFFFFFFFF, 12) /* reg_channel_control, default 0x00000000 */ \
+  X(led_threshold,             0x80000080, 0x00FFFFFF, 0x00FFFFFF, 12) /* reg_led_threshold, default 0x00000064 */ \
+  X(cfd_parameters,            0x800000C0, 0x00001FFF, 0x00001FFF, 12) /* reg_cfd_parameters, default 0x00001800 */ \
+  X(readout_pretrigger,        0x80000100, 0x000007FF, 0x000007FF, 12) /* reg_readout_pretrigger, default 0x00000019 */ \
+  X(readout_window,            0x80000140, 0x000007FE, 0x000007FE, 12) /* reg_readout_window, default 0x000000C8 */ \
+  X(p_window,                  0x80000180, 0x000003FF, 0x000003FF, 12) /* reg_p_window, default 0x00000000 */ \
+  X(i2_window,                 0x800001C0, 0x000003FF, 0x000003FF, 12) /* reg_i2_window, default 0x00000014 */ \
+  X(m1_window,                 0x80000200, 0x000003FF, 0x000003FF, 12) /* reg_m1_window, default 0x0000000A */ \
+  X(m2_window,                 0x80000240, 0x0000007F, 0x0000007F, 12) /* reg_m2_window, default 0x00000014 */ \
+  X(d_window,                  0x80000280, 0x0000007F, 0x0000007F, 12) /* reg_d_window, default 0x00000014 */ \
+  X(i1_window,                 0x800002C0, 0x000003FF, 0x000003FF, 12) /* reg_i1_window, default 0x00000010 */ \
+  X(disc_width,                0x80000300, 0x0000FFFF, 0x0000FFFF, 12) /* reg_disc_width, default 0x00000000 */ \
+  X(baseline_start,            0x80000340, 0x00003FFF, 0x00003FFF, 12) /* reg_baseline_start, default 0x00002000 */ \
+  X(trigger_input_delay,       0x80000400, 0x0000FFFF, 0x0000FFFF,  1) /* reg_trigger_input_delay, default 0x00000010 */ \
+  X(gpio_output_width,         0x80000404, 0x0000FFFF, 0x0000FFFF,  1) /* reg_gpio_output_width, default 0x0000000F */ \
+  X(front_panel_config,        0x80000408, 0x00730333, 0x00730333,  1) /* reg_misc_config, default 0x00000111 */ \
+  X(channel_pulsed_control,    0x8000040C, 0x00000000, 0xFFFFFFFF,  1) /* reg_channel_pulsed_control, default 0x00000000 */ \
+  X(dsp_led_config,            0x80000410, 0xFFFFFFFF, 0x00000003,  1) /* reg_led_config, default 0x00000000 */ \
+  X(dsp_led_input,             0x80000414, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_led_input, default 0x00000000 */ \
+  X(baseline_delay,            0x80000418, 0x000000FF, 0x000000FF,  1) /* reg_baseline_delay, default 0x00000019 */ \
+  X(diag_channel_input,        0x8000041C, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_diag_channel_input, default 0x00000000 */ \
+  X(event_data_control,        0x80000424, 0x00020001, 0x00020001,  1) /* reg_event_data_control, default 0x00000001 */ \
+  X(adc_config,                0x80000428, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* reg_adc_config, default 0x00010000 */ \
+  X(adc_config_load,           0x8000042C, 0x00000000, 0x00000001,  1) /* reg_adc_config_load, default 0x00000000 */ \
+  X(qi_config,                 0x80000430, 0x0FFF1F11, 0x0FFF1F11,  1) /* reg_qi_config, default 0x0FFF1700 */ \
+  X(qi_delay,                  0x80000434, 0x0000007F, 0x0000007F,  1) /* reg_qi_delay, default 0x00000000 */ \
+  X(qi_pulse_width,            0x80000438, 0x0000FFFF, 0x0000FFFF,  1) /* reg_qi_pulse_width, default 0x00000000 */ \
+  X(qi_pulsed,                 0x8000043C, 0x00000000, 0x00030001,  1) /* reg_qi_pulsed, default 0x00000000 */ \
+  X(external_gate_width,       0x80000440, 0x0000FFFF, 0x0000FFFF,  1) /* reg_external_gate_width, default 0x00008000 */ \
+  X(lat_timestamp_lsb,         0x80000484, 0xFFFFFFFF, 0x00000000,  1) /* reg_lat_timestamp (lsb), default 0x00000000 */ \
+  X(lat_timestamp_msb,         0x80000488, 0x0000FFFF, 0x00000000,  1) /* reg_lat_timestamp (msb), default 0x00000000 */ \
+  X(live_timestamp_lsb,        0x8000048C, 0xFFFFFFFF, 0x00000000,  1) /* reg_live_timestamp (lsb), default 0x00000000 */ \
+  X(live_timestamp_msb,        0x80000490, 0x0000FFFF, 0x00000000,  1) /* reg_live_timestamp (msb), default 0x00000000 */ \
+  X(sync_period,               0x80000494, 0xFFFFFFFF, 0x00000000,  1) /* reg_last_sync_reset_count, default 0x00000000 */ \
+  X(sync_delay,                0x80000498, 0xFFFFFFFF, 0x00000000,  1) /* reg_external_timestamp (lsb), default 0x00000000 */ \
+  X(sync_count,                0x8000049C, 0xFFFFFFFF, 0x00000000,  1) /* reg_external_timestamp (msb), default 0x00000000 */ \
+  X(master_logic_control,      0x80000500, 0xFFFFFFFF, 0x00000073,  1) /* reg_master_logic_status, default 0x00000000 */ \
+  X(trigger_config,            0x80000504, 0x00000003, 0x00000003,  1) /* reg_trigger_config, default 0x00000000 */ \
+  X(overflow_status,           0x80000508, 0xFFFFFFFF, 0x00000000,  1) /* reg_overflow_status, default 0x00000000 */ \
+  X(phase_value,               0x8000050C, 0xFFFFFFFF, 0x00000000,  1) /* reg_phase_value, default 0x00000000 */ \
+  X(link_tx_status,            0x80000510, 0xFFFFFFFF, 0x00000000,  1) /* reg_link_status, default 0x00000000 */ \
+  X(dsp_clock_control,         0x80000520, 0x00000713, 0x00000713,  1) /* reg_dsp_clock_control, default 0x00000000 */ \
+  X(dsp_clock_phase_control,   0x80000524, 0x00000000, 0x00000007,  1) /* reg_dsp_clock_phase_control, default 0x00000000 */ \
+  X(code_revision,             0x80000600, 0xFFFFFFFF, 0x00000000,  1) /* reg_code_revision, default 0x00000000 */ \
+  X(code_date,                 0x80000604, 0xFFFFFFFF, 0x00000000,  1) /* reg_code_date, default 0x00000000 */ \
+  X(dropped_event_count,       0x80000700, 0xFFFFFFFF, 0x00000000, 12) /* reg_dropped_event_count, default 0x00000000 */ \
+  X(accepted_event_count,      0x80000740, 0xFFFFFFFF, 0x00000000, 12) /* reg_accepted_event_count, default 0x00000000 */ \
+  X(ahit_count,                0x80000780, 0xFFFFFFFF, 0x00000000, 12) /* reg_ahit_count, default 0x00000000 */ \
+  X(disc_count,                0x800007C0, 0xFFFFFFFF, 0x00000000, 12) /* reg_disc_count, default 0x00000000 */ \
+  X(idelay_count,              0x80000800, 0xFFFFFFFF, 0x00000000, 12) /* reg_idelay_count, default 0x00000000 */ \
+  X(adc_data_monitor,          0x80000840, 0x0000FFFF, 0x00000000, 12) /* reg_adc_data_monitor, default 0x00000000 */ \
+  X(adc_status,                0x80000880, 0xFFFFFFFF, 0x00000000, 12) /* reg_adc_status, default 0x00000000 */ \
+  /* Registers specific to the LBNE Calibration Module */ \
+  X(cal_config,                0x800003C0, 0xFFFFFFFF, 0xFFFFFFFF, 12) \
+  X(iu_cal_config,             0x800003C0, 0xFFFFFFFF, 0xFFFFFFFF,  4) /* part of cal_config */ \
+  X(tpc_cal_config,            0x800003D0, 0xFFFFFFFF, 0xFFFFFFFF,  3) /* part of cal_config */ \
+  X(pd1_cal_config,            0x800003DC, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* part of cal_config */ \
+  X(pd2_cal_config,            0x800003E0, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* part of cal_config */ \
+  X(pd3_cal_config,            0x800003E4, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* part of cal_config */ \
+  X(pd4_cal_config,            0x800003E8, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* part of cal_config */ \
+  X(pd5_cal_config,            0x800003EC, 0xFFFFFFFF, 0xFFFFFFFF,  1) /* part of cal_config */ \
+  X(cal_count,                 0x80000448, 0x0001FFFF, 0x0001FFFF,  1) \
+  X(cal_status,                0x8000044C, 0x00000FFF, 0x00000000,  1) \
+  X(cal_trigger,               0x80000444, 0x00000000, 0x00000001,  1)
+
+//Fields of packed registers, expanded by RegMap into typed Field descriptors.
+//Each entry is
+//  X(name, offset of lowest bit, number of bits)
+
+//channel_control. Bits 6:4 set the timestamp trigger rate
+//(source of external_disc_flag_in(3) into channel logic)
+#define SSPDAQ_CHANNEL_CONTROL_FIELDS(X) \
+  X(enable,                      0, 1) \
+  X(trigger_mode,                1, 1) \
+  X(pileup_enable,               2, 1) /* "Not pileup_disable" */ \
+  X(timestamp_trigger_rate,      4, 3) \
+  X(positive_edge_enable,       10, 1) \
+  X(negative_edge_enable,       11, 1) \
+  X(external_disc_mode,         12, 2) \
+  X(external_disc_flag_sel,     14, 2) \
+  X(dropped_event_counter_mode, 20, 1) \
+  X(accepted_event_counter_mode,21, 1) \
+  X(ahit_counter_mode,          22, 1) \
+  X(disc_counter_mode,          23, 1) \
+  X(event_extend_mode,          24, 2) \
+  X(pileup_extend_enable,       26, 1) \
+  X(pileup_waveform_only,       30, 1) \
+  X(cfd_enable,                 31, 1)
+
+//cal_config, and the iu/tpc/pd parts of it. Pulse delay and widths are in
+//3.333 ns counts; trigger source is 0 for disabled, 1-5 for the timestamp
+//triggers (2.289 kHz, 143.051 Hz, 35.763 Hz, 8.941 Hz, 1.118 Hz), 6 for the
+//manual/pulsed control input and 7 for the front panel input
+#define SSPDAQ_CAL_CONFIG_FIELDS(X) \
+  X(pulse_width_1,               0, 8) \
+  X(pulse_width_2,               8, 8) \
+  X(pulse_delay,                16,12) \
+  X(trigger_source,             28, 3) \
+  X(nova_enable,                31, 1)
+
+//bias_config. Value covers 0-30V
+#define SSPDAQ_BIAS_CONFIG_FIELDS(X) \
+  X(value,                       0,12) \
+  X(enable,                     18, 1)
+
+//dsp_clock_control
+#define SSPDAQ_DSP_CLOCK_CONTROL_FIELDS(X) \
+  X(adc_external_clock,          0, 1) /* use external clock to drive ADCs */ \
+  X(nova_clock,                  1, 1) /* 0 uses front panel input */ \
+  X(jitter_correction,           4, 1)
+
+//Registers laid out with each set of fields above, expanded by RegMap into
+//registers typed by their fields. Each entry is X(name of register)
+#define SSPDAQ_CHANNEL_CONTROL_REGISTERS(X) \
+  X(channel_control)
+
+#define SSPDAQ_CAL_CONFIG_REGISTERS(X) \
+  X(cal_config) \
+  X(iu_cal_config) \
+  X(tpc_cal_config) \
+  X(pd1_cal_config) \
+  X(pd2_cal_config) \
+  X(pd3_cal_config) \
+  X(pd4_cal_config) \
+  X(pd5_cal_config)
+
+#define SSPDAQ_BIAS_CONFIG_REGISTERS(X) \
+  X(bias_config)
+
+#define SSPDAQ_DSP_CLOCK_CONTROL_REGISTERS(X) \
+  X(dsp_clock_control)
+
+#endif
@@ -0,0 +1,218 @@
+#include "RegisterPoller.h"
+#include "RegMap.h"
+#include "anlExceptions.h"
+#include "Log.h"
+#include <algorithm>
+
+SSPDAQ::RegisterPoller::RegisterPoller():
+  fShouldStop(false),
+  fRunning(false),
+  fMaxGapWords(0)
+{}
+
+SSPDAQ::RegisterPoller::~RegisterPoller(){
+  if(fRunning){
+    this->Stop();
+  }
+}
+
+void SSPDAQ::RegisterPoller::AddBoard(unsigned long boardId, SSPDAQ::DeviceInterface* device){
+  if(fRunning){
+    SSPDAQ::Log::Error()<<"Attempt to add board to RegisterPoller while running!"<<std::endl;
+    throw(std::logic_error(""));
+  }
+  if(fBoards.count(boardId)){
+    SSPDAQ::Log::Error()<<"Board "<<boardId<<" already added to RegisterPoller!"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+  std::unique_ptr<Board> board(new Board);
+  board->device=device;
+  fBoards[boardId]=std::move(board);
+}
+
+void SSPDAQ::RegisterPoller::AddRegister(unsigned long boardId, std::string name, unsigned int periodInms){
+  SSPDAQ::RegMap::Register reg=(SSPDAQ::RegMap::Get())[name];
+  this->AddRegister(boardId,name,reg.Address(),reg.Size(),periodInms);
+}
+
+void SSPDAQ::RegisterPoller::AddRegister(unsigned long boardId, std::string name, unsigned int address,
+					  unsigned int size, unsigned int periodInms){
+  if(fRunning){
+    SSPDAQ::Log::Error()<<"Attempt to add register to RegisterPoller while running!"<<std::endl;
+    throw(std::logic_error(""));
+  }
+  auto board=fBoards.find(boardId);
+  if(board==fBoards.end()){
+    SSPDAQ::Log::Error()<<"Attempt to poll register "<<name<<" on unknown board "<<boardId<<std::endl;
+    throw(ENoSuchDevice(""));
+  }
+  if(size==0||periodInms==0){
+    SSPDAQ::Log::Error()<<"Register "<<name<<" polled with zero size or period!"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+
+  PolledRegister reg;
+  reg.name=name;
+  reg.address=address;
+  reg.size=size;
+  board->second->groups[periodInms].registers.push_back(reg);
+}
+
+void SSPDAQ::RegisterPoller::AddSink(SSPDAQ::PollSink* sink){
+  if(fRunning){
+    SSPDAQ::Log::Error()<<"Attempt to add sink to RegisterPoller while running!"<<std::endl;
+    throw(std::logic_error(""));
+  }
+  fSinks.push_back(sink);
+}
+
+void SSPDAQ::RegisterPoller::Start(){
+  if(fRunning){
+    SSPDAQ::Log::Warning()<<"RegisterPoller already running, not starting again"<<std::endl;
+    return;
+  }
+
+  std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+  for(auto board=fBoards.begin();board!=fBoards.end();++board){
+    for(auto group=board->second->groups.begin();group!=board->second->groups.end();++group){
+      this->BuildTransactions(group->second);
+      group->second.nextPoll=now;
+    }
+  }
+
+  fShouldStop=false;
+  fRunning=true;
+  for(auto board=fBoards.begin();board!=fBoards.end();++board){
+    board->second->thread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::RegisterPoller::PollBoard,this,
+									 board->first,std::ref(*board->second)));
+  }
+  SSPDAQ::Log::Info()<<"RegisterPoller started on "<<fBoards.size()<<" boards"<<std::endl;
+}
+
+void SSPDAQ::RegisterPoller::Stop(){
+  {
+    std::lock_guard<std::mutex> lock(fStopMutex);
+    fShouldStop=true;
+  }
+  fStopCondition.notify_all();
+
+  for(auto board=fBoards.begin();board!=fBoards.end();++board){
+    if(board->second->thread){
+      board->second->thread->join();
+      board->second->thread.reset();
+    }
+  }
+  fRunning=false;
+}
+
+void SSPDAQ::RegisterPoller::PollBoard(unsigned long boardId, Board& board){
+
+  if(board.groups.empty()){
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(fStopMutex);
+  while(!fShouldStop){
+
+    std::chrono::steady_clock::time_point nextPoll=board.groups.begin()->second.nextPoll;
+    for(auto group=board.groups.begin();group!=board.groups.end();++group){
+      nextPoll=std::min(nextPoll,group->second.nextPoll);
+    }
+
+    //Sleep until something is due; Stop wakes us early
+    if(fStopCondition.wait_until(lock,nextPoll,[this]{return fShouldStop;})){
+      break;
+    }
+
+    lock.unlock();
+    std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+    for(auto group=board.groups.begin();group!=board.groups.end();++group){
+      if(group->second.nextPoll>now){
+	continue;
+      }
+      this->PollGroupNow(boardId,board,group->second);
+
+      //Keep to a fixed schedule, but don't try to catch up on missed polls
+      std::chrono::milliseconds period(group->first);
+      group->second.nextPoll+=period;
+      if(group->second.nextPoll<=now){
+	group->second.nextPoll=now+period;
+      }
+    }
+    lock.lock();
+  }
+}
+
+void SSPDAQ::RegisterPoller::PollGroupNow(unsigned long boardId, Board& board, PollGroup& group){
+
+  std::vector<PollSample> samples;
+  std::vector<unsigned int> buffer;
+
+  try{
+    for(auto trans=group.transactions.begin();trans!=group.transactions.end();++trans){
+      buffer.resize(trans->size);
+
+      //Registers larger than a control packet go as several reads
+      for(unsigned int offset=0;offset<trans->size;offset+=MAX_CTRL_DATA){
+	unsigned int size=std::min(trans->size-offset,(unsigned int)MAX_CTRL_DATA);
+	board.device->ReadRegisterArray(trans->address+offset*4,&buffer[offset],size);
+      }
+      std::chrono::system_clock::time_point time=std::chrono::system_clock::now();
+
+      for(auto reg=trans->registers.begin();reg!=trans->registers.end();++reg){
+	unsigned int first=(reg->address-trans->address)/4;
+	PollSample sample;
+	sample.board=boardId;
+	sample.name=reg->name;
+	sample.address=reg->address;
+	sample.time=time;
+	sample.values.assign(buffer.begin()+first,buffer.begin()+first+reg->size);
+	samples.push_back(std::move(sample));
+      }
+    }
+  }
+  catch(std::exception& e){
+    SSPDAQ::Log::Warning()<<"RegisterPoller failed to read board "<<boardId<<": "<<e.what()
+			  <<", skipping this poll"<<std::endl;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(fSinkMutex);
+  for(auto sink=fSinks.begin();sink!=fSinks.end();++sink){
+    (*sink)->Consume(samples);
+  }
+}
+
+void SSPDAQ::RegisterPoller::BuildTransactions(PollGroup& group){
+
+  std::vector<PolledRegister> regs=group.registers;
+  std::sort(regs.begin(),regs.end(),[](const PolledRegister& a, const PolledRegister& b){
+      return a.address<b.address;});
+
+  group.transactions.clear();
+  for(auto reg=regs.begin();reg!=regs.end();++reg){
+    unsigned int regEnd=reg->address+reg->size*4;
+
+    //Extend current read if the register starts close enough to its end, and the
+    //result still fits in one control packet
+    if(!group.transactions.empty()){
+      Transaction& last=group.transactions.back();
+      unsigned int lastEnd=last.address+last.size*4;
+      unsigned int mergedSize=(std::max(lastEnd,regEnd)-last.address)/4;
+      if(reg->address<=lastEnd+fMaxGapWords*4&&mergedSize<=MAX_CTRL_DATA){
+	last.size=mergedSize;
+	last.registers.push_back(*reg);
+	continue;
+      }
+    }
+
+    Transaction trans;
+    trans.address=reg->address;
+    trans.size=reg->size;
+    trans.registers.push_back(*reg);
+    group.transactions.push_back(trans);
+  }
+
+  SSPDAQ::Log::Debug()<<"RegisterPoller reading "<<regs.size()<<" registers in "
+		      <<group.transactions.size()<<" transactions"<<std::endl;
+}
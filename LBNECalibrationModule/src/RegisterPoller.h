@@ -0,0 +1,128 @@
+#ifndef REGISTERPOLLER_H__
+#define REGISTERPOLLER_H__
+
+#include "DeviceInterface.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //One reading of a polled register or register array
+  struct PollSample{
+    unsigned long board;
+    std::string name;
+    unsigned int address;
+    std::chrono::system_clock::time_point time;
+    std::vector<unsigned int> values;
+  };
+
+  //Destination for polled values. Consume is called once per board for each
+  //polling period that falls due, with every register read for that period.
+  //Calls are serialised by the poller, so sinks need no locking of their own.
+  class PollSink{
+  public:
+    virtual ~PollSink(){}
+
+    virtual void Consume(const std::vector<PollSample>& samples)=0;
+  };
+
+  //Reads sets of registers from any number of boards at fixed periods and
+  //passes the values on to sinks. Each board is polled from its own thread,
+  //which sleeps until the next read falls due. Registers on one board sharing
+  //a period are read together, with adjacent registers merged into single
+  //array reads.
+  class RegisterPoller{
+
+  public:
+
+    RegisterPoller();
+
+    //Stops polling if still running
+    ~RegisterPoller();
+
+    //Add a board to be polled. The device interface must already be open and must
+    //outlive the poller. Reads go through the board's command executor, so other
+    //threads can keep using the interface while polling.
+    void AddBoard(unsigned long boardId, DeviceInterface* device);
+
+    //Poll a named register (the whole array if it is one), as defined in SSPDAQ::RegMap
+    void AddRegister(unsigned long boardId, std::string name, unsigned int periodInms);
+
+    //Poll size contiguous registers starting at address, reporting them under name
+    void AddRegister(unsigned long boardId, std::string name, unsigned int address,
+		     unsigned int size, unsigned int periodInms);
+
+    //Sink must outlive the poller
+    void AddSink(PollSink* sink);
+
+    //Merge reads of registers separated by up to this many unwanted words.
+    //Reading a few extra words is usually cheaper than another transaction.
+    void SetMaxGapWords(unsigned int gap){fMaxGapWords=gap;}
+
+    //Begin polling. Boards, registers and sinks can't be changed while running.
+    void Start();
+
+    void Stop();
+
+  private:
+
+    struct PolledRegister{
+      std::string name;
+      unsigned int address;
+      unsigned int size;
+    };
+
+    //One array read, covering one or more polled registers
+    struct Transaction{
+      unsigned int address;
+      unsigned int size;
+      std::vector<PolledRegister> registers;
+    };
+
+    //All registers on a board polled with the same period
+    struct PollGroup{
+      std::vector<PolledRegister> registers;
+      std::vector<Transaction> transactions;
+      std::chrono::steady_clock::time_point nextPoll;
+    };
+
+    struct Board{
+      DeviceInterface* device;
+      std::map<unsigned int,PollGroup> groups; // keyed by period in ms
+      std::unique_ptr<std::thread> thread;
+    };
+
+    //Thread function; polls one board until Stop is called
+    void PollBoard(unsigned long boardId, Board& board);
+
+    //Read all registers in group and hand the values to the sinks
+    void PollGroupNow(unsigned long boardId, Board& board, PollGroup& group);
+
+    //Work out the fewest array reads covering all registers in group
+    void BuildTransactions(PollGroup& group);
+
+    std::map<unsigned long,std::unique_ptr<Board> > fBoards;
+
+    std::vector<PollSink*> fSinks;
+
+    //Serialises calls to sinks from different board threads
+    std::mutex fSinkMutex;
+
+    //Used to wake sleeping board threads on Stop
+    std::mutex fStopMutex;
+    std::condition_variable fStopCondition;
+    bool fShouldStop;
+
+    bool fRunning;
+
+    unsigned int fMaxGapWords;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,253 @@
+#include "ReplayDevice.h"
+#include "EventDecoder.h"
+#include "anlExceptions.h"
+#include "anlTypes.h"
+#include "Log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace{
+  const unsigned int kEventHeaderWords=sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int);
+}
+
+SSPDAQ::ReplayDevice::ReplayDevice(unsigned int deviceNumber, std::string path):
+  EmulatedDevice(deviceNumber),
+  fPath(path),
+  fData(0),
+  fWords(0),
+  fReleased(0),
+  fReleasedWords(0),
+  fNextEvent(0),
+  fEventOffset(0),
+  fReadWords(0),
+  fSpeed(1.),
+  fClockInMHz(150.),
+  fReplayShouldStop(false)
+{}
+
+SSPDAQ::ReplayDevice::~ReplayDevice(){
+  this->Stop();
+  if(fData){
+    munmap((void*)fData,fWords*sizeof(unsigned int));
+  }
+}
+
+void SSPDAQ::ReplayDevice::Open(bool slowControlOnly){
+
+  //File stays mapped and indexed if the device is closed and opened again
+  if(!fData){
+    int fd=open(fPath.c_str(),O_RDONLY);
+    struct stat info;
+    if(fd<0||fstat(fd,&info)){
+      SSPDAQ::Log::Error()<<"Couldn't open replay file "<<fPath<<": "<<std::strerror(errno)<<std::endl;
+      if(fd>=0){
+	close(fd);
+      }
+      throw(EFileError(""));
+    }
+    fWords=info.st_size/sizeof(unsigned int);
+    void* map=fWords?mmap(0,fWords*sizeof(unsigned int),PROT_READ,MAP_SHARED,fd,0):MAP_FAILED;
+    close(fd);
+    if(map==MAP_FAILED){
+      SSPDAQ::Log::Error()<<"Couldn't map replay file "<<fPath<<std::endl;
+      fWords=0;
+      throw(EFileError(""));
+    }
+    fData=(const unsigned int*)map;
+    madvise(map,fWords*sizeof(unsigned int),MADV_SEQUENTIAL);
+
+    if(this->IsMillisliceFile()){
+      this->IndexMillislices();
+    }
+    else{
+      this->IndexRawStream();
+    }
+    if(fEvents.size()>1){
+      SSPDAQ::Log::Info()<<"Replay file "<<fPath<<" has "<<fEvents.size()<<" events over "
+			 <<(fEvents.back().timestamp-fEvents.front().timestamp)/(fClockInMHz*1.E6)<<"s"<<std::endl;
+    }
+  }
+  EmulatedDevice::Open(slowControlOnly);
+}
+
+bool SSPDAQ::ReplayDevice::IsMillisliceFile() const{
+  if(fWords<MillisliceHeader::sizeInUInts){
+    return false;
+  }
+  unsigned int length=((const MillisliceHeader*)fData)->length;
+  return length>=MillisliceHeader::sizeInUInts&&length<=fWords&&
+    (length==MillisliceHeader::sizeInUInts||fData[MillisliceHeader::sizeInUInts]==0xAAAAAAAA);
+}
+
+void SSPDAQ::ReplayDevice::IndexRawStream(){
+
+  unsigned long skippedWords=0;
+  size_t offset=0;
+  while(offset+kEventHeaderWords<=fWords){
+    const EventHeader& header=*(const EventHeader*)(fData+offset);
+    if(header.header!=0xAAAAAAAA||header.length<kEventHeaderWords||offset+header.length>fWords){
+      ++offset;
+      ++skippedWords;
+      continue;
+    }
+    Event event={offset,header.length,Decode::InternalTimestamp(header)};
+    fEvents.push_back(event);
+    offset+=header.length;
+  }
+  skippedWords+=fWords-offset;
+  if(skippedWords){
+    SSPDAQ::Log::Warning()<<"Skipped "<<skippedWords<<" words outside events in replay file "<<fPath<<std::endl;
+  }
+}
+
+void SSPDAQ::ReplayDevice::IndexMillislices(){
+
+  unsigned long duplicates=0;
+  SliceOverlap overlap;
+  size_t slice=0;
+  while(slice+MillisliceHeader::sizeInUInts<=fWords){
+    unsigned int length=((const MillisliceHeader*)(fData+slice))->length;
+    if(length<MillisliceHeader::sizeInUInts||slice+length>fWords){
+      SSPDAQ::Log::Warning()<<"Bad millislice in replay file "<<fPath<<", ignoring rest of file"<<std::endl;
+      break;
+    }
+
+    //Leave out events repeated from the slice before
+    overlap.NextSlice(*(const MillisliceHeader*)(fData+slice));
+    size_t offset=slice+MillisliceHeader::sizeInUInts;
+    size_t end=slice+length;
+    while(offset+kEventHeaderWords<=end){
+      const EventHeader& header=*(const EventHeader*)(fData+offset);
+      if(header.header!=0xAAAAAAAA||header.length<kEventHeaderWords||offset+header.length>end){
+	SSPDAQ::Log::Warning()<<"Bad event in millislice in replay file "<<fPath<<", skipping rest of slice"<<std::endl;
+	break;
+      }
+      if(overlap.IsCopy(header)){
+	++duplicates;
+      }
+      else{
+	Event event={offset,header.length,Decode::InternalTimestamp(header)};
+	fEvents.push_back(event);
+      }
+      offset+=header.length;
+    }
+    slice=end;
+  }
+  SSPDAQ::Log::Debug()<<"Left out "<<duplicates<<" overlap copies from replay file "<<fPath<<std::endl;
+}
+
+void SSPDAQ::ReplayDevice::DevicePurgeData(){
+  size_t released=fReleased;
+  fNextEvent=released;
+  fEventOffset=0;
+  fReadWords=fReleasedWords.load();
+}
+
+void SSPDAQ::ReplayDevice::DeviceQueueStatus(unsigned int* numWords){
+  (*numWords)=fReleasedWords-fReadWords;
+}
+
+void SSPDAQ::ReplayDevice::DeviceReceive(std::vector<unsigned int>& data, unsigned int size){
+
+  data.clear();
+  size_t released=fReleased;
+  size_t next=fNextEvent;
+  while(data.size()<size&&next<released){
+    const Event& event=fEvents[next];
+    unsigned int nWords=std::min(size-(unsigned int)data.size(),event.length-fEventOffset);
+    const unsigned int* words=fData+event.offset+fEventOffset;
+    data.insert(data.end(),words,words+nWords);
+    fEventOffset+=nWords;
+    if(fEventOffset==event.length){
+      fEventOffset=0;
+      ++next;
+    }
+  }
+  fNextEvent=next;
+  fReadWords+=data.size();
+}
+
+unsigned int SSPDAQ::ReplayDevice::DeviceDiscard(unsigned int size){
+
+  unsigned int discarded=0;
+  size_t released=fReleased;
+  size_t next=fNextEvent;
+  while(discarded<size&&next<released){
+    unsigned int nWords=std::min(size-discarded,fEvents[next].length-fEventOffset);
+    discarded+=nWords;
+    fEventOffset+=nWords;
+    if(fEventOffset==fEvents[next].length){
+      fEventOffset=0;
+      ++next;
+    }
+  }
+  fNextEvent=next;
+  fReadWords+=discarded;
+  return discarded;
+}
+
+void SSPDAQ::ReplayDevice::Start(){
+  if(fReplayThread){
+    return;
+  }
+  fReleased=0;
+  fReleasedWords=0;
+  fNextEvent=0;
+  fEventOffset=0;
+  fReadWords=0;
+  fReplayShouldStop=false;
+  fReplayThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::ReplayDevice::ReplayLoop,this));
+}
+
+void SSPDAQ::ReplayDevice::Stop(){
+  fReplayShouldStop=true;
+  if(fReplayThread){
+    fReplayThread->join();
+    fReplayThread.reset();
+  }
+}
+
+void SSPDAQ::ReplayDevice::ReplayLoop(){
+
+  SSPDAQ::Log::Debug()<<"Starting replay of "<<fPath<<std::endl;
+
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  double speed=fSpeed;
+  double ticksPerSecond=fClockInMHz*1.E6*speed;
+  unsigned long firstTime=fEvents.empty()?0:fEvents.front().timestamp;
+  size_t next=0;
+
+  while(!fReplayShouldStop&&next<fEvents.size()){
+
+    double now=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    //Release all events which are now due, in bursts small enough that a stop
+    //request is still seen promptly. Events earlier than the first are due at once.
+    unsigned long words=0;
+    double nextTime=0;
+    for(unsigned int nReleased=0;next<fEvents.size()&&nReleased<10000;++next,++nReleased){
+      const Event& event=fEvents[next];
+      nextTime=speed>0&&event.timestamp>firstTime?(event.timestamp-firstTime)/ticksPerSecond:0.;
+      if(nextTime>now){
+	break;
+      }
+      words+=event.length;
+    }
+
+    //Events go first, so that the words counted in DeviceQueueStatus are always there to read
+    fReleased=next;
+    fReleasedWords+=words;
+
+    //Sleep until the next event is due, but wake up regularly to check for stop
+    if(next<fEvents.size()&&nextTime>now){
+      usleep((useconds_t)std::min(10000.,(nextTime-now)*1E6));
+    }
+  }
+  SSPDAQ::Log::Debug()<<"Replay of "<<fPath<<" released "<<next<<" of "<<fEvents.size()<<" events"<<std::endl;
+}
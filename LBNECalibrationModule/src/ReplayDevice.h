@@ -0,0 +1,113 @@
+#ifndef REPLAYDEVICE_H__
+#define REPLAYDEVICE_H__
+
+#include "EmulatedDevice.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Plays back recorded data through the Device interface, so that readout
+  //and everything downstream of it can be run on real data without a board.
+  //
+  //The file is either a raw data channel stream (events back to back, as
+  //received from the board) or millislices as written by SliceWriter, which
+  //are recognised by a plausible slice header at the start. Events are indexed
+  //when the device is opened, leaving out overlap copies from millislice
+  //files, and served straight from a read-only mapping of the file.
+  //
+  //Registers behave as on an EmulatedDevice, and playback starts and stops on
+  //the same register writes as the emulator's event generator, each run
+  //starting again from the beginning of the file. Events are released at the
+  //times given by their internal timestamps, scaled by the replay speed.
+  class ReplayDevice : public EmulatedDevice{
+
+  public:
+
+    ReplayDevice(unsigned int deviceNumber, std::string path);
+
+    virtual ~ReplayDevice();
+
+    virtual void DevicePurgeData();
+
+    virtual void DeviceQueueStatus(unsigned int* numWords);
+
+    virtual void DeviceReceive(std::vector<unsigned int>& data, unsigned int size);
+
+    virtual unsigned int DeviceDiscard(unsigned int size);
+
+    //Playback speed relative to the recorded timing, e.g. 10 for ten times
+    //faster. 0 releases every event at once, for reading as fast as possible.
+    void SetSpeed(double speed){fSpeed=speed;}
+
+    //Clock used to convert timestamps to times
+    void SetClockRateInMHz(double rate){fClockInMHz=rate;}
+
+    //Whether every event in the file has been read out since the last Start
+    inline bool Finished() const{return fNextEvent==fEvents.size();}
+
+    inline size_t Events() const{return fEvents.size();}
+
+  protected:
+
+    //Maps and indexes the file
+    virtual void Open(bool slowControlOnly=false);
+
+    //Begin playback from the start of the file
+    virtual void Start();
+
+    virtual void Stop();
+
+  private:
+
+    //Position of an event in the file
+    struct Event{
+      size_t offset;         // in words
+      unsigned int length;   // in words
+      unsigned long timestamp;
+    };
+
+    //Whether the file starts with a millislice header followed by an event
+    bool IsMillisliceFile() const;
+
+    //Index events in a raw stream, skipping anything between them which
+    //isn't an event header
+    void IndexRawStream();
+
+    void IndexMillislices();
+
+    //Thread function; releases events as they fall due
+    void ReplayLoop();
+
+    std::string fPath;
+
+    //Mapped file
+    const unsigned int* fData;
+    size_t fWords;
+
+    std::vector<Event> fEvents;
+
+    //Events the replay thread has made available, and their total size
+    std::atomic<size_t> fReleased;
+    std::atomic<unsigned long> fReleasedWords;
+
+    //Read position: next event, and word within it. Only used by DeviceReceive
+    //and DevicePurgeData, which are never called at the same time.
+    std::atomic<size_t> fNextEvent;
+    unsigned int fEventOffset;
+    std::atomic<unsigned long> fReadWords;
+
+    std::atomic<double> fSpeed;
+
+    std::atomic<double> fClockInMHz;
+
+    std::unique_ptr<std::thread> fReplayThread;
+
+    std::atomic<bool> fReplayShouldStop;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,342 @@
+#include "SliceWriter.h"
+#include "anlExceptions.h"
+#include "Log.h"
+#include "NumberedFiles.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+const size_t SSPDAQ::SliceWriter::alignment;
+
+SSPDAQ::SliceWriter::SliceWriter(std::string baseName, unsigned int nBuffers, size_t bufferBytes):
+  fBaseName(baseName),
+  fBufferBytes((bufferBytes+alignment-1)/alignment*alignment),
+  fCurrent(0),
+  fShouldStop(false),
+  fOpen(false),
+  fFailed(false),
+  fMaxFileBytes(0),
+  fMaxFileSeconds(0),
+  fCheckpointIntervalInms(1000),
+  fUseDirect(true),
+  fFileBytes(0),
+  fFd(-1),
+  fFdDirect(false),
+  fFileIndex(0)
+{
+  std::memset(&fStats,0,sizeof(fStats));
+
+  nBuffers=std::max(nBuffers,2u);
+  fBuffers.resize(nBuffers);
+  for(unsigned int i=0;i<nBuffers;++i){
+    void* memory=0;
+    if(posix_memalign(&memory,alignment,fBufferBytes)){
+      SSPDAQ::Log::Error()<<"SliceWriter failed to allocate "<<fBufferBytes<<" byte buffer"<<std::endl;
+      throw(std::bad_alloc());
+    }
+    fMemory.push_back(std::unique_ptr<char,void(*)(void*)>((char*)memory,&std::free));
+    fBuffers[i].data=(char*)memory;
+    fBuffers[i].used=0;
+    fFree.push_back(&fBuffers[i]);
+  }
+}
+
+SSPDAQ::SliceWriter::~SliceWriter(){
+  if(fOpen){
+    this->Close();
+  }
+}
+
+void SSPDAQ::SliceWriter::SetRollover(unsigned long long maxBytes, unsigned int maxSeconds){
+  fMaxFileBytes=maxBytes;
+  fMaxFileSeconds=maxSeconds;
+}
+
+void SSPDAQ::SliceWriter::Open(){
+
+  if(fOpen){
+    SSPDAQ::Log::Warning()<<"SliceWriter already open, ignoring Open"<<std::endl;
+    return;
+  }
+
+  fFileIndex=SSPDAQ::NextFileIndex(fBaseName,".dat");
+  fFailed=false;
+  fShouldStop=false;
+
+  //Open the first file here so that a bad path is reported to the caller
+  if(!this->OpenFile()){
+    throw(EFileError(""));
+  }
+  fFileBytes=0;
+  fFileStart=std::chrono::steady_clock::now();
+  fOpen=true;
+
+  fThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::SliceWriter::Run,this));
+}
+
+bool SSPDAQ::SliceWriter::Write(const std::vector<unsigned int>& slice){
+  return slice.empty()?true:this->Write(&slice[0],slice.size());
+}
+
+bool SSPDAQ::SliceWriter::Write(const unsigned int* data, size_t words){
+
+  if(!fOpen||fFailed){
+    return false;
+  }
+
+  size_t bytes=words*sizeof(unsigned int);
+
+  //Roll over between slices, never within one
+  if(fFileBytes){
+    bool tooBig=fMaxFileBytes&&fFileBytes+bytes>fMaxFileBytes;
+    bool tooOld=fMaxFileSeconds&&std::chrono::steady_clock::now()-fFileStart>=std::chrono::seconds(fMaxFileSeconds);
+    if(tooBig||tooOld){
+      if(fCurrent){
+	this->Submit(fCurrent);
+	fCurrent=0;
+      }
+      this->Submit(0);
+      fFileBytes=0;
+      fFileStart=std::chrono::steady_clock::now();
+    }
+  }
+
+  //Check we can get all the buffers this slice will need before copying any of it
+  size_t space=fCurrent?fBufferBytes-fCurrent->used:0;
+  size_t buffersNeeded=bytes>space?(bytes-space+fBufferBytes-1)/fBufferBytes:0;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if(fFree.size()<buffersNeeded){
+      ++fStats.slicesDropped;
+      if(buffersNeeded>fBuffers.size()-(fCurrent?1:0)){
+	SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kError,1000)<<"Slice of "<<bytes<<" bytes is too big for SliceWriter buffers ("
+							<<fBuffers.size()<<" x "<<fBufferBytes<<" bytes), dropped"<<std::endl;
+	return false;
+      }
+      SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: disk writer has fallen behind, dropped slice ("
+							 <<fStats.slicesDropped<<" dropped in total)"<<std::endl;
+      return false;
+    }
+  }
+
+  const char* source=(const char*)data;
+  size_t remaining=bytes;
+  while(remaining){
+    if(!fCurrent){
+      std::lock_guard<std::mutex> lock(fMutex);
+      fCurrent=fFree.back();
+      fFree.pop_back();
+      fCurrent->used=0;
+    }
+    size_t chunk=std::min(remaining,fBufferBytes-fCurrent->used);
+    std::memcpy(fCurrent->data+fCurrent->used,source,chunk);
+    fCurrent->used+=chunk;
+    source+=chunk;
+    remaining-=chunk;
+    if(fCurrent->used==fBufferBytes){
+      this->Submit(fCurrent);
+      fCurrent=0;
+    }
+  }
+
+  fFileBytes+=bytes;
+  std::lock_guard<std::mutex> lock(fMutex);
+  ++fStats.slicesWritten;
+  return true;
+}
+
+void SSPDAQ::SliceWriter::Close(){
+
+  if(!fOpen){
+    return;
+  }
+
+  if(fCurrent){
+    this->Submit(fCurrent);
+    fCurrent=0;
+  }
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fShouldStop=true;
+  }
+  fFullAvailable.notify_one();
+  fThread->join();
+  fThread.reset();
+  fOpen=false;
+
+  SSPDAQ::Log::Info()<<"SliceWriter wrote "<<fStats.slicesWritten<<" slices ("<<fStats.bytesWritten<<" bytes) to "
+		     <<fStats.filesClosed<<" files, dropped "<<fStats.slicesDropped<<std::endl;
+  if(fStats.writeTimeInus){
+    SSPDAQ::Log::Info()<<"SliceWriter disk throughput "<<(double)fStats.bytesWritten/fStats.writeTimeInus
+		       <<" MB/s, slowest write "<<fStats.maxWriteTimeInus<<"us, slowest sync "
+		       <<fStats.maxSyncTimeInus<<"us"<<std::endl;
+  }
+}
+
+SSPDAQ::SliceWriter::Stats SSPDAQ::SliceWriter::GetStats() const{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fStats;
+}
+
+std::string SSPDAQ::SliceWriter::CurrentFile() const{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fFileName;
+}
+
+void SSPDAQ::SliceWriter::Submit(Buffer* buffer){
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if(buffer){
+      buffer->submitted=std::chrono::steady_clock::now();
+    }
+    fFull.push_back(buffer);
+    fStats.maxBuffersQueued=std::max(fStats.maxBuffersQueued,(unsigned int)fFull.size());
+  }
+  fFullAvailable.notify_one();
+}
+
+void SSPDAQ::SliceWriter::Run(){
+
+  while(true){
+    Buffer* buffer;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fFullAvailable.wait(lock,[this]{return !fFull.empty()||fShouldStop;});
+      if(fFull.empty()){
+	break;
+      }
+      buffer=fFull.front();
+      fFull.pop_front();
+    }
+
+    //File break
+    if(!buffer){
+      this->CloseFile();
+      ++fFileIndex;
+      continue;
+    }
+
+    //After a failure, just recycle buffers so that Write sees the error and stops
+    if(!fFailed){
+      if(fFd<0&&!this->OpenFile()){
+	fFailed=true;
+      }
+      else if(!this->WriteBuffer(buffer)){
+	SSPDAQ::Log::Error()<<"SliceWriter failed writing "<<fFileName<<": "<<std::strerror(errno)<<std::endl;
+	fFailed=true;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    fFree.push_back(buffer);
+  }
+
+  this->CloseFile();
+}
+
+bool SSPDAQ::SliceWriter::OpenFile(){
+
+  std::string name;
+  int fd=SSPDAQ::CreateNumberedFile(fBaseName,".dat",fFileIndex,name);
+  if(fd<0){
+    SSPDAQ::Log::Error()<<"SliceWriter couldn't create "<<name<<": "<<std::strerror(errno)<<std::endl;
+    return false;
+  }
+
+  //Switch to O_DIRECT once the file exists, so that a refusal doesn't leave an
+  //empty file behind to be skipped
+  bool direct=false;
+  if(fUseDirect){
+    direct=fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_DIRECT)==0;
+    if(!direct){
+      SSPDAQ::Log::Warning()<<"Filesystem doesn't support O_DIRECT for "<<name<<", using buffered writes"<<std::endl;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fFileName=name;
+  }
+  fFd=fd;
+  fFdDirect=direct;
+  fLastSync=std::chrono::steady_clock::now();
+  SSPDAQ::Log::Info()<<"Writing millislices to "<<name<<(direct?" (direct I/O)":"")<<std::endl;
+  return true;
+}
+
+void SSPDAQ::SliceWriter::CloseFile(){
+  if(fFd<0){
+    return;
+  }
+  fdatasync(fFd);
+  close(fFd);
+  fFd=-1;
+  std::lock_guard<std::mutex> lock(fMutex);
+  ++fStats.filesClosed;
+}
+
+bool SSPDAQ::SliceWriter::WriteBuffer(Buffer* buffer){
+
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+
+  //Direct I/O can only write whole blocks. Only the last buffer of a file can be
+  //partly full, so write its whole blocks directly, then drop O_DIRECT for the rest.
+  size_t directBytes=fFdDirect?buffer->used/alignment*alignment:0;
+  if(directBytes&&!this->WriteAll(buffer->data,directBytes)){
+    return false;
+  }
+  if(buffer->used>directBytes){
+    if(fFdDirect){
+      fcntl(fFd,F_SETFL,fcntl(fFd,F_GETFL)&~O_DIRECT);
+      fFdDirect=false;
+    }
+    if(!this->WriteAll(buffer->data+directBytes,buffer->used-directBytes)){
+      return false;
+    }
+  }
+
+  std::chrono::steady_clock::time_point end=std::chrono::steady_clock::now();
+  unsigned long writeTime=std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+  unsigned long latency=std::chrono::duration_cast<std::chrono::microseconds>(end-buffer->submitted).count();
+
+  //Checkpoint
+  unsigned long syncTime=0;
+  bool synced=false;
+  if(fCheckpointIntervalInms&&end-fLastSync>=std::chrono::milliseconds(fCheckpointIntervalInms)){
+    fdatasync(fFd);
+    fLastSync=std::chrono::steady_clock::now();
+    syncTime=std::chrono::duration_cast<std::chrono::microseconds>(fLastSync-end).count();
+    synced=true;
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fStats.bytesWritten+=buffer->used;
+  ++fStats.bufferWrites;
+  fStats.writeTimeInus+=writeTime;
+  fStats.maxWriteTimeInus=std::max(fStats.maxWriteTimeInus,writeTime);
+  fStats.maxLatencyInus=std::max(fStats.maxLatencyInus,latency);
+  if(synced){
+    ++fStats.syncs;
+    fStats.maxSyncTimeInus=std::max(fStats.maxSyncTimeInus,syncTime);
+  }
+  return true;
+}
+
+bool SSPDAQ::SliceWriter::WriteAll(const char* data, size_t bytes){
+  while(bytes){
+    ssize_t written=write(fFd,data,bytes);
+    if(written<0){
+      if(errno==EINTR){
+	continue;
+      }
+      return false;
+    }
+    data+=written;
+    bytes-=written;
+  }
+  return true;
+}
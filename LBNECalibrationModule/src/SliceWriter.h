@@ -0,0 +1,149 @@
+#ifndef SLICEWRITER_H__
+#define SLICEWRITER_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Streams millislices to disk as they arrive, as raw concatenated slices
+  //(each starts with its MillisliceHeader, which gives its length).
+  //
+  //Slices are copied into a small set of large, page-aligned buffers. Full
+  //buffers are written by a dedicated thread, with O_DIRECT where the
+  //filesystem allows it, while the caller fills the next one. Write never
+  //waits for the disk: if every buffer is still queued for writing, the slice
+  //is dropped and counted.
+  //
+  //Data is synced to disk at regular checkpoints, and files roll over by size
+  //or age (always at a slice boundary). Files are named <base>_NNNN.dat,
+  //numbered on from any already there so that nothing is overwritten.
+  class SliceWriter{
+
+  public:
+
+    struct Stats{
+      unsigned long slicesWritten;  // accepted by Write
+      unsigned long slicesDropped;  // no buffer free
+      unsigned long long bytesWritten; // to disk so far
+      unsigned int filesClosed;
+      unsigned long bufferWrites;
+      unsigned long long writeTimeInus; // total time in write calls
+      unsigned long maxWriteTimeInus;   // longest single buffer write
+      unsigned long maxLatencyInus;     // longest from buffer full to written
+      unsigned long syncs;
+      unsigned long maxSyncTimeInus;
+      unsigned int maxBuffersQueued;    // high water of buffers awaiting write
+    };
+
+    //Nothing is opened until Open
+    explicit SliceWriter(std::string baseName, unsigned int nBuffers=3,
+			 size_t bufferBytes=16*1024*1024);
+
+    //Closes if still open
+    ~SliceWriter();
+
+    //Start a new file after maxBytes, or after maxSeconds. 0 means no limit.
+    void SetRollover(unsigned long long maxBytes, unsigned int maxSeconds);
+
+    //Sync data to disk at least this often (0 to leave it to the OS)
+    void SetCheckpointInterval(unsigned int intervalInms){fCheckpointIntervalInms=intervalInms;}
+
+    //Use O_DIRECT (default true). Falls back to buffered writes if the filesystem refuses.
+    void SetDirectIO(bool useDirect){fUseDirect=useDirect;}
+
+    //Open the first file and start the writer thread. Throws EFileError if the
+    //file can't be created.
+    void Open();
+
+    //Queue a slice for writing. Returns false if it was dropped.
+    bool Write(const std::vector<unsigned int>& slice);
+
+    bool Write(const unsigned int* data, size_t words);
+
+    //Write out everything queued, sync and close
+    void Close();
+
+    Stats GetStats() const;
+
+    //Name of the file currently being written
+    std::string CurrentFile() const;
+
+  private:
+
+    struct Buffer{
+      char* data;
+      size_t used;
+      std::chrono::steady_clock::time_point submitted;
+    };
+
+    //Writer thread
+    void Run();
+
+    //Open file number fFileIndex. Returns false on failure.
+    bool OpenFile();
+
+    void CloseFile();
+
+    bool WriteBuffer(Buffer* buffer);
+
+    bool WriteAll(const char* data, size_t bytes);
+
+    //Hand the current buffer to the writer thread (or a file break if buffer is 0)
+    void Submit(Buffer* buffer);
+
+    static const size_t alignment=4096; // bytes; covers any block device
+
+    std::string fBaseName;
+
+    size_t fBufferBytes;
+
+    //Buffer memory, page aligned
+    std::vector<std::unique_ptr<char,void(*)(void*)> > fMemory;
+
+    std::vector<Buffer> fBuffers;
+
+    //Buffer being filled by Write
+    Buffer* fCurrent;
+
+    //Free buffers, and those waiting for the writer thread (0 marks a file break)
+    std::vector<Buffer*> fFree;
+    std::deque<Buffer*> fFull;
+
+    mutable std::mutex fMutex;
+    std::condition_variable fFullAvailable;
+
+    bool fShouldStop;
+    bool fOpen;
+    std::atomic<bool> fFailed;
+
+    unsigned long long fMaxFileBytes;
+    unsigned int fMaxFileSeconds;
+    unsigned int fCheckpointIntervalInms;
+    bool fUseDirect;
+
+    //Size and start of the current file, as seen by Write
+    unsigned long long fFileBytes;
+    std::chrono::steady_clock::time_point fFileStart;
+
+    //File state, owned by the writer thread once running
+    int fFd;
+    bool fFdDirect;
+    unsigned int fFileIndex;
+    std::string fFileName;
+    std::chrono::steady_clock::time_point fLastSync;
+
+    Stats fStats;
+
+    std::unique_ptr<std::thread> fThread;
+  };
+
+}//namespace
+#endif
@@ -0,0 +1,174 @@
+#include "TelemetryPublisher.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+SSPDAQ::TelemetryPublisher::TelemetryPublisher(zmq::context_t& context, std::string endpoint,
+					       Format_t format, int highWaterMark):
+  fSocket(context,format==kBinary?ZMQ_PUB:ZMQ_PUSH),
+  fFormat(format),
+  fNRecords(0),
+  fJSONService("test_service"),
+  fPublished(0),
+  fDropped(0)
+{
+  fSocket.setsockopt(ZMQ_SNDHWM,&highWaterMark,sizeof(highWaterMark));
+
+  //Don't hang on exit waiting for a subscriber that has gone away
+  int linger=0;
+  fSocket.setsockopt(ZMQ_LINGER,&linger,sizeof(linger));
+
+  if(fFormat==kBinary){
+    fSocket.bind(endpoint.c_str());
+    SSPDAQ::Log::Info()<<"Publishing binary telemetry on "<<endpoint<<std::endl;
+  }
+  else{
+    fSocket.connect(endpoint.c_str());
+    SSPDAQ::Log::Info()<<"Sending JSON telemetry to "<<endpoint<<std::endl;
+  }
+}
+
+SSPDAQ::TelemetryPublisher::~TelemetryPublisher(){
+  if(fDropped){
+    SSPDAQ::Log::Warning()<<"TelemetryPublisher dropped "<<fDropped<<" of "
+			  <<fPublished+fDropped<<" messages"<<std::endl;
+  }
+  fSocket.close();
+}
+
+void SSPDAQ::TelemetryPublisher::Add(std::string name, double value){
+
+  if(fFormat==kJSON){
+    fNames.push_back(name);
+    fDoubles.push_back(value);
+    return;
+  }
+
+  TelemetryRecord rec;
+  rec.type=kDouble;
+  rec.nameLength=std::min(name.size(),(size_t)255);
+  rec.count=1;
+  fSchema.insert(fSchema.end(),(const char*)&rec,(const char*)&rec+sizeof(rec));
+  fSchema.insert(fSchema.end(),name.begin(),name.begin()+rec.nameLength);
+  fValues.insert(fValues.end(),(const char*)&value,(const char*)&value+sizeof(value));
+  ++fNRecords;
+}
+
+void SSPDAQ::TelemetryPublisher::Add(std::string name, const std::vector<unsigned int>& values){
+
+  if(fFormat==kJSON){
+    for(unsigned int i=0;i<values.size();++i){
+      std::stringstream element;
+      element<<name<<"_"<<i;
+      fNames.push_back(element.str());
+      fDoubles.push_back(values[i]);
+    }
+    return;
+  }
+
+  if(values.size()>0xFFFF){
+    SSPDAQ::Log::Error()<<"Telemetry record "<<name<<" has too many values ("<<values.size()<<")"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+
+  TelemetryRecord rec;
+  rec.type=kUInt32;
+  rec.nameLength=std::min(name.size(),(size_t)255);
+  rec.count=values.size();
+  fSchema.insert(fSchema.end(),(const char*)&rec,(const char*)&rec+sizeof(rec));
+  fSchema.insert(fSchema.end(),name.begin(),name.begin()+rec.nameLength);
+  if(!values.empty()){
+    fValues.insert(fValues.end(),(const char*)&values[0],(const char*)&values[0]+values.size()*sizeof(unsigned int));
+  }
+  ++fNRecords;
+}
+
+void SSPDAQ::TelemetryPublisher::Publish(unsigned long board, std::chrono::system_clock::time_point time){
+
+  if(fFormat==kBinary){
+    this->PublishBinary(board,time);
+  }
+  else{
+    this->PublishJSON();
+  }
+
+  fSchema.clear();
+  fValues.clear();
+  fNRecords=0;
+  fNames.clear();
+  fDoubles.clear();
+}
+
+void SSPDAQ::TelemetryPublisher::Consume(const std::vector<SSPDAQ::PollSample>& samples){
+
+  if(samples.empty()){
+    return;
+  }
+  for(auto sample=samples.begin();sample!=samples.end();++sample){
+    this->Add(sample->name,sample->values);
+  }
+  this->Publish(samples.front().board,samples.front().time);
+}
+
+void SSPDAQ::TelemetryPublisher::PublishBinary(unsigned long board, std::chrono::system_clock::time_point time){
+
+  if(fNRecords>0xFFFF){
+    SSPDAQ::Log::Error()<<"Telemetry batch has too many records ("<<fNRecords<<")"<<std::endl;
+    throw(std::invalid_argument(""));
+  }
+
+  TelemetryHeader header;
+  header.magic=telemetryMagic;
+  header.version=telemetryVersion;
+  header.nRecords=fNRecords;
+  header.board=board;
+  header.schemaBytes=fSchema.size();
+  header.timeInus=std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+
+  //Header and schema share a frame; splice them together in front of the schema
+  fSchema.insert(fSchema.begin(),(const char*)&header,(const char*)&header+sizeof(header));
+
+  //PUB sends are all-or-nothing, so if the first part is queued the second will be too
+  if(this->Send(&fSchema[0],fSchema.size(),true)){
+    this->Send(fValues.empty()?0:&fValues[0],fValues.size());
+    ++fPublished;
+  }
+  else{
+    ++fDropped;
+  }
+}
+
+void SSPDAQ::TelemetryPublisher::PublishJSON(){
+
+  for(unsigned int i=0;i<fNames.size();++i){
+    Json::Value json;
+    json["type"]="moni";
+    json["service"]=fJSONService;
+    json["varname"]=fNames[i];
+    json["value"]=fDoubles[i];
+    std::string message=fJSONWriter.write(json);
+    if(this->Send(message.c_str(),message.length())){
+      ++fPublished;
+    }
+    else{
+      ++fDropped;
+    }
+  }
+}
+
+bool SSPDAQ::TelemetryPublisher::Send(const void* data, size_t size, bool more){
+
+  zmq::message_t message(size);
+  if(size){
+    std::memcpy(message.data(),data,size);
+  }
+  try{
+    //Returns false if the message would have blocked (high water mark reached)
+    return fSocket.send(message,ZMQ_DONTWAIT|(more?ZMQ_SNDMORE:0));
+  }
+  catch(zmq::error_t& e){
+    SSPDAQ::Log::Warning()<<"Telemetry send failed: "<<e.what()<<std::endl;
+    return false;
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef TELEMETRYPUBLISHER_H__
+#define TELEMETRYPUBLISHER_H__
+
+#include "RegisterPoller.h"
+#include "json/json.h"
+#include "zmq.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace SSPDAQ{
+
+  //Binary message layout. Each batch goes out as a two-part ZMQ message:
+  //  part 1: TelemetryHeader, then one TelemetryRecord plus name for each record
+  //  part 2: values of all records packed in the same order, little-endian
+  //The schema travels with every batch, so subscribers can join at any time.
+  static const unsigned int telemetryMagic=0x54505353; // "SSPT"
+  static const unsigned short telemetryVersion=1;
+
+  struct TelemetryHeader{
+    unsigned int magic;
+    unsigned short version;
+    unsigned short nRecords;
+    unsigned int board;
+    unsigned int schemaBytes; // size of record descriptors following header
+    unsigned long long timeInus; // since Unix epoch
+  };
+
+  struct TelemetryRecord{
+    unsigned char type; // TelemetryPublisher::Type_t
+    unsigned char nameLength; // name follows, not null terminated
+    unsigned short count; // number of values
+  };
+
+  //Sends monitoring values over ZeroMQ, one message per batch. Values are staged
+  //with Add and sent together by Publish, or passed straight through when used
+  //as a RegisterPoller sink. Sends never block; if a peer can't keep up, messages
+  //are dropped. Drops are counted for PUSH; PUB discards silently for slow subscribers.
+  //Not thread safe: use from one thread, or as a sink (which the poller serialises).
+  class TelemetryPublisher : public PollSink{
+
+  public:
+
+    enum Format_t{kBinary,kJSON};
+
+    enum Type_t{kUInt32=1,kDouble=2};
+
+    //kBinary binds a PUB socket on endpoint.
+    //kJSON connects a PUSH socket to endpoint and sends one JSON message per
+    //value, as the legacy monitoring server expects.
+    //Messages beyond highWaterMark queued for a peer are dropped.
+    TelemetryPublisher(zmq::context_t& context, std::string endpoint,
+		       Format_t format=kBinary, int highWaterMark=100);
+
+    ~TelemetryPublisher();
+
+    //Stage a value for the next Publish
+    void Add(std::string name, double value);
+
+    //Stage an array of register values for the next Publish
+    void Add(std::string name, const std::vector<unsigned int>& values);
+
+    //Send all staged values as one batch
+    void Publish(unsigned long board,
+		 std::chrono::system_clock::time_point time=std::chrono::system_clock::now());
+
+    //Publish each polling batch as it arrives
+    virtual void Consume(const std::vector<PollSample>& samples);
+
+    //Value of "service" field in JSON messages
+    void SetJSONService(std::string service){fJSONService=service;}
+
+    inline unsigned long Published() const{return fPublished;}
+
+    inline unsigned long Dropped() const{return fDropped;}
+
+  private:
+
+    void PublishBinary(unsigned long board, std::chrono::system_clock::time_point time);
+
+    void PublishJSON();
+
+    //Non-blocking send; returns false if the message had to be dropped
+    bool Send(const void* data, size_t size, bool more=false);
+
+    zmq::socket_t fSocket;
+
+    Format_t fFormat;
+
+    //Staged batch: schema and values as they will go on the wire
+    std::vector<char> fSchema;
+    std::vector<char> fValues;
+    unsigned int fNRecords;
+
+    //Staged batch in structured form, for JSON output
+    std::vector<std::string> fNames;
+    std::vector<double> fDoubles;
+
+    Json::FastWriter fJSONWriter;
+
+    std::string fJSONService;
+
+    unsigned long fPublished;
+
+    unsigned long fDropped;
+  };
+
+}//namespace
+#endif
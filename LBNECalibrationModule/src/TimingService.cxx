@@ -0,0 +1,288 @@
+#include "TimingService.h"
+#include "EventDecoder.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+SSPDAQ::TimingService::TimingService(double internalClockInMHz, double sharedClockInMHz):
+  fInternalClockInMHz(internalClockInMHz),
+  fSharedClockInMHz(sharedClockInMHz),
+  fSyncPeriod(1UL<<32),
+  fWindowSamples(256),
+  fSampleIntervalInTicks(internalClockInMHz*1E4), // 10ms
+  fMaxResidual(sharedClockInMHz), // 1us
+  fMaxRejects(16),
+  fMaxStep(sharedClockInMHz*1E3), // 1ms
+  fMaxSlew(1E-3),
+  fSlewTicks(internalClockInMHz*1E6), // 1s
+  fMinSamples(4)
+{}
+
+void SSPDAQ::TimingService::SetFitWindow(unsigned int windowSamples, double intervalInms){
+  fWindowSamples=std::max(windowSamples,2u);
+  fSampleIntervalInTicks=intervalInms*fInternalClockInMHz*1E3;
+}
+
+void SSPDAQ::TimingService::SetTolerance(double maxResidualInTicks, unsigned int maxRejects){
+  fMaxResidual=maxResidualInTicks;
+  fMaxRejects=std::max(maxRejects,1u);
+}
+
+void SSPDAQ::TimingService::SetSteering(double maxStepInTicks, double maxSlewInppm){
+  fMaxStep=maxStepInTicks;
+  fMaxSlew=maxSlewInppm*1E-6;
+}
+
+void SSPDAQ::TimingService::Transform::Anchor(unsigned long internalTimestamp){
+  long delta=(long)((internalTimestamp-internalRef)<<16)>>16;
+  double unified=unifiedFraction+delta*ticksPerTick;
+  double whole=std::floor(unified);
+  unifiedRef+=(long)whole;
+  unifiedFraction=unified-whole;
+  internalRef=internalTimestamp;
+}
+
+SSPDAQ::TimingService::BoardClock& SSPDAQ::TimingService::Board(unsigned long boardId){
+  std::lock_guard<std::mutex> lock(fBoardsMutex);
+  std::unique_ptr<BoardClock>& clock=fBoards[boardId];
+  if(!clock){
+    clock.reset(new BoardClock(*this));
+  }
+  return *clock;
+}
+
+bool SSPDAQ::TimingService::GetTransform(unsigned long boardId, Transform& transform) const{
+  std::lock_guard<std::mutex> lock(fBoardsMutex);
+  auto clock=fBoards.find(boardId);
+  if(clock==fBoards.end()){
+    return false;
+  }
+  transform=clock->second->GetTransform();
+  return true;
+}
+
+bool SSPDAQ::TimingService::GetStats(unsigned long boardId, Stats& stats) const{
+  std::lock_guard<std::mutex> lock(fBoardsMutex);
+  auto clock=fBoards.find(boardId);
+  if(clock==fBoards.end()){
+    return false;
+  }
+  stats=clock->second->GetStats();
+  return true;
+}
+
+SSPDAQ::TimingService::BoardClock::BoardClock(const TimingService& service):
+  fService(service),
+  fHaveInternal(false),
+  fInternal(0),
+  fHaveExternal(false),
+  fLastSyncCount(0),
+  fSyncCount(0),
+  fNextSampleAt(0),
+  fRejectsInRow(0),
+  fFitIntercept(0.),
+  fFitSlope(service.fSharedClockInMHz/service.fInternalClockInMHz),
+  fAnchored(false),
+  fLastUnified(0)
+{
+  std::memset(&fStats,0,sizeof(fStats));
+  fTransform.internalRef=0;
+  fTransform.unifiedRef=0;
+  fTransform.unifiedFraction=0.;
+  fTransform.ticksPerTick=fFitSlope;
+  fStats.transform=fTransform;
+  fPublished=fStats;
+}
+
+unsigned long SSPDAQ::TimingService::BoardClock::Unify(const EventHeader& header){
+
+  unsigned long raw=Decode::InternalTimestamp(header);
+  if(!fHaveInternal){
+    //Until there is an external sample, just scale the internal time
+    fInternal=raw;
+    double unified=raw*fTransform.ticksPerTick;
+    fTransform.internalRef=raw;
+    fTransform.unifiedRef=unified;
+    fTransform.unifiedFraction=unified-std::floor(unified);
+    fHaveInternal=true;
+  }
+  else{
+    //Events from different channels may be slightly out of order, so unwrap
+    //by the signed difference rather than assuming time only goes forward
+    fInternal+=(long)((raw-fInternal)<<16)>>16;
+  }
+
+  if(fInternal>=fNextSampleAt){
+    this->AddSample(fInternal,header);
+  }
+  unsigned long unified=fTransform.Apply(raw);
+  fLastUnified=std::max(fLastUnified,unified);
+  return unified;
+}
+
+SSPDAQ::TimingService::Transform SSPDAQ::TimingService::BoardClock::GetTransform() const{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fPublished.transform;
+}
+
+SSPDAQ::TimingService::Stats SSPDAQ::TimingService::BoardClock::GetStats() const{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fPublished;
+}
+
+void SSPDAQ::TimingService::BoardClock::AddSample(unsigned long internal, const EventHeader& header){
+
+  fNextSampleAt=internal+fService.fSampleIntervalInTicks;
+  double nominal=fService.fSharedClockInMHz/fService.fInternalClockInMHz;
+
+  unsigned int syncCount=Decode::SyncCount(header);
+  unsigned int syncDelay=Decode::SyncDelay(header);
+
+  //No timing system; keep the reference recent so that raw timestamps stay in range
+  if(!fHaveExternal&&syncCount==0&&syncDelay==0){
+    fTransform.Anchor(internal);
+  }
+  else{
+    if(!fHaveExternal){
+      fSyncCount=syncCount;
+      fHaveExternal=true;
+    }
+    else{
+      fSyncCount+=(long)(int)(syncCount-fLastSyncCount);
+    }
+    fLastSyncCount=syncCount;
+    unsigned long external=fSyncCount*fService.fSyncPeriod+syncDelay;
+
+    bool accept=true;
+    if(!fSamples.empty()){
+      const Sample& last=fSamples.back();
+      double residual;
+      double tolerance=fService.fMaxResidual;
+      if(fSamples.size()>=fService.fMinSamples){
+	residual=(double)(long)(external-fSamples.front().external)-this->FitAt(internal);
+      }
+      else{
+	//Not enough for a fit yet, so compare with the nominal rate, allowing for drift
+	double elapsed=(double)(long)(internal-last.internal);
+	residual=(double)(long)(external-last.external)-elapsed*nominal;
+	tolerance+=std::fabs(elapsed*nominal)*fService.fMaxSlew;
+      }
+
+      if(std::fabs(residual)>tolerance){
+	++fStats.rejected;
+	if(++fRejectsInRow<fService.fMaxRejects){
+	  accept=false;
+	}
+	else{
+	  //Persistent disagreement: the external clock has been resynchronised
+	  SSPDAQ::Log::Warning()<<"Warning: external timestamps have moved by "<<(long)residual
+				<<" ticks; restarting clock fit, unified time may step forward"<<std::endl;
+	  ++fStats.resyncs;
+	  fSamples.clear();
+	  fAnchored=false;
+	}
+      }
+    }
+
+    if(accept){
+      fRejectsInRow=0;
+      Sample sample={internal,external};
+      fSamples.push_back(sample);
+      if(fSamples.size()>fService.fWindowSamples){
+	fSamples.pop_front();
+      }
+      ++fStats.samples;
+      this->Fit();
+      this->Steer(internal);
+
+      fStats.locked=fSamples.size()>=fService.fMinSamples;
+      fStats.driftInppm=fSamples.size()>1?(fFitSlope/nominal-1.)*1E6:0.;
+      fStats.offsetInTicks=(double)external-(double)internal*nominal;
+    }
+  }
+
+  fStats.transform=fTransform;
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPublished=fStats;
+}
+
+void SSPDAQ::TimingService::BoardClock::Fit(){
+
+  double nominal=fService.fSharedClockInMHz/fService.fInternalClockInMHz;
+  const Sample& first=fSamples.front();
+  size_t n=fSamples.size();
+
+  //Work relative to the first sample, so that doubles keep every tick
+  double sumX=0., sumY=0.;
+  for(auto sample=fSamples.begin();sample!=fSamples.end();++sample){
+    sumX+=(double)(long)(sample->internal-first.internal);
+    sumY+=(double)(long)(sample->external-first.external);
+  }
+  double meanX=sumX/n;
+  double meanY=sumY/n;
+  double sxx=0., sxy=0.;
+  for(auto sample=fSamples.begin();sample!=fSamples.end();++sample){
+    double dx=(double)(long)(sample->internal-first.internal)-meanX;
+    double dy=(double)(long)(sample->external-first.external)-meanY;
+    sxx+=dx*dx;
+    sxy+=dx*dy;
+  }
+  fFitSlope=sxx>0.?sxy/sxx:nominal;
+  fFitIntercept=meanY-fFitSlope*meanX;
+
+  double sumResidual2=0.;
+  for(auto sample=fSamples.begin();sample!=fSamples.end();++sample){
+    double residual=(double)(long)(sample->external-first.external)-this->FitAt(sample->internal);
+    sumResidual2+=residual*residual;
+  }
+  fStats.rmsResidualInTicks=std::sqrt(sumResidual2/n);
+}
+
+double SSPDAQ::TimingService::BoardClock::FitAt(unsigned long internal) const{
+  return fFitIntercept+fFitSlope*(double)(long)(internal-fSamples.front().internal);
+}
+
+void SSPDAQ::TimingService::BoardClock::Steer(unsigned long internal){
+
+  const Sample& first=fSamples.front();
+  double target=this->FitAt(internal);
+  fTransform.Anchor(internal);
+  double error=target-((double)(long)(fTransform.unifiedRef-first.external)+fTransform.unifiedFraction);
+
+  //Take the fit as it is at first, and step forward rather than wait a long
+  //time for a big difference to be slewed out. Never go back on unified time
+  //already handed out, though, not even for a new fit after a resync, as
+  //millislices are built assuming it never goes backward: start from the last
+  //one instead and slew the rest out.
+  if(!fAnchored||error>fService.fMaxStep){
+    if(fAnchored){
+      ++fStats.steps;
+      SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: unified time stepped forward by "
+							 <<(long)error<<" ticks"<<std::endl;
+    }
+    double start=fLastUnified?std::max(target,(double)(long)(fLastUnified-first.external)):target;
+    if(start>target){
+      ++fStats.clamps;
+      SSPDAQ_LOG_RATE_LIMITED(SSPDAQ::Log::kWarning,1000)<<"Warning: clock fit is "<<(long)(start-target)
+							 <<" ticks behind unified time; slewing rather than stepping back"<<std::endl;
+    }
+    double whole=std::floor(start);
+    fTransform.unifiedRef=first.external+(long)whole;
+    fTransform.unifiedFraction=start-whole;
+    fAnchored=true;
+    error=target-start;
+    if(error==0.){
+      fTransform.ticksPerTick=fFitSlope;
+      fStats.errorInTicks=0.;
+      return;
+    }
+  }
+
+  //Otherwise carry on from where unified time is now, at the fitted rate plus
+  //enough to remove the error over the slew time
+  double maxSlew=fService.fMaxSlew*fFitSlope;
+  double slew=std::max(-maxSlew,std::min(maxSlew,error/fService.fSlewTicks));
+  fTransform.ticksPerTick=fFitSlope+slew;
+  fStats.errorInTicks=-error;
+}
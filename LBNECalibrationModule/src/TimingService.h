@@ -0,0 +1,196 @@
+#ifndef TIMINGSERVICE_H__
+#define TIMINGSERVICE_H__
+
+#include "anlTypes.h"
+#include <cmath>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace SSPDAQ{
+
+  //Puts events from every board onto one timebase, the shared sync clock.
+  //
+  //Each event carries the board's own 48-bit internal timestamp and an external
+  //one, made of the clocks since the last sync pulse and the sync pulse count.
+  //The internal clock always runs, but each board's has its own offset and rate;
+  //the external one is common to all boards but is only there with a timing
+  //system attached. For each board, the service samples both as events are read
+  //and fits the external time against the internal one over a sliding window,
+  //giving the offset and drift between the two clocks.
+  //
+  //The unified timestamp of an event is its internal timestamp put through a
+  //linear transform taken from the fit: a subtraction, a multiply and an add.
+  //The transform is only ever changed in a way which keeps unified time
+  //continuous and increasing: small differences from the fit are slewed out by
+  //adjusting the rate, and only large forward ones are stepped. This holds
+  //after a resynchronisation of the external clock too (see below): a new fit
+  //ahead of unified time is stepped to, one behind it is slewed out. Boards
+  //with no external timestamps just get their internal time scaled to the
+  //shared clock.
+  //
+  //Both timestamps are unwrapped, so the internal one may roll over at 48 bits
+  //and the sync count at 32 bits. Samples which disagree with the fit are
+  //rejected; if they keep disagreeing the external clock is assumed to have
+  //been resynchronised, and the fit starts again from the new samples.
+  class TimingService{
+
+  public:
+
+    //Maps internal timestamps of one board to unified time. Copies can be
+    //applied in any thread, to raw 48-bit timestamps within about 2^47 ticks
+    //of the reference.
+    struct Transform{
+      unsigned long internalRef;
+      unsigned long unifiedRef;
+      double unifiedFraction; // of a tick, in [0,1), so that re-anchoring doesn't round
+      double ticksPerTick;    // shared clock ticks per internal clock tick
+
+      inline unsigned long Apply(unsigned long internalTimestamp) const{
+	//Signed 48-bit difference, so that wraps between the two are handled
+	long delta=(long)((internalTimestamp-internalRef)<<16)>>16;
+	return unifiedRef+(long)std::floor(unifiedFraction+delta*ticksPerTick);
+      }
+
+      //Exact unified time at internalTimestamp, as a reference and fraction
+      void Anchor(unsigned long internalTimestamp);
+    };
+
+    struct Stats{
+      bool locked;                // fit has enough samples
+      unsigned long samples;      // accepted into the fit
+      unsigned long rejected;     // disagreed with the fit
+      unsigned long resyncs;      // fit restarted after repeated rejections
+      unsigned long steps;        // unified time stepped forward
+      unsigned long clamps;       // fit behind unified time when restarted, so slewed rather than stepped back
+      double driftInppm;          // of internal clock relative to nominal rates
+      double offsetInTicks;       // external minus nominally scaled internal, at last sample
+      double errorInTicks;        // unified time minus fit, being slewed out
+      double rmsResidualInTicks;  // of samples about the fit
+      Transform transform;        // as used for the last sample
+    };
+
+    //Unifies the timestamps of one board. Only one thread, normally the
+    //board's read thread, may call Unify.
+    class BoardClock{
+
+    public:
+
+      explicit BoardClock(const TimingService& service);
+
+      //Unified timestamp of an event, taking a timing sample from it if one is due
+      unsigned long Unify(const EventHeader& header);
+
+      Transform GetTransform() const;
+
+      Stats GetStats() const;
+
+      inline double SharedClockRateInMHz() const{return fService.SharedClockRateInMHz();}
+
+    private:
+
+      struct Sample{
+	unsigned long internal;
+	unsigned long external;
+      };
+
+      void AddSample(unsigned long internal, const EventHeader& header);
+
+      //Least squares fit of external against internal time over fSamples
+      void Fit();
+
+      //External time predicted by the fit
+      double FitAt(unsigned long internal) const;
+
+      //Bring fTransform towards the fit at internal
+      void Steer(unsigned long internal);
+
+      const TimingService& fService;
+
+      //Unwrapping
+      bool fHaveInternal;
+      unsigned long fInternal;
+      bool fHaveExternal;
+      unsigned int fLastSyncCount;
+      unsigned long fSyncCount;
+
+      unsigned long fNextSampleAt;
+      std::deque<Sample> fSamples;
+      unsigned int fRejectsInRow;
+
+      //Fit, relative to the first sample in the window
+      double fFitIntercept;
+      double fFitSlope;
+
+      //Whether fTransform follows the fit yet
+      bool fAnchored;
+
+      //Latest unified time returned by Unify; never gone back on
+      unsigned long fLastUnified;
+
+      //Used by Unify; copied to fPublished after each sample
+      Transform fTransform;
+      Stats fStats;
+
+      mutable std::mutex fMutex;
+      Stats fPublished;
+    };
+
+    //Nominal clock rates, used to scale internal time before there is a fit
+    TimingService(double internalClockInMHz=150., double sharedClockInMHz=150.);
+
+    //The setters below must be called before any boards are added.
+
+    //Shared clock ticks between sync pulses. The default of 2^32 treats the
+    //external timestamp as a single 64-bit count, as the emulator writes it.
+    void SetSyncPeriodInTicks(unsigned long period){fSyncPeriod=period;}
+
+    //Fit over the last windowSamples samples, taken at most every intervalInms of internal time
+    void SetFitWindow(unsigned int windowSamples, double intervalInms);
+
+    //Reject samples more than maxResidualInTicks from the fit, and restart the
+    //fit after maxRejects rejections in a row
+    void SetTolerance(double maxResidualInTicks, unsigned int maxRejects);
+
+    //Step unified time forward rather than slewing if it is behind the fit by more
+    //than maxStepInTicks, and slew by at most maxSlewInppm otherwise
+    void SetSteering(double maxStepInTicks, double maxSlewInppm);
+
+    //Clock for a board, created on first use. Stays valid for the life of the service.
+    BoardClock& Board(unsigned long boardId);
+
+    //Latest transform or stats for a board. Return false if the board is unknown.
+    bool GetTransform(unsigned long boardId, Transform& transform) const;
+
+    bool GetStats(unsigned long boardId, Stats& stats) const;
+
+    inline double InternalClockRateInMHz() const{return fInternalClockInMHz;}
+
+    inline double SharedClockRateInMHz() const{return fSharedClockInMHz;}
+
+  private:
+
+    double fInternalClockInMHz;
+    double fSharedClockInMHz;
+
+    unsigned long fSyncPeriod;
+
+    unsigned int fWindowSamples;
+    unsigned long fSampleIntervalInTicks; // internal clock
+
+    double fMaxResidual;
+    unsigned int fMaxRejects;
+
+    double fMaxStep;
+    double fMaxSlew;
+    unsigned long fSlewTicks; // internal ticks over which an error is slewed out
+
+    unsigned int fMinSamples;
+
+    mutable std::mutex fBoardsMutex;
+    std::map<unsigned long,std::unique_ptr<BoardClock> > fBoards;
+  };
+
+}//namespace
+#endif
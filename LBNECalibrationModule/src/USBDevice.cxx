@@ -4,12 +4,21 @@
 #include "Log.h"
 #include "anlExceptions.h"
 
-SSPDAQ::USBDevice::USBDevice(FT_DEVICE_LIST_INFO_NODE* dataChannel, FT_DEVICE_LIST_INFO_NODE* commChannel){
+const unsigned int SSPDAQ::USBDevice::dataTimeout;
+
+SSPDAQ::USBDevice::USBDevice(FT_DEVICE_LIST_INFO_NODE* dataChannel, FT_DEVICE_LIST_INFO_NODE* commChannel):
+  fRingWrite(0),fRingRead(0),
+  fReaderShouldStop(false),fReaderFailed(false),
+  fBytesRead(0),fReadCalls(0){
   fDataChannel=*dataChannel;
   fCommChannel=*commChannel;
   isOpen=false;
 }
 
+SSPDAQ::USBDevice::~USBDevice(){
+  this->StopReader();
+}
+
 void SSPDAQ::USBDevice::Open(bool slowControlOnly){
 
   fSlowControlOnly=slowControlOnly;
@@ -70,7 +79,8 @@ void SSPDAQ::USBDevice::Open(bool slowControlOnly){
     if (FT_SetUSBParameters(dataHandle, dataBufferSize, dataBufferSize) != FT_OK) {
       hasFailed=true;
     }
-    if (FT_SetTimeouts(dataHandle, dataTimeout, 0) != FT_OK) {
+    //Reader thread wants FT_Read to come back promptly with whatever has arrived
+    if (FT_SetTimeouts(dataHandle, readerTimeout, 0) != FT_OK) {
       hasFailed=true;
     }
     if (FT_SetFlowControl(dataHandle, FT_FLOW_RTS_CTS, 0, 0) != FT_OK) {
@@ -84,6 +94,7 @@ void SSPDAQ::USBDevice::Open(bool slowControlOnly){
       throw(SSPDAQ::EFTDIError("Failed to configure USB data channel"));
     }
     else{
+      this->StartReader();
       SSPDAQ::Log::Info()<<"Device open!"<<std::endl;
       isOpen=true;
     }
@@ -96,6 +107,8 @@ void SSPDAQ::USBDevice::Close(){
   // to avoid crashing LBNEWare when Disconnect is pressed
   if(!fSlowControlOnly){
     this->DevicePurgeData();
+    this->StopReader();
+    SSPDAQ::Log::Info()<<"Read "<<fBytesRead<<" bytes from USB data path in "<<fReadCalls<<" reads"<<std::endl;
   }
   this->DevicePurgeComm();
   
@@ -121,33 +134,135 @@ void SSPDAQ::USBDevice::DevicePurgeComm (void)
 
 void SSPDAQ::USBDevice::DevicePurgeData (void)
 {
+  //Reader thread would race the purge for the data, so stop it while we
+  //empty the driver queue, then throw away anything it had already read
+  bool readerWasRunning=(bool)fReaderThread;
+  this->StopReader();
   DevicePurge(fDataChannel);
+  fRingRead=0;
+  fRingWrite=0;
+  if(readerWasRunning){
+    this->StartReader();
+  }
 }
 
 void SSPDAQ::USBDevice::DeviceQueueStatus(unsigned int* numWords)
 {
-  unsigned int numBytes;
-  if(FT_GetQueueStatus(fDataChannel.ftHandle, &numBytes)!=FT_OK){
+  if(fReaderFailed){
     SSPDAQ::Log::Error()<<"Error getting queue length from USB device"<<std::endl;
     throw(EFTDIError("Error getting queue length from USB device"));
   }
+  unsigned long numBytes=fRingWrite.load(std::memory_order_acquire)-fRingRead.load(std::memory_order_relaxed);
   (*numWords)=numBytes/sizeof(unsigned int);
-  
 }
 
 void SSPDAQ::USBDevice::DeviceReceive(std::vector<unsigned int>& data, unsigned int size){
 
-  unsigned int* buf = new unsigned int[size];
-  unsigned int dataReturned;
+  unsigned long sizeInBytes=(unsigned long)size*sizeof(unsigned int);
+  unsigned long readPos=fRingRead.load(std::memory_order_relaxed);
 
-  if(FT_Read(fDataChannel.ftHandle, (void*)buf, size*sizeof(unsigned int), &dataReturned)!=FT_OK){
-    delete[] buf;
+  //As FT_Read did, wait up to dataTimeout for the full amount before
+  //returning whatever has arrived
+  if(fRingWrite.load(std::memory_order_acquire)-readPos<sizeInBytes){
+    std::unique_lock<std::mutex> lock(fRingMutex);
+    fRingCondition.wait_for(lock,std::chrono::milliseconds(dataTimeout),[this,readPos,sizeInBytes]{
+	return fReaderFailed||fRingWrite.load(std::memory_order_acquire)-readPos>=sizeInBytes;});
+  }
+  if(fReaderFailed){
     SSPDAQ::Log::Error()<<"FTDI fault on data receive"<<std::endl;
     throw(EFTDIError("FTDI fault on data receive"));
   }
 
-  data.assign(buf,buf+(dataReturned/sizeof(unsigned int)));
-  delete[] buf;
+  //Hand over whole words only, copying around the end of the ring if needed
+  unsigned long available=fRingWrite.load(std::memory_order_acquire)-readPos;
+  unsigned long bytes=std::min(sizeInBytes,available-available%sizeof(unsigned int));
+  data.resize(bytes/sizeof(unsigned int));
+  if(bytes){
+    unsigned long start=readPos&(ringBufferSize-1);
+    unsigned long first=std::min(bytes,ringBufferSize-start);
+    std::memcpy((char*)&data[0],&fRing[start],first);
+    std::memcpy((char*)&data[0]+first,&fRing[0],bytes-first);
+  }
+  fRingRead.store(readPos+bytes,std::memory_order_release);
+}
+
+unsigned int SSPDAQ::USBDevice::DeviceDiscard(unsigned int size){
+
+  //As DeviceReceive, but just move the read position on
+  unsigned long sizeInBytes=(unsigned long)size*sizeof(unsigned int);
+  unsigned long readPos=fRingRead.load(std::memory_order_relaxed);
+  if(fRingWrite.load(std::memory_order_acquire)-readPos<sizeInBytes){
+    std::unique_lock<std::mutex> lock(fRingMutex);
+    fRingCondition.wait_for(lock,std::chrono::milliseconds(dataTimeout),[this,readPos,sizeInBytes]{
+	return fReaderFailed||fRingWrite.load(std::memory_order_acquire)-readPos>=sizeInBytes;});
+  }
+  if(fReaderFailed){
+    SSPDAQ::Log::Error()<<"FTDI fault on data discard"<<std::endl;
+    throw(EFTDIError("FTDI fault on data discard"));
+  }
+  unsigned long available=fRingWrite.load(std::memory_order_acquire)-readPos;
+  unsigned long bytes=std::min(sizeInBytes,available-available%sizeof(unsigned int));
+  fRingRead.store(readPos+bytes,std::memory_order_release);
+  return bytes/sizeof(unsigned int);
+}
+
+void SSPDAQ::USBDevice::StartReader(){
+
+  if(fReaderThread){
+    return;
+  }
+  if(!fRing){
+    fRing.reset(new char[ringBufferSize]);
+  }
+  fReaderShouldStop=false;
+  fReaderFailed=false;
+  fReaderThread=std::unique_ptr<std::thread>(new std::thread(&SSPDAQ::USBDevice::ReadData,this));
+}
+
+void SSPDAQ::USBDevice::StopReader(){
+
+  if(!fReaderThread){
+    return;
+  }
+  fReaderShouldStop=true;
+  fReaderThread->join();
+  fReaderThread.reset();
+}
+
+void SSPDAQ::USBDevice::ReadData(){
+
+  while(!fReaderShouldStop){
+    unsigned long writePos=fRingWrite.load(std::memory_order_relaxed);
+    unsigned long space=ringBufferSize-(writePos-fRingRead.load(std::memory_order_acquire));
+
+    //Ring full; hardware will hold on to data until the consumer catches up
+    if(space==0){
+      usleep(1000);
+      continue;
+    }
+
+    //Read into contiguous free space only
+    unsigned long start=writePos&(ringBufferSize-1);
+    unsigned int bytesToRead=std::min(std::min(space,ringBufferSize-start),(unsigned long)readerChunkSize);
+    unsigned int bytesReturned=0;
+
+    if(FT_Read(fDataChannel.ftHandle,(void*)&fRing[start],bytesToRead,&bytesReturned)!=FT_OK){
+      SSPDAQ::Log::Error()<<"FTDI fault in USB reader thread"<<std::endl;
+      fReaderFailed=true;
+      fRingCondition.notify_all();
+      return;
+    }
+    ++fReadCalls;
+    if(bytesReturned){
+      fBytesRead+=bytesReturned;
+      fRingWrite.store(writePos+bytesReturned,std::memory_order_release);
+      {
+	//Lock so a consumer can't miss the wakeup between its check and its wait
+	std::lock_guard<std::mutex> lock(fRingMutex);
+      }
+      fRingCondition.notify_one();
+    }
+  }
 }
 
 //==============================================================================
@@ -12,6 +12,11 @@
 #include <cstdio>
 #include <cstring>
 #include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace SSPDAQ{
 
@@ -29,6 +34,10 @@ class USBDevice : public Device{
   static const unsigned int dataLatency = 2;		// in ms
   static const unsigned int dataTimeout	= 1000;		// in ms
 
+  static const unsigned int readerTimeout = 10;		// in ms - FT_Read timeout in reader thread
+  static const unsigned int readerChunkSize = 0x10000;	// largest single FT_Read, in bytes
+  static const unsigned int ringBufferSize = 0x1000000;	// 16MB - must be power of 2
+
  friend class DeviceManager;
 
  public:
@@ -36,7 +45,8 @@ class USBDevice : public Device{
  //Create a device object using FTDI handles given for data and communication channels
  USBDevice(FT_DEVICE_LIST_INFO_NODE* dataChannel, FT_DEVICE_LIST_INFO_NODE* commChannel);
 
- virtual ~USBDevice(){};
+ //Stops reader thread if still running
+ virtual ~USBDevice();
  
  //Implementation of base class interface
 
@@ -54,6 +64,8 @@ class USBDevice : public Device{
 
   virtual void DeviceReceive(std::vector<unsigned int>& data, unsigned int size);
 
+  virtual unsigned int DeviceDiscard(unsigned int size);
+
   virtual void DeviceRead(unsigned int address, unsigned int* value);
 
   virtual void DeviceReadMask(unsigned int address, unsigned int mask, unsigned int* value);
@@ -103,6 +115,36 @@ class USBDevice : public Device{
 
   //Function called by DevicePurgeComm and DevicePurgeData
   void DevicePurge(FT_DEVICE_LIST_INFO_NODE& channel);
+
+  //Data path reader thread. Keeps an FT_Read outstanding whenever there is
+  //room in fRing, reading straight into the ring, so the driver's queue is
+  //always being drained while the caller is busy decoding.
+  void ReadData();
+
+  void StartReader();
+
+  void StopReader();
+
+  //Single producer (reader thread), single consumer (DeviceReceive) byte ring.
+  //Positions count bytes since the ring was last reset and are only ever
+  //increased, so fill level is fRingWrite-fRingRead.
+  std::unique_ptr<char[]> fRing;
+  std::atomic<unsigned long> fRingWrite;
+  std::atomic<unsigned long> fRingRead;
+
+  std::unique_ptr<std::thread> fReaderThread;
+  std::atomic<bool> fReaderShouldStop;
+
+  //Set by reader thread if FT_Read fails; reported by the next DeviceReceive
+  std::atomic<bool> fReaderFailed;
+
+  //Used by DeviceReceive to wait for more data
+  std::mutex fRingMutex;
+  std::condition_variable fRingCondition;
+
+  //Totals for this device, reported on close
+  std::atomic<unsigned long> fBytesRead;
+  std::atomic<unsigned long> fReadCalls;
 };
 
 }//namespace
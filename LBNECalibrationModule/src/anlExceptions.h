@@ -87,5 +87,18 @@ namespace SSPDAQ{
       std::runtime_error("") {}
   };
 
+  //=============================//
+  //Error writing data out to disk//
+  //=============================//
+
+  class EFileError: public std::runtime_error{
+  public:
+    explicit EFileError(const std::string &s):
+      std::runtime_error(s) {}
+
+    explicit EFileError():
+      std::runtime_error("") {}
+  };
+
 }//namespace
 #endif
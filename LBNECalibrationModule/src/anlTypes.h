@@ -9,7 +9,10 @@
 namespace SSPDAQ{
 
   //Readable names for interface types
-enum Comm_t{kUSB, kEthernet, kEmulated};
+enum Comm_t{kUSB, kEthernet, kEmulated, kReplay};
+
+  //What DeviceInterface reads out for each event (see DeviceInterface::SetReadoutMode)
+enum ReadoutMode_t{kFullReadout, kHeadersOnly, kPrescaledWaveforms, kAmplitudeCut};
 
 //==============================================================================
 // Enumerated Constants
@@ -63,10 +66,22 @@ enum statusConstants {
    unsigned long endTime;
    unsigned int	length;				// Packet Length in unsigned ints (including header)
    unsigned int nTriggers;
-   
-   static const size_t sizeInUInts = 6;
+   unsigned int flags;
+   unsigned int nDroppedSlices;			// Slices lost immediately before this one
+
+   static const size_t sizeInUInts = 8;
+
+   //Bits in flags
+   static const unsigned int kAfterDroppedSlices = 0x1;	// nDroppedSlices is non-zero
+   static const unsigned int kReadoutModeMask = 0x30;		// ReadoutMode_t the events were read out with
+   static const unsigned int kReadoutModeShift = 4;
+   static const unsigned int kTimeBaseMask = 0xC0;		// TimeMode_t of startTime, endTime and event order
+   static const unsigned int kTimeBaseShift = 6;
  };
 
+ static_assert(sizeof(MillisliceHeader)==MillisliceHeader::sizeInUInts*sizeof(unsigned int),
+	       "MillisliceHeader::sizeInUInts doesn't match struct layout");
+
   //Structure defined by hardware, i.e. hardware output can be written straight into this struct
 struct EventHeader {	// NOTE: Group fields are listed from MSB to LSB
 	unsigned int	header;				// 0xAAAAAAAA
@@ -0,0 +1,25 @@
+#ifndef CHECK_H__
+#define CHECK_H__
+
+#include <iostream>
+
+//Minimal checks for the test programs: each failed check is reported with its
+//location, and main returns Failures() so that make test stops on a failure.
+
+namespace{
+  int nFailures=0;
+
+  inline int Failures(const char* name){
+    std::cout<<name<<": "<<(nFailures?"FAILED":"passed")<<std::endl;
+    return nFailures?1:0;
+  }
+}
+
+#define CHECK(condition) do{						\
+    if(!(condition)){							\
+      std::cerr<<__FILE__<<":"<<__LINE__<<": check failed: "<<#condition<<std::endl; \
+      ++nFailures;							\
+    }									\
+  }while(0)
+
+#endif
@@ -0,0 +1,233 @@
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "CommandExecutor.h"
+
+using namespace std;
+
+//Register words in a map, recording each control transaction
+class FakeDevice: public SSPDAQ::Device{
+
+public:
+
+  struct Transaction{
+    string type;
+    unsigned int address;
+    unsigned int size;
+  };
+
+  vector<Transaction> transactions;
+  map<unsigned int,unsigned int> words;
+
+  //Any access to this address fails
+  static const unsigned int badAddress=0xBAD0;
+
+  bool IsOpen(){return true;}
+  void Close(){}
+  void Open(bool){}
+  void DevicePurgeComm(){}
+  void DevicePurgeData(){}
+  void DeviceQueueStatus(unsigned int* numWords){*numWords=0;}
+  void DeviceReceive(std::vector<unsigned int>& data, unsigned int){data.clear();}
+
+  void DeviceRead(unsigned int address, unsigned int* value){
+    this->Record("read",address,1);
+    *value=words[address];
+  }
+  void DeviceReadMask(unsigned int address, unsigned int mask, unsigned int* value){
+    this->Record("readmask",address,1);
+    *value=words[address]&mask;
+  }
+  void DeviceWrite(unsigned int address, unsigned int value){
+    this->Record("write",address,1);
+    words[address]=value;
+  }
+  void DeviceWriteMask(unsigned int address, unsigned int mask, unsigned int value){
+    this->Record("writemask",address,1);
+    words[address]=(words[address]&~mask)|(value&mask);
+  }
+  void DeviceSet(unsigned int address, unsigned int mask){this->DeviceWriteMask(address,mask,0xFFFFFFFF);}
+  void DeviceClear(unsigned int address, unsigned int mask){this->DeviceWriteMask(address,mask,0);}
+  void DeviceArrayRead(unsigned int address, unsigned int size, unsigned int* data){
+    this->Record("arrayread",address,size);
+    for(unsigned int i=0;i<size;++i){
+      data[i]=words[address+0x4*i];
+    }
+  }
+  void DeviceArrayWrite(unsigned int address, unsigned int size, unsigned int* data){
+    this->Record("arraywrite",address,size);
+    for(unsigned int i=0;i<size;++i){
+      words[address+0x4*i]=data[i];
+    }
+  }
+  void DeviceNVWrite(unsigned int, unsigned int){}
+  void DeviceNVArrayWrite(unsigned int, unsigned int, unsigned int*){}
+  void DeviceNVEraseSector(unsigned int){}
+  void DeviceNVEraseBlock(unsigned int){}
+  void DeviceNVEraseChip(unsigned int){}
+
+private:
+
+  void Record(const char* type, unsigned int address, unsigned int size){
+    if(address==badAddress){
+      throw(std::runtime_error("bad address"));
+    }
+    Transaction transaction={type,address,size};
+    transactions.push_back(transaction);
+  }
+};
+
+//Holds the worker in a task until Release, so that everything submitted
+//meanwhile is taken as one batch
+class Hold{
+
+public:
+
+  Hold(SSPDAQ::CommandExecutor& executor){
+    shared_future<void> released=fRelease.get_future().share();
+    fDone=executor.Run([released](SSPDAQ::Device&){released.wait();});
+  }
+
+  void Release(){
+    fRelease.set_value();
+    fDone.get();
+  }
+
+private:
+
+  promise<void> fRelease;
+  future<void> fDone;
+};
+
+void TestReadsMerge(){
+  FakeDevice device;
+  for(unsigned int i=0;i<8;++i){
+    device.words[0x100+0x4*i]=i+1;
+  }
+  SSPDAQ::CommandExecutor executor(&device);
+  Hold hold(executor);
+  future<unsigned int> a=executor.Read(0x100);
+  future<unsigned int> b=executor.Read(0x104);
+  future<vector<unsigned int> > c=executor.ReadArray(0x104,3);
+  future<unsigned int> d=executor.ReadMask(0x110,0x4);
+  hold.Release();
+
+  CHECK(a.get()==1);
+  CHECK(b.get()==2);
+  CHECK(c.get()==vector<unsigned int>({2,3,4}));
+  CHECK(d.get()==(5u&0x4));
+  CHECK(device.transactions.size()==1);
+  CHECK(device.transactions[0].type=="arrayread");
+  CHECK(device.transactions[0].address==0x100);
+  CHECK(device.transactions[0].size==5);
+}
+
+//Reads before the first address, or past a gap, start a new transaction
+void TestReadsDontMergeAcrossGaps(){
+  FakeDevice device;
+  SSPDAQ::CommandExecutor executor(&device);
+  Hold hold(executor);
+  future<unsigned int> a=executor.Read(0x100);
+  future<unsigned int> b=executor.Read(0x10C);
+  future<unsigned int> c=executor.Read(0x0FC);
+  hold.Release();
+  a.get();
+  b.get();
+  c.get();
+  CHECK(device.transactions.size()==3);
+}
+
+void TestWritesMerge(){
+  FakeDevice device;
+  SSPDAQ::CommandExecutor executor(&device);
+  Hold hold(executor);
+  unsigned int values[2]={20,30};
+  future<void> a=executor.Write(0x200,10);
+  future<void> b=executor.WriteArray(0x204,2,values);
+  future<void> c=executor.Write(0x20C,40);
+  hold.Release();
+  a.get();
+  b.get();
+  c.get();
+
+  CHECK(device.transactions.size()==1);
+  CHECK(device.transactions[0].type=="arraywrite");
+  CHECK(device.transactions[0].size==4);
+  CHECK(device.words[0x200]==10&&device.words[0x204]==20&&device.words[0x208]==30&&device.words[0x20C]==40);
+  CHECK(executor.Commands()==4);
+}
+
+//Later masked writes win where masks overlap
+void TestMaskedWritesMerge(){
+  FakeDevice device;
+  device.words[0x300]=0xFFFF0000;
+  SSPDAQ::CommandExecutor executor(&device);
+  Hold hold(executor);
+  future<void> a=executor.WriteMask(0x300,0x00FF,0x0012);
+  future<void> b=executor.WriteMask(0x300,0x0F0F,0x0304);
+  hold.Release();
+  a.get();
+  b.get();
+
+  CHECK(device.transactions.size()==1);
+  CHECK(device.transactions[0].type=="writemask");
+  CHECK(device.words[0x300]==0xFFFF0314);
+}
+
+//Merging never reorders: a read between two writes sees the first
+void TestOrderKept(){
+  FakeDevice device;
+  SSPDAQ::CommandExecutor executor(&device);
+  Hold hold(executor);
+  future<void> a=executor.Write(0x400,1);
+  future<unsigned int> b=executor.Read(0x400);
+  future<void> c=executor.Write(0x400,2);
+  hold.Release();
+  a.get();
+  CHECK(b.get()==1);
+  c.get();
+  CHECK(device.words[0x400]==2);
+}
+
+//A failed transaction fails every command merged into it, and only those
+void TestErrors(){
+  FakeDevice device;
+  SSPDAQ::CommandExecutor executor(&device);
+  Hold hold(executor);
+  future<unsigned int> a=executor.Read(FakeDevice::badAddress);
+  future<unsigned int> b=executor.Read(FakeDevice::badAddress+0x4);
+  future<void> c=executor.Write(0x500,7);
+  hold.Release();
+
+  bool threw=false;
+  try{
+    a.get();
+  }
+  catch(std::runtime_error&){
+    threw=true;
+  }
+  CHECK(threw);
+  threw=false;
+  try{
+    b.get();
+  }
+  catch(std::runtime_error&){
+    threw=true;
+  }
+  CHECK(threw);
+  c.get();
+  CHECK(device.words[0x500]==7);
+}
+
+int main(){
+  TestReadsMerge();
+  TestReadsDontMergeAcrossGaps();
+  TestWritesMerge();
+  TestMaskedWritesMerge();
+  TestOrderKept();
+  TestErrors();
+  return Failures("CommandExecutor");
+}
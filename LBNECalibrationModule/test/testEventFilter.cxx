@@ -0,0 +1,172 @@
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "Check.h"
+#include "EventDecoder.h"
+#include "EventFilter.h"
+#include "anlTypes.h"
+
+using namespace std;
+
+//Header-only event with the fields the filter looks at
+SSPDAQ::EventHeader MakeHeader(unsigned int channel, unsigned int trigger, unsigned int flags,
+			       int peakSum, unsigned int prerise){
+  SSPDAQ::EventHeader header;
+  memset(&header,0,sizeof(header));
+  header.header=0xAAAAAAAA;
+  header.length=SSPDAQ::Decode::headerWords;
+  header.group1=(trigger<<8)|(flags<<4);
+  header.group2=(1<<4)|channel;
+  header.peakSumLow=peakSum&0xFFFF;
+  header.group3=(peakSum>>16)&0xFF;
+  header.preriseLow=prerise&0xFFFF;
+  header.group4=(prerise>>16)&0xFF;
+  return header;
+}
+
+//A spread of events over every field
+vector<SSPDAQ::EventHeader> MakeEvents(){
+  vector<SSPDAQ::EventHeader> events;
+  for(unsigned int i=0;i<512;++i){
+    events.push_back(MakeHeader(i%16,(i*7)%256,(i/3)%16,(int)(i*977%4001)-2000,i*131%70000));
+  }
+  return events;
+}
+
+//Accept and AcceptBatch agree on every event
+unsigned int CheckBatch(const SSPDAQ::EventFilter& filter, const vector<SSPDAQ::EventHeader>& events){
+  SSPDAQ::DecoderConfig config={SSPDAQ::kInternalTime,SSPDAQ::TimingService::Transform(),true,0};
+  SSPDAQ::DecodedEvents decoded;
+  SSPDAQ::SelectDecoder(config)((const unsigned int*)&events[0],events.size()*SSPDAQ::Decode::headerWords,config,decoded);
+  CHECK(decoded.size()==events.size());
+
+  vector<unsigned char> accept;
+  size_t accepted=filter.AcceptBatch(decoded,accept);
+  unsigned int agreed=0;
+  unsigned int expected=0;
+  for(size_t i=0;i<events.size();++i){
+    bool single=filter.Accept(events[i]);
+    agreed+=single==(accept[i]!=0);
+    expected+=single;
+  }
+  CHECK(agreed==events.size());
+  CHECK(accepted==expected);
+  return expected;
+}
+
+void TestDefaultAcceptsAll(){
+  SSPDAQ::EventFilter filter;
+  vector<SSPDAQ::EventHeader> events=MakeEvents();
+  CHECK(filter.AcceptsAll());
+  CHECK(CheckBatch(filter,events)==events.size());
+}
+
+void TestChannelMask(){
+  SSPDAQ::EventFilter filter;
+  filter.SetChannelMask(0x0005);
+  CHECK(!filter.AcceptsAll());
+  CHECK(filter.Accept(MakeHeader(0,0,0,0,0)));
+  CHECK(!filter.Accept(MakeHeader(1,0,0,0,0)));
+  CHECK(filter.Accept(MakeHeader(2,0,0,0,0)));
+  CHECK(CheckBatch(filter,MakeEvents())==64);
+}
+
+void TestTriggerTypes(){
+  SSPDAQ::EventFilter filter;
+  filter.SetTriggerTypes(vector<unsigned int>({3,64,255}));
+  CHECK(filter.Accept(MakeHeader(0,3,0,0,0)));
+  CHECK(filter.Accept(MakeHeader(0,64,0,0,0)));
+  CHECK(filter.Accept(MakeHeader(0,255,0,0,0)));
+  CHECK(!filter.Accept(MakeHeader(0,4,0,0,0)));
+  CHECK(!filter.Accept(MakeHeader(0,128,0,0,0)));
+  CheckBatch(filter,MakeEvents());
+
+  //No types means any
+  filter.SetTriggerTypes(vector<unsigned int>());
+  CHECK(filter.AcceptsAll());
+}
+
+void TestStatusFlags(){
+  SSPDAQ::EventFilter filter;
+  filter.SetRejectedStatusFlags(0x2);
+  CHECK(filter.Accept(MakeHeader(0,0,0x1,0,0)));
+  CHECK(!filter.Accept(MakeHeader(0,0,0x2,0,0)));
+  CHECK(!filter.Accept(MakeHeader(0,0,0xF,0,0)));
+  CheckBatch(filter,MakeEvents());
+}
+
+//Windows include both ends, and peak sums are signed
+void TestWindows(){
+  SSPDAQ::EventFilter filter;
+  filter.SetPeakSumWindow(-100,100);
+  CHECK(filter.Accept(MakeHeader(0,0,0,-100,0)));
+  CHECK(filter.Accept(MakeHeader(0,0,0,100,0)));
+  CHECK(!filter.Accept(MakeHeader(0,0,0,-101,0)));
+  CHECK(!filter.Accept(MakeHeader(0,0,0,101,0)));
+  CheckBatch(filter,MakeEvents());
+
+  filter.SetPeakSumWindow(INT_MIN,INT_MAX);
+  filter.SetPreriseWindow(70000,70100);
+  CHECK(filter.Accept(MakeHeader(0,0,0,0,70000)));
+  CHECK(filter.Accept(MakeHeader(0,0,0,0,70100)));
+  CHECK(!filter.Accept(MakeHeader(0,0,0,0,69999)));
+  CHECK(!filter.Accept(MakeHeader(0,0,0,0,70101)));
+  CheckBatch(filter,MakeEvents());
+}
+
+//Criteria are anded together
+void TestCombined(){
+  SSPDAQ::EventFilter filter;
+  filter.SetChannelMask(0x00FF);
+  filter.SetRejectedStatusFlags(0x8);
+  filter.SetPeakSumWindow(0,INT_MAX);
+  filter.SetTriggerTypes(vector<unsigned int>({7,14,21}));
+  CHECK(filter.Accept(MakeHeader(1,7,0,5,0)));
+  CHECK(!filter.Accept(MakeHeader(9,7,0,5,0)));
+  CHECK(!filter.Accept(MakeHeader(1,8,0,5,0)));
+  CHECK(!filter.Accept(MakeHeader(1,7,0x8,5,0)));
+  CHECK(!filter.Accept(MakeHeader(1,7,0,-5,0)));
+  CheckBatch(filter,MakeEvents());
+}
+
+void TestBadSettings(){
+  SSPDAQ::EventFilter filter;
+  bool threw=false;
+  try{
+    filter.SetPeakSumWindow(1,0);
+  }
+  catch(std::invalid_argument&){
+    threw=true;
+  }
+  CHECK(threw);
+  threw=false;
+  try{
+    filter.SetPreriseWindow(1,0);
+  }
+  catch(std::invalid_argument&){
+    threw=true;
+  }
+  CHECK(threw);
+  threw=false;
+  try{
+    filter.SetTriggerTypes(vector<unsigned int>({256}));
+  }
+  catch(std::invalid_argument&){
+    threw=true;
+  }
+  CHECK(threw);
+  //Failed settings leave the filter as it was
+  CHECK(filter.AcceptsAll());
+}
+
+int main(){
+  TestDefaultAcceptsAll();
+  TestChannelMask();
+  TestTriggerTypes();
+  TestStatusFlags();
+  TestWindows();
+  TestCombined();
+  TestBadSettings();
+  return Failures("EventFilter");
+}
@@ -0,0 +1,129 @@
+#include <chrono>
+#include <future>
+#include <thread>
+#include "Check.h"
+#include "MillisliceQueue.h"
+#include "anlTypes.h"
+
+using namespace std;
+
+const SSPDAQ::MillisliceHeader& Header(const vector<unsigned int>& slice){
+  return *reinterpret_cast<const SSPDAQ::MillisliceHeader*>(&slice[0]);
+}
+
+//Slice with a cleared header, tagged by startTime
+vector<unsigned int> MakeSlice(unsigned long tag){
+  vector<unsigned int> slice(SSPDAQ::MillisliceHeader::sizeInUInts+4,0);
+  reinterpret_cast<SSPDAQ::MillisliceHeader*>(&slice[0])->startTime=tag;
+  return slice;
+}
+
+unsigned long Pop(SSPDAQ::MillisliceQueue& queue, vector<unsigned int>& slice){
+  return queue.TryPop(slice,chrono::microseconds(0))?Header(slice).startTime:~0UL;
+}
+
+//With no limits set, nothing is ever dropped
+void TestDefaultIsLossless(){
+  SSPDAQ::MillisliceQueue queue;
+  for(unsigned long i=0;i<5000;++i){
+    vector<unsigned int> slice=MakeSlice(i);
+    CHECK(queue.Push(slice));
+  }
+  SSPDAQ::MillisliceQueue::Stats stats=queue.GetStats();
+  CHECK(stats.slices==5000);
+  CHECK(stats.dropped==0);
+  vector<unsigned int> slice;
+  CHECK(Pop(queue,slice)==0);
+  CHECK(!(Header(slice).flags&SSPDAQ::MillisliceHeader::kAfterDroppedSlices));
+}
+
+//The incoming slice is refused and the next one queued carries the gap
+void TestDropNewest(){
+  SSPDAQ::MillisliceQueue queue(2,SIZE_MAX,SSPDAQ::MillisliceQueue::kDropNewest);
+  for(unsigned long i=0;i<2;++i){
+    vector<unsigned int> slice=MakeSlice(i);
+    CHECK(queue.Push(slice));
+    CHECK(slice.empty());
+  }
+  for(unsigned long i=2;i<4;++i){
+    vector<unsigned int> slice=MakeSlice(i);
+    CHECK(!queue.Push(slice));
+    CHECK(Header(slice).startTime==i); //Left with the caller
+  }
+  vector<unsigned int> slice;
+  CHECK(Pop(queue,slice)==0);
+  slice=MakeSlice(4);
+  CHECK(queue.Push(slice));
+
+  CHECK(Pop(queue,slice)==1);
+  CHECK(Pop(queue,slice)==4);
+  CHECK(Header(slice).flags&SSPDAQ::MillisliceHeader::kAfterDroppedSlices);
+  CHECK(Header(slice).nDroppedSlices==2);
+  CHECK(queue.GetStats().dropped==2);
+}
+
+//The head of the queue makes room, and the new head carries the gap
+void TestDropOldest(){
+  SSPDAQ::MillisliceQueue queue(2,SIZE_MAX,SSPDAQ::MillisliceQueue::kDropOldest);
+  for(unsigned long i=0;i<3;++i){
+    vector<unsigned int> slice=MakeSlice(i);
+    bool queued=queue.Push(slice);
+    CHECK(queued==(i<2));
+    if(i==2){
+      CHECK(Header(slice).startTime==0); //Dropped slice handed back for reuse
+    }
+  }
+  vector<unsigned int> slice;
+  CHECK(Pop(queue,slice)==1);
+  CHECK(Header(slice).nDroppedSlices==1);
+  CHECK(Pop(queue,slice)==2);
+  CHECK(Header(slice).nDroppedSlices==0);
+  CHECK(queue.GetStats().dropped==1);
+}
+
+//Push waits for room, and Interrupt turns waiting into dropping
+void TestBlock(){
+  SSPDAQ::MillisliceQueue queue(1,SIZE_MAX,SSPDAQ::MillisliceQueue::kBlock);
+  vector<unsigned int> first=MakeSlice(0);
+  CHECK(queue.Push(first));
+
+  future<bool> blocked=async(launch::async,[&queue]{
+      vector<unsigned int> slice=MakeSlice(1);
+      return queue.Push(slice);
+    });
+  CHECK(blocked.wait_for(chrono::milliseconds(50))==future_status::timeout);
+  vector<unsigned int> slice;
+  CHECK(Pop(queue,slice)==0);
+  CHECK(blocked.get());
+  CHECK(Pop(queue,slice)==1);
+  CHECK(queue.GetStats().blockedInus>0);
+
+  slice=MakeSlice(2);
+  CHECK(queue.Push(slice));
+  future<bool> interrupted=async(launch::async,[&queue]{
+      vector<unsigned int> slice=MakeSlice(3);
+      return queue.Push(slice);
+    });
+  this_thread::sleep_for(chrono::milliseconds(20));
+  queue.Interrupt();
+  CHECK(interrupted.wait_for(chrono::seconds(1))==future_status::ready&&!interrupted.get());
+  CHECK(queue.GetStats().dropped==1);
+}
+
+//A slice over the byte limit is still taken into an empty queue
+void TestByteLimit(){
+  SSPDAQ::MillisliceQueue queue(SIZE_MAX,1,SSPDAQ::MillisliceQueue::kDropNewest);
+  vector<unsigned int> slice=MakeSlice(0);
+  CHECK(queue.Push(slice));
+  slice=MakeSlice(1);
+  CHECK(!queue.Push(slice));
+}
+
+int main(){
+  TestDefaultIsLossless();
+  TestDropNewest();
+  TestDropOldest();
+  TestBlock();
+  TestByteLimit();
+  return Failures("MillisliceQueue");
+}
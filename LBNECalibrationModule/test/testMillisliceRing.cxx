@@ -0,0 +1,131 @@
+#include <chrono>
+#include <future>
+#include <thread>
+#include "Check.h"
+#include "MillisliceRing.h"
+
+using namespace std;
+
+//Publish a one word slice holding tag
+bool Publish(SSPDAQ::MillisliceRing& ring, unsigned int tag){
+  vector<unsigned int> slice(1,tag);
+  return ring.Publish(slice);
+}
+
+//Tag of the next slice, or ~0 if there is none
+unsigned int Next(SSPDAQ::MillisliceRing::Consumer& consumer){
+  SSPDAQ::MillisliceRing::Slice_t slice;
+  return consumer.Next(slice,chrono::microseconds(0))?(*slice)[0]:~0U;
+}
+
+//An optional consumer which falls a whole ring behind skips to the newest slice
+void TestOptionalLapped(){
+  SSPDAQ::MillisliceRing ring(4);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> consumer=ring.AddConsumer(false);
+  for(unsigned int i=0;i<10;++i){
+    CHECK(Publish(ring,i));
+  }
+  CHECK(Next(*consumer)==9);
+  CHECK(consumer->Skipped()==9);
+  CHECK(Next(*consumer)==~0U);
+  CHECK(ring.Dropped()==0);
+}
+
+//An optional consumer within a ring of the producer misses nothing
+void TestOptionalKeepingUp(){
+  SSPDAQ::MillisliceRing ring(4);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> consumer=ring.AddConsumer(false);
+  for(unsigned int i=0;i<4;++i){
+    CHECK(Publish(ring,i));
+  }
+  for(unsigned int i=0;i<4;++i){
+    CHECK(Next(*consumer)==i);
+  }
+  CHECK(consumer->Skipped()==0);
+}
+
+//A mandatory consumer added after the producer has run with only optional
+//ones is still waited for
+void TestMandatoryAddedLater(){
+  SSPDAQ::MillisliceRing ring(4);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> optional=ring.AddConsumer(false);
+  for(unsigned int i=0;i<10;++i){
+    CHECK(Publish(ring,i));
+  }
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> mandatory=ring.AddConsumer(true);
+  for(unsigned int i=10;i<14;++i){
+    CHECK(Publish(ring,i));
+  }
+  future<bool> blocked=async(launch::async,[&ring]{return Publish(ring,14);});
+  CHECK(blocked.wait_for(chrono::milliseconds(50))==future_status::timeout);
+  CHECK(Next(*mandatory)==10);
+  CHECK(blocked.get());
+  for(unsigned int i=11;i<15;++i){
+    CHECK(Next(*mandatory)==i);
+  }
+  CHECK(mandatory->Skipped()==0);
+  CHECK(ring.Dropped()==0);
+}
+
+//Removing a mandatory consumer releases the producer
+void TestMandatoryRemoved(){
+  SSPDAQ::MillisliceRing ring(2);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> mandatory=ring.AddConsumer(true);
+  CHECK(Publish(ring,0));
+  CHECK(Publish(ring,1));
+  future<bool> blocked=async(launch::async,[&ring]{return Publish(ring,2);});
+  CHECK(blocked.wait_for(chrono::milliseconds(50))==future_status::timeout);
+  ring.RemoveConsumer(mandatory);
+  CHECK(blocked.wait_for(chrono::seconds(1))==future_status::ready&&blocked.get());
+}
+
+//Interrupt turns waiting for a mandatory consumer into dropping
+void TestInterrupt(){
+  SSPDAQ::MillisliceRing ring(2);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> mandatory=ring.AddConsumer(true);
+  CHECK(Publish(ring,0));
+  CHECK(Publish(ring,1));
+  future<bool> blocked=async(launch::async,[&ring]{return Publish(ring,2);});
+  this_thread::sleep_for(chrono::milliseconds(20));
+  ring.Interrupt();
+  CHECK(blocked.wait_for(chrono::seconds(1))==future_status::ready&&!blocked.get());
+  CHECK(ring.Dropped()==1);
+  ring.Resume();
+  CHECK(Next(*mandatory)==0);
+  CHECK(Publish(ring,3));
+}
+
+//Mandatory consumers get every slice in order from a producer running freely
+void TestMandatoryLossless(){
+  SSPDAQ::MillisliceRing ring(8);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> mandatory=ring.AddConsumer(true);
+  shared_ptr<SSPDAQ::MillisliceRing::Consumer> optional=ring.AddConsumer(false);
+  const unsigned int nSlices=20000;
+  thread producer([&ring]{
+      for(unsigned int i=0;i<nSlices;++i){
+	Publish(ring,i);
+      }
+    });
+  unsigned int outOfOrder=0;
+  for(unsigned int i=0;i<nSlices;++i){
+    SSPDAQ::MillisliceRing::Slice_t slice;
+    if(!mandatory->Next(slice,chrono::seconds(1))){
+      break;
+    }
+    outOfOrder+=(*slice)[0]!=i;
+  }
+  producer.join();
+  CHECK(outOfOrder==0);
+  CHECK(mandatory->Received()==nSlices);
+  CHECK(ring.Dropped()==0);
+}
+
+int main(){
+  TestOptionalLapped();
+  TestOptionalKeepingUp();
+  TestMandatoryAddedLater();
+  TestMandatoryRemoved();
+  TestInterrupt();
+  TestMandatoryLossless();
+  return Failures("MillisliceRing");
+}
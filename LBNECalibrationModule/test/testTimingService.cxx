@@ -0,0 +1,138 @@
+#include <cmath>
+#include <cstring>
+#include "Check.h"
+#include "TimingService.h"
+#include "anlTypes.h"
+
+using namespace std;
+
+//Events every 1ms of internal time at 150MHz
+const unsigned long eventTicks=150000;
+
+//Header with both timestamps set; external is one 64-bit count, as the emulator writes it
+SSPDAQ::EventHeader MakeHeader(unsigned long internal, unsigned long external){
+  SSPDAQ::EventHeader header;
+  memset(&header,0,sizeof(header));
+  for(unsigned int i=0;i<3;++i){
+    header.intTimestamp[i+1]=(internal>>(16*i))&0xFFFF;
+  }
+  for(unsigned int i=0;i<4;++i){
+    header.timestamp[i]=(external>>(16*i))&0xFFFF;
+  }
+  return header;
+}
+
+//Feeds one board events with external=offset+internal*(1+drift), counting
+//every time unified time goes backward
+class Board{
+
+public:
+
+  Board(SSPDAQ::TimingService& service):
+    fClock(service.Board(0)),
+    fInternal(1000),
+    fLastUnified(0),
+    fBackward(0)
+  {}
+
+  unsigned long Run(unsigned int nEvents, double offset, double drift){
+    unsigned long unified=0;
+    for(unsigned int i=0;i<nEvents;++i){
+      fInternal+=eventTicks;
+      unsigned long external=offset+fInternal*(1.+drift);
+      unified=fClock.Unify(MakeHeader(fInternal,external));
+      if(unified<fLastUnified){
+	++fBackward;
+      }
+      fLastUnified=unified;
+    }
+    return unified;
+  }
+
+  double External(double offset, double drift) const{return offset+fInternal*(1.+drift);}
+
+  SSPDAQ::TimingService::BoardClock& fClock;
+  unsigned long fInternal;
+  unsigned long fLastUnified;
+  unsigned int fBackward;
+};
+
+//The fit finds the drift, and unified time follows the external clock
+void TestFit(){
+  SSPDAQ::TimingService service;
+  Board board(service);
+  double offset=1E9, drift=20E-6;
+  unsigned long unified=board.Run(3000,offset,drift);
+
+  SSPDAQ::TimingService::Stats stats=board.fClock.GetStats();
+  CHECK(stats.locked);
+  CHECK(fabs(stats.driftInppm-20.)<0.1);
+  CHECK(fabs((double)unified-board.External(offset,drift))<10.);
+  CHECK(stats.resyncs==0&&stats.steps==0&&stats.clamps==0);
+  CHECK(board.fBackward==0);
+}
+
+//A resync forward restarts the fit and unified time steps to it
+void TestResyncForward(){
+  SSPDAQ::TimingService service;
+  Board board(service);
+  double offset=1E9, drift=20E-6;
+  board.Run(1000,offset,drift);
+  offset+=1E8;
+  unsigned long unified=board.Run(2000,offset,drift);
+
+  SSPDAQ::TimingService::Stats stats=board.fClock.GetStats();
+  CHECK(stats.resyncs==1);
+  CHECK(stats.clamps==0);
+  CHECK(fabs((double)unified-board.External(offset,drift))<10.);
+  CHECK(board.fBackward==0);
+}
+
+//A resync backward leaves unified time ahead of the new fit; it is never
+//stepped back, but slewed towards the fit at the fastest rate allowed
+void TestResyncBackward(){
+  SSPDAQ::TimingService service;
+  service.SetSteering(150000.,1000.);
+  Board board(service);
+  double offset=1E9, drift=0.;
+  board.Run(1000,offset,drift);
+  offset-=1E7;
+  unsigned long before=board.fLastUnified;
+  unsigned long unified=board.Run(3000,offset,drift);
+
+  SSPDAQ::TimingService::Stats stats=board.fClock.GetStats();
+  CHECK(stats.resyncs==1);
+  CHECK(stats.clamps==1);
+  CHECK(stats.steps==0);
+  CHECK(board.fBackward==0);
+  CHECK(unified>before);
+  //Still ahead, but by less than the jump
+  double ahead=(double)unified-board.External(offset,drift);
+  CHECK(ahead>0.&&ahead<1E7);
+  CHECK(fabs(stats.errorInTicks-ahead)<2000.); //Less slewing since the last sample
+  CHECK(stats.transform.ticksPerTick<1.);
+}
+
+//Without external timestamps, internal time is just scaled
+void TestNoExternal(){
+  SSPDAQ::TimingService service(150.,50.);
+  SSPDAQ::TimingService::BoardClock& clock=service.Board(0);
+  unsigned long last=0;
+  unsigned int backward=0;
+  for(unsigned long internal=3000;internal<3000+1000*eventTicks;internal+=eventTicks){
+    unsigned long unified=clock.Unify(MakeHeader(internal,0));
+    backward+=unified<last;
+    last=unified;
+  }
+  CHECK(backward==0);
+  CHECK(last==(3000+999*eventTicks)/3);
+  CHECK(!clock.GetStats().locked);
+}
+
+int main(){
+  TestFit();
+  TestResyncForward();
+  TestResyncBackward();
+  TestNoExternal();
+  return Failures("TimingService");
+}